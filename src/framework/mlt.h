@@ -58,6 +58,7 @@ extern "C"
 #include "mlt_cache.h"
 #include "mlt_version.h"
 #include "mlt_slices.h"
+#include "mlt_luma_map.h"
 
 #ifdef __cplusplus
 }
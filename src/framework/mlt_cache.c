@@ -27,14 +27,18 @@
 #include "mlt_frame.h"
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 
-/** the maximum number of data objects to cache per line */
-#define MAX_CACHE_SIZE (200)
-
 /** the default number of data objects to cache per line */
 #define DEFAULT_CACHE_SIZE (4)
 
+/** the most stripes a cache is split into */
+#define MAX_CACHE_STRIPES (16)
+
+/** the number of items per stripe beyond which a cache is split further */
+#define CACHE_STRIPE_SIZE (64)
+
 /** \brief Cache item class
  *
  * A cache item is a structure holding information about a data object including
@@ -48,26 +52,49 @@
 
 typedef struct mlt_cache_item_s
 {
-	mlt_cache cache;           /**< a reference to the cache to which this belongs */
+	uintptr_t key;             /**< the owner's address, or the frame position in a frame cache */
 	void *object;              /**< a parent object to the cache data that uniquely identifies this cached item */
 	void *data;                /**< the opaque pointer to the cached data */
 	int size;                  /**< the size of the cached data */
 	int refcount;              /**< a reference counter to control when destructor is called */
 	mlt_destructor destructor; /**< a function to release or destroy the cached data */
+	int cached;                /**< whether the item is in the cache rather than only referenced */
+	unsigned int stamp;        /**< when the item was last used, to compare items of different stripes */
+	struct cache_stripe_s *stripe;  /**< the stripe the item belongs to, NULL once the cache is closed */
+	struct mlt_cache_item_s *next;  /**< the next item in the hash bucket */
+	struct mlt_cache_item_s *newer; /**< the next more recently used item, or the next orphan */
+	struct mlt_cache_item_s *older; /**< the next less recently used item, or the previous orphan */
 } mlt_cache_item_s;
 
+/** \brief Cache stripe class
+ *
+ * A part of the cache with its own lock. Items are found through a hash table
+ * and kept in a list from the most to the least recently used.
+ */
+
+typedef struct cache_stripe_s
+{
+	pthread_mutex_t mutex;     /**< a mutex to prevent multi-threaded race conditions */
+	mlt_cache_item *buckets;   /**< the hash table, a power of 2 in size */
+	int bucket_count;          /**< the number of buckets */
+	int count;                 /**< the number of items currently in the stripe */
+	mlt_cache_item newest;     /**< the most recently used item */
+	mlt_cache_item oldest;     /**< the least recently used item */
+	mlt_cache_item orphans;    /**< items no longer cached to which there are outstanding references */
+} cache_stripe;
+
 /** \brief Cache class
  *
  * This is a utility class for implementing a Least Recently Used (LRU) cache
  * of data blobs indexed by the address of some other object (e.g., a service).
- * Instead of sorting and manipulating linked lists, it tries to be simple and
- * elegant by copying pointers between two arrays of fixed size to shuffle the
- * order of elements.
+ * Items are found through a hash table and kept in a linked list in the order
+ * they were used, so getting and putting do not depend on the size of the
+ * cache. Large caches are split into stripes with their own locks by the hash
+ * of the owner. The size applies to the whole cache: when it is exceeded, the
+ * least recently used item of all the stripes is dropped.
  *
- * This class is useful if you have a service that wants to cache something
- * somewhat large, but will not scale if there are many instances of the service.
- * Of course, the service will need to know how to recreate the cached element
- * if it gets flushed from the cache,
+ * The service will need to know how to recreate the cached element if it gets
+ * flushed from the cache.
  *
  * The most obvious examples are the pixbuf and qimage producers that cache their
  * respective objects representing a picture read from a file. If the picture
@@ -80,98 +107,322 @@ typedef struct mlt_cache_item_s
 
 struct mlt_cache_s
 {
-	int count;             /**< the number of items currently in the cache */
-	int size;              /**< the maximum number of items permitted in the cache <= \p MAX_CACHE_SIZE */
+	int size;              /**< the maximum number of items permitted in the cache */
 	int is_frames;         /**< indicates if this cache is used to cache frames */
-	void* *current;        /**< pointer to the current array of pointers */
-	void* A[ MAX_CACHE_SIZE ];
-	void* B[ MAX_CACHE_SIZE ];
-	pthread_mutex_t mutex; /**< a mutex to prevent multi-threaded race conditions */
-	mlt_properties active; /**< a list of cache items some of which may no longer
-	                            be in \p current but to which there are
-	                            outstanding references */
-	mlt_properties garbage;/**< a list cache items pending release. A cache item
-	                            is copied to this list when it is updated but there
-	                            are outstanding references to the old data object. */
+	int count;             /**< the number of items currently in the cache, updated atomically */
+	unsigned int clock;    /**< the source of item stamps, updated atomically */
+	int stripe_count;      /**< the number of stripes in use, a power of 2, only changed with all stripes locked */
+	cache_stripe stripes[ MAX_CACHE_STRIPES ];
 };
 
-/** Get the data pointer from the cache item.
+static inline uint32_t cache_hash( uintptr_t key )
+{
+	return ( uint32_t )( ( ( uint64_t )key * 0x9e3779b97f4a7c15ULL ) >> 32 );
+}
+
+/** Lock the stripe that holds a key.
  *
- * \public \memberof mlt_cache_s
- * \param item a cache item
- * \param[out] size the number of bytes pointed at, if supplied when putting the data into the cache
- * \return the data pointer
+ * The number of stripes can only change while all of them are locked, so it
+ * is checked again once the stripe is locked.
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param hash the hash of the key
+ * \return the locked stripe
  */
 
-void *mlt_cache_item_data( mlt_cache_item item, int *size )
+static cache_stripe *cache_lock_stripe( mlt_cache cache, uint32_t hash )
 {
-	if ( size && item )
-		*size = item->size;
-	return item? item->data : NULL;
+	while ( 1 )
+	{
+		cache_stripe *stripe = &cache->stripes[ ( hash >> 28 ) & ( __atomic_load_n( &cache->stripe_count, __ATOMIC_RELAXED ) - 1 ) ];
+		pthread_mutex_lock( &stripe->mutex );
+		if ( stripe == &cache->stripes[ ( hash >> 28 ) & ( cache->stripe_count - 1 ) ] )
+			return stripe;
+		pthread_mutex_unlock( &stripe->mutex );
+	}
+}
+
+static mlt_cache_item stripe_find( cache_stripe *stripe, uintptr_t key, uint32_t hash )
+{
+	mlt_cache_item item = stripe->bucket_count ? stripe->buckets[ hash & ( stripe->bucket_count - 1 ) ] : NULL;
+	while ( item && item->key != key )
+		item = item->next;
+	return item;
 }
 
-/** Close a cache item given its parent object pointer.
+/** Make an item the most recently used.
  *
  * \private \memberof mlt_cache_s
  * \param cache a cache
- * \param object the object to which the data object belongs
- * \param data the data object, which might be in the garbage list (optional)
+ * \param stripe a locked cache stripe
+ * \param item an item in the stripe, or not yet in the list
+ * \param linked whether the item is already in the list
  */
 
-static void cache_object_close( mlt_cache cache, void *object, void* data )
+static void stripe_touch( mlt_cache cache, cache_stripe *stripe, mlt_cache_item item, int linked )
 {
-	char key[19];
-
-	if ( cache->is_frames )
+	if ( cache->stripe_count > 1 )
+		item->stamp = __sync_add_and_fetch( &cache->clock, 1 );
+	if ( linked )
 	{
-		// Frame caches are easy - just close the object as mlt_frame.
-		mlt_frame_close( object );
-		return;
+		if ( stripe->newest == item )
+			return;
+		item->newer->older = item->older;
+		if ( item->older )
+			item->older->newer = item->newer;
+		else
+			stripe->oldest = item->newer;
 	}
+	item->newer = NULL;
+	item->older = stripe->newest;
+	if ( stripe->newest )
+		stripe->newest->newer = item;
+	else
+		stripe->oldest = item;
+	stripe->newest = item;
+}
 
-	// Fetch the cache item from the active list by its owner's address
-	sprintf( key, "%p", object );
-	mlt_cache_item item = mlt_properties_get_data( cache->active, key, NULL );
-	if ( item )
+/** Add an item to the hash table and the most recently used end.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param stripe a locked cache stripe
+ * \param item the item to add
+ * \return true if there was an allocation error
+ */
+
+static int stripe_insert( mlt_cache cache, cache_stripe *stripe, mlt_cache_item item )
+{
+	if ( stripe->count >= stripe->bucket_count )
 	{
-		mlt_log( NULL, MLT_LOG_DEBUG, "%s: item %p object %p data %p refcount %d\n", __FUNCTION__,
-			item, item->object, item->data, item->refcount );
-		if ( item->destructor && --item->refcount <= 0 )
+		// Keep the load factor at most one
+		int count = stripe->bucket_count ? stripe->bucket_count * 2 : 16;
+		mlt_cache_item *buckets = calloc( count, sizeof( mlt_cache_item ) );
+		if ( buckets )
 		{
-			// Destroy the data object
-			item->destructor( item->data );
-			item->data = NULL;
-			item->destructor = NULL;
-			// Do not dispose of the cache item because it could likely be used
-			// again.
+			int i;
+			for ( i = 0; i < stripe->bucket_count; i++ )
+			{
+				while ( stripe->buckets[ i ] )
+				{
+					mlt_cache_item moved = stripe->buckets[ i ];
+					mlt_cache_item *bucket = &buckets[ cache_hash( moved->key ) & ( count - 1 ) ];
+					stripe->buckets[ i ] = moved->next;
+					moved->next = *bucket;
+					*bucket = moved;
+				}
+			}
+			free( stripe->buckets );
+			stripe->buckets = buckets;
+			stripe->bucket_count = count;
+		}
+		else if ( !stripe->bucket_count )
+		{
+			return 1;
 		}
 	}
 
-	// Fetch the cache item from the garbage collection by its data address
-	if ( data )
+	mlt_cache_item *bucket = &stripe->buckets[ cache_hash( item->key ) & ( stripe->bucket_count - 1 ) ];
+	item->next = *bucket;
+	*bucket = item;
+	item->cached = 1;
+	stripe_touch( cache, stripe, item, 0 );
+	stripe->count++;
+	__sync_fetch_and_add( &cache->count, 1 );
+	return 0;
+}
+
+/** Release a reference to an item and destroy it with the last one.
+ *
+ * An item keeps its memory while it is in the cache, but one that is no longer
+ * cached is freed with its last reference. So an item must not be closed more
+ * often than it was got.
+ * \private \memberof mlt_cache_s
+ * \param stripe a locked cache stripe
+ * \param item an item of the stripe
+ */
+
+static void item_release( cache_stripe *stripe, mlt_cache_item item )
+{
+	if ( item->refcount <= 0 || --item->refcount > 0 )
+		return;
+
+	mlt_log_debug( NULL, "%s: item %p object %p data %p\n", __FUNCTION__,
+		item, item->object, item->data );
+	if ( item->destructor )
+		item->destructor( item->data );
+	item->data = NULL;
+	item->destructor = NULL;
+
+	if ( !item->cached )
 	{
-		sprintf( key, "%p", data );
-		item = mlt_properties_get_data( cache->garbage, key, NULL );
-		if ( item )
+		// Take it off the orphans
+		if ( item->older )
+			item->older->newer = item->newer;
+		else
+			stripe->orphans = item->newer;
+		if ( item->newer )
+			item->newer->older = item->older;
+		free( item );
+	}
+}
+
+/** Remove an item from the cache and release the cache's reference.
+ *
+ * The data lives on if there are outstanding references to it.
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param stripe a locked cache stripe
+ * \param item an item in the stripe
+ */
+
+static void stripe_remove( mlt_cache cache, cache_stripe *stripe, mlt_cache_item item )
+{
+	mlt_cache_item *bucket = &stripe->buckets[ cache_hash( item->key ) & ( stripe->bucket_count - 1 ) ];
+	while ( *bucket != item )
+		bucket = &( *bucket )->next;
+	*bucket = item->next;
+
+	if ( item->newer )
+		item->newer->older = item->older;
+	else
+		stripe->newest = item->older;
+	if ( item->older )
+		item->older->newer = item->newer;
+	else
+		stripe->oldest = item->newer;
+	stripe->count--;
+	__sync_fetch_and_sub( &cache->count, 1 );
+	item->cached = 0;
+
+	if ( item->refcount > 0 )
+	{
+		item->older = NULL;
+		item->newer = stripe->orphans;
+		if ( stripe->orphans )
+			stripe->orphans->older = item;
+		stripe->orphans = item;
+		item_release( stripe, item );
+	}
+	else
+	{
+		// Its data is gone and no handles to it are given out
+		free( item );
+	}
+}
+
+/** Drop the least recently used items of all the stripes until the cache fits.
+ *
+ * This is called without holding any stripe's lock. The stripes are compared
+ * by the stamp of their oldest item.
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param stripe_count the number of stripes to look at
+ * \param keep an item not to drop
+ */
+
+static void cache_evict( mlt_cache cache, int stripe_count, mlt_cache_item keep )
+{
+	while ( __atomic_load_n( &cache->count, __ATOMIC_RELAXED ) >
+		__atomic_load_n( &cache->size, __ATOMIC_RELAXED ) )
+	{
+		cache_stripe *victim = NULL;
+		unsigned int stamp = 0;
+		int i;
+
+		for ( i = 0; i < stripe_count; i++ )
 		{
-			mlt_log( NULL, MLT_LOG_DEBUG, "collecting garbage item %p object %p data %p refcount %d\n",
-				item, item->object, item->data, item->refcount );
-			if ( item->destructor && --item->refcount <= 0 )
+			cache_stripe *stripe = &cache->stripes[ i ];
+			pthread_mutex_lock( &stripe->mutex );
+			if ( stripe->oldest && stripe->oldest != keep &&
+				( !victim || ( int )( stripe->oldest->stamp - stamp ) < 0 ) )
 			{
-				item->destructor( item->data );
-				item->data = NULL;
-				item->destructor = NULL;
-				// We do not need the garbage-collected cache item
-				mlt_properties_set_data( cache->garbage, key, NULL, 0, NULL, NULL );
+				victim = stripe;
+				stamp = stripe->oldest->stamp;
 			}
+			pthread_mutex_unlock( &stripe->mutex );
 		}
+		if ( !victim )
+			break;
+
+		pthread_mutex_lock( &victim->mutex );
+		if ( victim->oldest && victim->oldest != keep )
+			stripe_remove( cache, victim, victim->oldest );
+		pthread_mutex_unlock( &victim->mutex );
 	}
 }
 
+/** Put data in the cache for a key, replacing what it had.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache object
+ * \param key the address of the owner, or the position of a frame
+ * \param object the object to which the data belongs
+ * \param data an opaque pointer to the data to cache
+ * \param size the size of the data in bytes
+ * \param destructor a pointer to a function that can destroy or release a reference to the data
+ */
+
+static void cache_put( mlt_cache cache, uintptr_t key, void *object, void *data, int size, mlt_destructor destructor )
+{
+	uint32_t hash = cache_hash( key );
+	cache_stripe *stripe = cache_lock_stripe( cache, hash );
+	int stripe_count = cache->stripe_count;
+
+	mlt_cache_item item = stripe_find( stripe, key, hash );
+	if ( item )
+		stripe_remove( cache, stripe, item );
+
+	item = calloc( 1, sizeof( mlt_cache_item_s ) );
+	if ( item )
+	{
+		item->key = key;
+		item->object = object;
+		item->data = data;
+		item->size = size;
+		item->destructor = destructor;
+		item->refcount = 1;
+		item->stripe = stripe;
+		if ( stripe_insert( cache, stripe, item ) )
+		{
+			free( item );
+			item = NULL;
+		}
+	}
+	if ( item )
+	{
+		mlt_log_debug( NULL, "%s: put %d = %p, %p\n", __FUNCTION__, stripe->count - 1, object, data );
+
+		// Release the least recently used, but never the new item
+		if ( stripe_count == 1 )
+			while ( cache->count > cache->size && stripe->oldest != item )
+				stripe_remove( cache, stripe, stripe->oldest );
+	}
+	pthread_mutex_unlock( &stripe->mutex );
+
+	if ( item && stripe_count > 1 )
+		cache_evict( cache, stripe_count, item );
+}
+
+/** Get the data pointer from the cache item.
+ *
+ * \public \memberof mlt_cache_s
+ * \param item a cache item
+ * \param[out] size the number of bytes pointed at, if supplied when putting the data into the cache
+ * \return the data pointer
+ */
+
+void *mlt_cache_item_data( mlt_cache_item item, int *size )
+{
+	if ( size && item )
+		*size = item->size;
+	return item? item->data : NULL;
+}
+
 /** Close a cache item.
  *
  * Release a reference and call the destructor on the data object when all
- * references are released.
+ * references are released. Close each item you got exactly once.
  *
  * \public \memberof mlt_cache_item_s
  * \param item a cache item
@@ -181,9 +432,20 @@ void mlt_cache_item_close( mlt_cache_item item )
 {
 	if ( item )
 	{
-		pthread_mutex_lock( &item->cache->mutex );
-		cache_object_close( item->cache, item->object, item->data );
-		pthread_mutex_unlock( &item->cache->mutex );
+		cache_stripe *stripe = item->stripe;
+		if ( stripe )
+		{
+			pthread_mutex_lock( &stripe->mutex );
+			item_release( stripe, item );
+			pthread_mutex_unlock( &stripe->mutex );
+		}
+		else if ( item->refcount > 0 && --item->refcount == 0 )
+		{
+			// The cache was closed before the item
+			if ( item->destructor )
+				item->destructor( item->data );
+			free( item );
+		}
 	}
 }
 
@@ -199,19 +461,19 @@ mlt_cache mlt_cache_init()
 	mlt_cache result = calloc( 1, sizeof( struct mlt_cache_s ) );
 	if ( result )
 	{
+		int i;
 		result->size = DEFAULT_CACHE_SIZE;
-		result->current = result->A;
-		pthread_mutex_init( &result->mutex, NULL );
-		result->active = mlt_properties_new();
-		result->garbage = mlt_properties_new();
+		result->stripe_count = 1;
+		for ( i = 0; i < MAX_CACHE_STRIPES; i++ )
+			pthread_mutex_init( &result->stripes[ i ].mutex, NULL );
 	}
 	return result;
 }
 
 /** Set the numer of items to cache.
  *
- * This must be called before using the cache. The size can not be more
- * than \p MAX_CACHE_SIZE.
+ * This should be called before using the cache, which is only split into
+ * stripes while it is empty. A smaller size takes effect as items are put.
  * \public \memberof mlt_cache_s
  * \param cache the cache to adjust
  * \param size the new size of the cache
@@ -219,8 +481,25 @@ mlt_cache mlt_cache_init()
 
 void mlt_cache_set_size( mlt_cache cache, int size )
 {
-	if ( size <= MAX_CACHE_SIZE )
-		cache->size = size;
+	int i, count = 0;
+
+	if ( size < 0 )
+		return;
+	for ( i = 0; i < MAX_CACHE_STRIPES; i++ )
+	{
+		pthread_mutex_lock( &cache->stripes[ i ].mutex );
+		count += cache->stripes[ i ].count;
+	}
+	if ( count == 0 )
+	{
+		int stripe_count = 1;
+		while ( stripe_count < MAX_CACHE_STRIPES && stripe_count * CACHE_STRIPE_SIZE < size )
+			stripe_count *= 2;
+		__atomic_store_n( &cache->stripe_count, stripe_count, __ATOMIC_RELAXED );
+	}
+	__atomic_store_n( &cache->size, size, __ATOMIC_RELAXED );
+	for ( i = MAX_CACHE_STRIPES - 1; i >= 0; i-- )
+		pthread_mutex_unlock( &cache->stripes[ i ].mutex );
 }
 
 /** Get the numer of possible cache items.
@@ -237,6 +516,8 @@ int mlt_cache_get_size( mlt_cache cache )
 
 /** Destroy a cache.
  *
+ * Items to which there are outstanding references are destroyed when they
+ * are closed.
  * \public \memberof mlt_cache_s
  * \param cache the cache to destroy
  */
@@ -245,15 +526,22 @@ void mlt_cache_close( mlt_cache cache )
 {
 	if ( cache )
 	{
-		while ( cache->count-- )
+		int i;
+		for ( i = 0; i < MAX_CACHE_STRIPES; i++ )
 		{
-			void *object = cache->current[ cache->count ];
-			mlt_log( NULL, MLT_LOG_DEBUG, "%s: %d = %p\n", __FUNCTION__, cache->count, object );
-			cache_object_close( cache, object, NULL );
+			cache_stripe *stripe = &cache->stripes[ i ];
+			mlt_cache_item item;
+
+			while ( stripe->newest )
+			{
+				mlt_log_debug( NULL, "%s: %d = %p\n", __FUNCTION__, stripe->count - 1, stripe->newest->object );
+				stripe_remove( cache, stripe, stripe->newest );
+			}
+			for ( item = stripe->orphans; item; item = item->newer )
+				item->stripe = NULL;
+			free( stripe->buckets );
+			pthread_mutex_destroy( &stripe->mutex );
 		}
-		mlt_properties_close( cache->active );
-		mlt_properties_close( cache->garbage );
-		pthread_mutex_destroy( &cache->mutex );
 		free( cache );
 	}
 }
@@ -267,89 +555,20 @@ void mlt_cache_close( mlt_cache cache )
 
 void mlt_cache_purge( mlt_cache cache, void *object )
 {
-	if (!cache) return;
-	pthread_mutex_lock( &cache->mutex );
-	if ( cache && object )
+	if ( cache && object && !cache->is_frames )
 	{
-		int i, j;
-		void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-		for ( i = 0, j = 0; i < cache->count; i++ )
-		{
-			void *o = cache->current[ i ];
-
-			if ( o == object )
-			{
-				cache_object_close( cache, o, NULL );
-			}
-			else
-			{
-				alt[ j++ ] = o;
-			}
-		}
-		cache->count = j;
-		cache->current = alt;
-	}
-	pthread_mutex_unlock( &cache->mutex );
-}
-
-/** Shuffle the cache entries between the two arrays and return the cache entry for an object.
- *
- * \private \memberof mlt_cache_s
- * \param cache a cache object
- * \param object the object that owns the cached data
- * \return a cache entry if there was a hit or NULL for a miss
- */
-
-static void** shuffle_get_hit( mlt_cache cache, void *object )
-{
-	int i = cache->count;
-	int j = cache->count - 1;
-	void **hit = NULL;
-	void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-	if ( cache->count > 0 && cache->count < cache->size )
-	{
-		// first determine if we have a hit
-		while ( i-- && !hit )
-		{
-			void **o = &cache->current[ i ];
-			if ( *o == object )
-				hit = o;
-		}
-		// if there was no hit, we will not be shuffling out an entry
-		// and are still filling the cache
-		if ( !hit )
-			++j;
-		// reset these
-		i = cache->count;
-		hit = NULL;
-	}
-
-	// shuffle the existing entries to the alternate array
-	while ( i-- )
-	{
-		void **o = &cache->current[ i ];
-
-		if ( !hit && *o == object )
-		{
-			hit = o;
-		}
-		else if ( j > 0 )
-		{
-			alt[ --j ] = *o;
-// 			mlt_log( NULL, MLT_LOG_DEBUG, "%s: shuffle %d = %p\n", __FUNCTION__, j, alt[j] );
-		}
+		uint32_t hash = cache_hash( ( uintptr_t )object );
+		cache_stripe *stripe = cache_lock_stripe( cache, hash );
+		mlt_cache_item item = stripe_find( stripe, ( uintptr_t )object, hash );
+		if ( item )
+			stripe_remove( cache, stripe, item );
+		pthread_mutex_unlock( &stripe->mutex );
 	}
-	return hit;
 }
 
 /** Put a chunk of data in the cache.
  *
- * This function and mlt_cache_get() are not scalable with a large volume
- * of unique \p object paramter values. Therefore, it does not make sense
- * to use it for a frame/image cache using the frame position for \p object.
- * Instead, use mlt_cache_put_frame() for that.
+ * Use mlt_cache_put_frame() rather than this to cache frames by position.
  *
  * \public \memberof mlt_cache_s
  * \param cache a cache object
@@ -361,73 +580,7 @@ static void** shuffle_get_hit( mlt_cache cache, void *object )
 
 void mlt_cache_put( mlt_cache cache, void *object, void* data, int size, mlt_destructor destructor )
 {
-	pthread_mutex_lock( &cache->mutex );
-	void **hit = shuffle_get_hit( cache, object );
-	void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-	// add the object to the cache
-	if ( hit )
-	{
-		// release the old data
-		cache_object_close( cache, *hit, NULL );
-		// the MRU end gets the updated data
-		hit = &alt[ cache->count - 1 ];
-	}
-	else if ( cache->count < cache->size )
-	{
-		// more room in cache, add it to MRU end
-		hit = &alt[ cache->count++ ];
-	}
-	else
-	{
-		// release the entry at the LRU end
-		cache_object_close( cache, cache->current[0], NULL );
-
-		// The MRU end gets the new item
-		hit = &alt[ cache->count - 1 ];
-	}
-	*hit = object;
-	mlt_log( NULL, MLT_LOG_DEBUG, "%s: put %d = %p, %p\n", __FUNCTION__, cache->count - 1, object, data );
-
-	// Fetch the cache item
-	char key[19];
-	sprintf( key, "%p", object );
-	mlt_cache_item item = mlt_properties_get_data( cache->active, key, NULL );
-	if ( !item )
-	{
-		item = calloc( 1, sizeof( mlt_cache_item_s ) );
-		if ( item )
-			mlt_properties_set_data( cache->active, key, item, 0, free, NULL );
-	}
-	if ( item )
-	{
-		// If updating the cache item but not all references are released
-		// copy the item to the garbage collection.
-		if ( item->refcount > 0 && item->data )
-		{
-			mlt_cache_item orphan = calloc( 1, sizeof( mlt_cache_item_s ) );
-			if ( orphan )
-			{
-				mlt_log( NULL, MLT_LOG_DEBUG, "adding to garbage collection object %p data %p\n", item->object, item->data );
-				*orphan = *item;
-				sprintf( key, "%p", orphan->data );
-				// We store in the garbage collection by data address, not the owner's!
-				mlt_properties_set_data( cache->garbage, key, orphan, 0, free, NULL );
-			}
-		}
-
-		// Set/update the cache item
-		item->cache = cache;
-		item->object = object;
-		item->data = data;
-		item->size = size;
-		item->destructor = destructor;
-		item->refcount = 1;
-	}
-	
-	// swap the current array
-	cache->current = alt;
-	pthread_mutex_unlock( &cache->mutex );
+	cache_put( cache, ( uintptr_t )object, object, data, size, destructor );
 }
 
 /** Get a chunk of data from the cache.
@@ -440,83 +593,23 @@ void mlt_cache_put( mlt_cache cache, void *object, void* data, int size, mlt_des
 
 mlt_cache_item mlt_cache_get( mlt_cache cache, void *object )
 {
-	mlt_cache_item result = NULL;
-	pthread_mutex_lock( &cache->mutex );
-	void **hit = shuffle_get_hit( cache, object );
-	void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-	if ( hit )
+	uint32_t hash = cache_hash( ( uintptr_t )object );
+	cache_stripe *stripe = cache_lock_stripe( cache, hash );
+	mlt_cache_item result = stripe_find( stripe, ( uintptr_t )object, hash );
+	if ( result && result->refcount > 0 )
 	{
-		// copy the hit to the MRU end
-		alt[ cache->count - 1 ] = *hit;
-		hit = &alt[ cache->count - 1 ];
-
-		char key[19];
-		sprintf( key, "%p", *hit );
-		result = mlt_properties_get_data( cache->active, key, NULL );
-		if ( result && result->data )
-		{
-			result->refcount++;
-			mlt_log( NULL, MLT_LOG_DEBUG, "%s: get %d = %p, %p\n", __FUNCTION__, cache->count - 1, *hit, result->data );
-		}
-
-		// swap the current array
-		cache->current = alt;
+		stripe_touch( cache, stripe, result, 1 );
+		result->refcount++;
+		mlt_log_debug( NULL, "%s: get %p, %p\n", __FUNCTION__, object, result->data );
 	}
-	pthread_mutex_unlock( &cache->mutex );
-	
-	return result;
-}
-
-/** Shuffle the cache entries between the two arrays and return the frame for a position.
- *
- * \private \memberof mlt_cache_s
- * \param cache a cache object
- * \param position the position of the frame that you want
- * \return a frame if there was a hit or NULL for a miss
- */
-
-static mlt_frame* shuffle_get_frame( mlt_cache cache, mlt_position position )
-{
-	int i = cache->count;
-	int j = cache->count - 1;
-	mlt_frame *hit = NULL;
-	mlt_frame *alt = (mlt_frame*) ( cache->current == cache->A ? cache->B : cache->A );
-
-	if ( cache->count > 0 && cache->count < cache->size )
+	else
 	{
-		// first determine if we have a hit
-		while ( i-- && !hit )
-		{
-			mlt_frame *o = (mlt_frame*) &cache->current[ i ];
-			if ( mlt_frame_original_position( *o ) == position )
-				hit = o;
-		}
-		// if there was no hit, we will not be shuffling out an entry
-		// and are still filling the cache
-		if ( !hit )
-			++j;
-		// reset these
-		i = cache->count;
-		hit = NULL;
+		// Its data was released by closing it too often
+		result = NULL;
 	}
+	pthread_mutex_unlock( &stripe->mutex );
 
-	// shuffle the existing entries to the alternate array
-	while ( i-- )
-	{
-		mlt_frame *o = (mlt_frame*) &cache->current[ i ];
-
-		if ( !hit && mlt_frame_original_position( *o ) == position )
-		{
-			hit = o;
-		}
-		else if ( j > 0 )
-		{
-			alt[ --j ] = *o;
-// 			mlt_log( NULL, MLT_LOG_DEBUG, "%s: shuffle %d = %p\n", __FUNCTION__, j, alt[j] );
-		}
-	}
-	return hit;
+	return result;
 }
 
 /** Put a frame in the cache.
@@ -534,38 +627,9 @@ static mlt_frame* shuffle_get_frame( mlt_cache cache, mlt_position position )
 
 void mlt_cache_put_frame( mlt_cache cache, mlt_frame frame )
 {
-	pthread_mutex_lock( &cache->mutex );
-	mlt_frame *hit = shuffle_get_frame( cache, mlt_frame_original_position( frame ) );
-	mlt_frame *alt = (mlt_frame*) ( cache->current == cache->A ? cache->B : cache->A );
-
-	// add the frame to the cache
-	if ( hit )
-	{
-		// release the old data
-		mlt_frame_close( *hit );
-		// the MRU end gets the updated data
-		hit = &alt[ cache->count - 1 ];
-	}
-	else if ( cache->count < cache->size )
-	{
-		// more room in cache, add it to MRU end
-		hit = &alt[ cache->count++ ];
-	}
-	else
-	{
-		// release the entry at the LRU end
-		mlt_frame_close( cache->current[0] );
-
-		// The MRU end gets the new item
-		hit = &alt[ cache->count - 1 ];
-	}
-	*hit = mlt_frame_clone( frame, 1 );
-	mlt_log( NULL, MLT_LOG_DEBUG, "%s: put %d = %p\n", __FUNCTION__, cache->count - 1, frame );
-
-	// swap the current array
-	cache->current = (void**) alt;
+	mlt_position position = mlt_frame_original_position( frame );
 	cache->is_frames = 1;
-	pthread_mutex_unlock( &cache->mutex );
+	cache_put( cache, ( uintptr_t )position, NULL, mlt_frame_clone( frame, 1 ), 0, ( mlt_destructor )mlt_frame_close );
 }
 
 /** Get a frame from the cache.
@@ -582,23 +646,16 @@ void mlt_cache_put_frame( mlt_cache cache, mlt_frame frame )
 mlt_frame mlt_cache_get_frame( mlt_cache cache, mlt_position position )
 {
 	mlt_frame result = NULL;
-	pthread_mutex_lock( &cache->mutex );
-	mlt_frame *hit = shuffle_get_frame( cache, position );
-	mlt_frame *alt = (mlt_frame*) ( cache->current == cache->A ? cache->B : cache->A );
-
-	if ( hit )
+	uint32_t hash = cache_hash( ( uintptr_t )position );
+	cache_stripe *stripe = cache_lock_stripe( cache, hash );
+	mlt_cache_item item = stripe_find( stripe, ( uintptr_t )position, hash );
+	if ( item && item->data )
 	{
-		// copy the hit to the MRU end
-		alt[ cache->count - 1 ] = *hit;
-		hit = &alt[ cache->count - 1 ];
-
-		result = mlt_frame_clone( *hit, 1 );
-		mlt_log( NULL, MLT_LOG_DEBUG, "%s: get %d = %p\n", __FUNCTION__, cache->count - 1, *hit );
-
-		// swap the current array
-		cache->current = (void**) alt;
+		stripe_touch( cache, stripe, item, 1 );
+		result = mlt_frame_clone( item->data, 1 );
+		mlt_log_debug( NULL, "%s: get %d = %p\n", __FUNCTION__, position, item->data );
 	}
-	pthread_mutex_unlock( &cache->mutex );
+	pthread_mutex_unlock( &stripe->mutex );
 
 	return result;
 }
@@ -25,6 +25,13 @@
 
 #include "mlt_types.h"
 
+/* Each item got from mlt_cache_get() or mlt_service_cache_get() must be closed
+ * exactly once. An item that has left the cache is freed when its last
+ * reference is closed, so closing it again is a use after free. Clear or
+ * replace a stored item when closing it, and do not share a stored item
+ * between threads without a lock.
+ */
+
 extern void *mlt_cache_item_data( mlt_cache_item item, int *size );
 extern void mlt_cache_item_close( mlt_cache_item item );
 
@@ -26,6 +26,11 @@
 #include "mlt_frame.h"
 #include "mlt_profile.h"
 #include "mlt_log.h"
+#include "mlt_parser.h"
+#include "mlt_playlist.h"
+#include "mlt_tractor.h"
+#include "mlt_multitrack.h"
+#include "mlt_transition.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -497,6 +502,70 @@ static void set_image_format( mlt_consumer self )
 	}
 }
 
+static int prepare_producer( mlt_parser parser, mlt_producer object )
+{
+	mlt_service_prepare( MLT_PRODUCER_SERVICE( object ) );
+	return 0;
+}
+
+static int prepare_playlist( mlt_parser parser, mlt_playlist object )
+{
+	mlt_service_prepare( MLT_PLAYLIST_SERVICE( object ) );
+	return 0;
+}
+
+static int prepare_tractor( mlt_parser parser, mlt_tractor object )
+{
+	mlt_service_prepare( MLT_TRACTOR_SERVICE( object ) );
+	return 0;
+}
+
+static int prepare_multitrack( mlt_parser parser, mlt_multitrack object )
+{
+	mlt_service_prepare( MLT_MULTITRACK_SERVICE( object ) );
+	return 0;
+}
+
+static int prepare_filter( mlt_parser parser, mlt_filter object )
+{
+	mlt_service_prepare( MLT_FILTER_SERVICE( object ) );
+	return 0;
+}
+
+static int prepare_transition( mlt_parser parser, mlt_transition object )
+{
+	mlt_service_prepare( MLT_TRANSITION_SERVICE( object ) );
+	return 0;
+}
+
+/** Prepare the services connected to a consumer for rendering.
+ *
+ * This walks the service graph once to make the render plans that would
+ * otherwise be made while fetching the first frame.
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \see mlt_service_prepare
+ */
+
+static void prepare_services( mlt_consumer self )
+{
+	mlt_service producer = mlt_service_producer( MLT_CONSUMER_SERVICE( self ) );
+	mlt_parser parser = producer != NULL ? mlt_parser_new( ) : NULL;
+
+	if ( parser != NULL )
+	{
+		parser->on_start_producer = prepare_producer;
+		parser->on_start_playlist = prepare_playlist;
+		parser->on_start_tractor = prepare_tractor;
+		parser->on_start_multitrack = prepare_multitrack;
+		parser->on_start_filter = prepare_filter;
+		parser->on_start_transition = prepare_transition;
+		mlt_parser_start( parser, producer );
+		mlt_parser_close( parser );
+	}
+	mlt_service_prepare( MLT_CONSUMER_SERVICE( self ) );
+}
+
 /** Start the consumer.
  *
  * \public \memberof mlt_consumer_s
@@ -596,6 +665,9 @@ int mlt_consumer_start( mlt_consumer self )
 		consumer_read_ahead_start( self );
 #endif
 
+	// Make the render plans of the services to be rendered
+	prepare_services( self );
+
 	// Start the service
 	if ( self->start != NULL )
 		error = self->start( self );
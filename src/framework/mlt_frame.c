@@ -29,6 +29,153 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+/* Frame recycling
+ *
+ * Closed frames keep their property storage and stacks and are handed out
+ * again by mlt_frame_init(). Each thread keeps a few of them, and a shared
+ * pool takes the rest from threads that close more frames than they create.
+ * Recycling starts once the factory is initialised, which also releases the
+ * shared pool when it closes.
+ */
+
+#define FRAME_CACHE_SIZE 8
+#define FRAME_POOL_SIZE 64
+
+typedef struct
+{
+	int count;
+	mlt_frame frames[ FRAME_CACHE_SIZE ];
+} frame_cache;
+
+static struct
+{
+	pthread_mutex_t mutex;
+	pthread_key_t key;
+	int enabled;
+	int count;
+	mlt_frame frames[ FRAME_POOL_SIZE ];
+	int created;
+	int recycled;
+} frame_pool = { PTHREAD_MUTEX_INITIALIZER };
+
+static pthread_once_t frame_pool_once = PTHREAD_ONCE_INIT;
+
+static void frame_free( mlt_frame self )
+{
+	mlt_deque_close( self->stack_image );
+	mlt_deque_close( self->stack_audio );
+	mlt_deque_close( self->stack_service );
+	mlt_properties_close( &self->parent );
+	free( self );
+}
+
+/** Give the frames of an exiting thread to the shared pool.
+*/
+
+static void frame_cache_close( void *data )
+{
+	frame_cache *cache = data;
+	pthread_mutex_lock( &frame_pool.mutex );
+	while ( cache->count > 0 )
+	{
+		mlt_frame frame = cache->frames[ -- cache->count ];
+		if ( frame_pool.enabled && frame_pool.count < FRAME_POOL_SIZE )
+			frame_pool.frames[ frame_pool.count ++ ] = frame;
+		else
+			frame_free( frame );
+	}
+	pthread_mutex_unlock( &frame_pool.mutex );
+	free( cache );
+}
+
+static void frame_pool_init( void )
+{
+	pthread_key_create( &frame_pool.key, frame_cache_close );
+}
+
+static frame_cache *frame_cache_get( void )
+{
+	pthread_once( &frame_pool_once, frame_pool_init );
+	frame_cache *cache = pthread_getspecific( frame_pool.key );
+	if ( cache == NULL )
+	{
+		cache = calloc( 1, sizeof( frame_cache ) );
+		pthread_setspecific( frame_pool.key, cache );
+	}
+	return cache;
+}
+
+/** Release the shared pool and the calling thread's frames when the factory closes.
+*/
+
+static void frame_pool_close( void *unused )
+{
+	frame_cache *cache = frame_cache_get( );
+	pthread_mutex_lock( &frame_pool.mutex );
+	frame_pool.enabled = 0;
+	while ( cache != NULL && cache->count > 0 )
+		frame_free( cache->frames[ -- cache->count ] );
+	while ( frame_pool.count > 0 )
+		frame_free( frame_pool.frames[ -- frame_pool.count ] );
+	mlt_log( NULL, MLT_LOG_VERBOSE, "%s: frames %d, recycled %d\n", __FUNCTION__,
+		frame_pool.created + frame_pool.recycled, frame_pool.recycled );
+	frame_pool.created = frame_pool.recycled = 0;
+	pthread_mutex_unlock( &frame_pool.mutex );
+}
+
+/** Get a closed frame to initialise again, or NULL if there is none.
+*/
+
+static mlt_frame frame_reuse( void )
+{
+	frame_cache *cache = frame_cache_get( );
+	if ( cache == NULL )
+		return NULL;
+	if ( cache->count == 0 )
+	{
+		pthread_mutex_lock( &frame_pool.mutex );
+		if ( !frame_pool.enabled && mlt_global_properties( ) )
+		{
+			mlt_factory_register_for_clean_up( &frame_pool, frame_pool_close );
+			frame_pool.enabled = 1;
+		}
+		while ( frame_pool.count > 0 && cache->count < FRAME_CACHE_SIZE / 2 )
+			cache->frames[ cache->count ++ ] = frame_pool.frames[ -- frame_pool.count ];
+		pthread_mutex_unlock( &frame_pool.mutex );
+	}
+	if ( cache->count == 0 )
+	{
+		__sync_fetch_and_add( &frame_pool.created, 1 );
+		return NULL;
+	}
+	__sync_fetch_and_add( &frame_pool.recycled, 1 );
+	return cache->frames[ -- cache->count ];
+}
+
+/** Keep a frame that was reset for reuse.
+ *
+ * \return true if the frame was kept
+ */
+
+static int frame_recycle( mlt_frame self )
+{
+	frame_cache *cache = frame_cache_get( );
+	if ( cache == NULL || !frame_pool.enabled )
+		return 0;
+	if ( cache->count == FRAME_CACHE_SIZE )
+	{
+		pthread_mutex_lock( &frame_pool.mutex );
+		while ( frame_pool.count < FRAME_POOL_SIZE && cache->count > FRAME_CACHE_SIZE / 2 )
+			frame_pool.frames[ frame_pool.count ++ ] = cache->frames[ -- cache->count ];
+		pthread_mutex_unlock( &frame_pool.mutex );
+		if ( cache->count == FRAME_CACHE_SIZE )
+			return 0;
+	}
+	cache->frames[ cache->count ++ ] = self;
+	return 1;
+}
 
 /** Construct a frame object.
  *
@@ -39,16 +186,35 @@
 
 mlt_frame mlt_frame_init( mlt_service service )
 {
-	// Allocate a frame
-	mlt_frame self = calloc( 1, sizeof( struct mlt_frame_s ) );
+	// Reuse a closed frame or allocate one
+	mlt_frame self = frame_reuse( );
 
 	if ( self != NULL )
 	{
-		mlt_profile profile = mlt_service_profile( service );
-
+		// Its properties and stacks are already empty
+		mlt_properties_inc_ref( &self->parent );
+		self->parent.close = NULL;
+		self->parent.close_object = NULL;
+		self->get_alpha_mask = NULL;
+		self->convert_image = NULL;
+		self->convert_audio = NULL;
+		self->is_processing = 0;
+	}
+	else if ( ( self = calloc( 1, sizeof( struct mlt_frame_s ) ) ) != NULL )
+	{
 		// Initialise the properties
+		mlt_properties_init( &self->parent, self );
+
+		// Construct stacks for frames and methods
+		self->stack_image = mlt_deque_init( );
+		self->stack_audio = mlt_deque_init( );
+		self->stack_service = mlt_deque_init( );
+	}
+
+	if ( self != NULL )
+	{
+		mlt_profile profile = mlt_service_profile( service );
 		mlt_properties properties = &self->parent;
-		mlt_properties_init( properties, self );
 
 		// Set default properties on the frame
 		mlt_properties_set_position( properties, "_position", 0.0 );
@@ -58,11 +224,6 @@ mlt_frame mlt_frame_init( mlt_service service )
 		mlt_properties_set_double( properties, "aspect_ratio", mlt_profile_sar( NULL ) );
 		mlt_properties_set_data( properties, "audio", NULL, 0, NULL, NULL );
 		mlt_properties_set_data( properties, "alpha", NULL, 0, NULL, NULL );
-
-		// Construct stacks for frames and methods
-		self->stack_image = mlt_deque_init( );
-		self->stack_audio = mlt_deque_init( );
-		self->stack_service = mlt_deque_init( );
 	}
 
 	return self;
@@ -973,13 +1134,27 @@ void mlt_frame_close( mlt_frame self )
 {
 	if ( self != NULL && mlt_properties_dec_ref( MLT_FRAME_PROPERTIES( self ) ) <= 0 )
 	{
-		mlt_deque_close( self->stack_image );
-		mlt_deque_close( self->stack_audio );
+		// Unless someone else owns the properties, empty the frame but keep
+		// its storage for the next one
+		if ( self->parent.close == NULL )
+		{
+			while ( mlt_deque_count( self->stack_image ) )
+				mlt_deque_pop_back( self->stack_image );
+			while ( mlt_deque_count( self->stack_audio ) )
+				mlt_deque_pop_back( self->stack_audio );
+			while( mlt_deque_peek_back( self->stack_service ) )
+				mlt_service_close( mlt_deque_pop_back( self->stack_service ) );
+			while ( mlt_deque_count( self->stack_service ) )
+				mlt_deque_pop_back( self->stack_service );
+			mlt_properties_reset( &self->parent );
+
+			if ( frame_recycle( self ) )
+				return;
+		}
+
 		while( mlt_deque_peek_back( self->stack_service ) )
 			mlt_service_close( mlt_deque_pop_back( self->stack_service ) );
-		mlt_deque_close( self->stack_service );
-		mlt_properties_close( &self->parent );
-		free( self );
+		frame_free( self );
 	}
 }
 
@@ -1084,6 +1259,91 @@ mlt_properties mlt_frame_unique_properties( mlt_frame self, mlt_service service
 	return instance_props;
 }
 
+/** Compute a cheap fingerprint of an audio buffer.
+ *
+ * This identifies the samples an analysis result was computed from.
+ */
+
+static uint64_t audio_fingerprint( const void *audio, int size )
+{
+	const uint8_t *p = audio;
+	uint64_t hash = 14695981039346656037ULL;
+	int i = 0;
+
+	// FNV-1a over 64-bit words, then the remaining bytes
+	for ( ; i + 8 <= size; i += 8 )
+	{
+		uint64_t word;
+		memcpy( &word, p + i, 8 );
+		hash = ( hash ^ word ) * 1099511628211ULL;
+	}
+	for ( ; i < size; i++ )
+		hash = ( hash ^ p[ i ] ) * 1099511628211ULL;
+
+	return hash ^ size;
+}
+
+/** Get a shared audio analysis result.
+ *
+ * Audio analysis filters (spectra, levels and so on) publish their
+ * results on the frame so that other filters asking for the same analysis
+ * of the same samples can reuse them instead of computing them again.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param name the analysis type and its parameters, for example "fft.2048"
+ * \param audio the samples the analysis is of
+ * \param size the size of \p audio in bytes
+ * \param[out] length the length of the result in bytes (optional)
+ * \return the result or NULL if it has not been computed for these samples
+ * \see mlt_frame_set_analysis
+ */
+
+void *mlt_frame_get_analysis( mlt_frame self, const char *name, const void *audio, int size, int *length )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	char key[ 256 ];
+	void *data;
+
+	snprintf( key, sizeof( key ), "_analysis.%s", name );
+	data = mlt_properties_get_data( properties, key, length );
+	if ( data )
+	{
+		snprintf( key, sizeof( key ), "_analysis.%s.source", name );
+		if ( (uint64_t) mlt_properties_get_int64( properties, key ) != audio_fingerprint( audio, size ) )
+			data = NULL;
+	}
+	return data;
+}
+
+/** Publish a shared audio analysis result.
+ *
+ * The frame takes ownership of the result, which remains valid until the
+ * frame is closed or the result is replaced.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param name the analysis type and its parameters
+ * \param audio the samples the analysis is of
+ * \param size the size of \p audio in bytes
+ * \param data the result
+ * \param length the length of the result in bytes
+ * \param destroy a function to release the result
+ * \return true if error
+ * \see mlt_frame_get_analysis
+ */
+
+int mlt_frame_set_analysis( mlt_frame self, const char *name, const void *audio, int size, void *data, int length, mlt_destructor destroy )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	char key[ 256 ];
+
+	snprintf( key, sizeof( key ), "_analysis.%s.source", name );
+	mlt_properties_set_int64( properties, key, (int64_t) audio_fingerprint( audio, size ) );
+	snprintf( key, sizeof( key ), "_analysis.%s", name );
+	return mlt_properties_set_data( properties, key, data, length, destroy, NULL );
+}
+
 /** Make a copy of a frame.
  *
  * This does not copy the get_image/get_audio processing stacks or any
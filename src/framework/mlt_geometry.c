@@ -28,20 +28,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-/** private part of geometry animation item (deprecated)
- * \deprecated use mlt_animation_s instead
- */
-
-typedef struct geometry_item_s
-{
-	struct mlt_geometry_item_s data;
-	struct geometry_item_s *next, *prev;
-}
-*geometry_item;
+#include <stdint.h>
 
 /** private part of geometry object (deprecated)
  * \deprecated use mlt_animation_s instead
+ *
+ * The keys are kept in a packed array sorted by frame.
  */
 
 typedef struct
@@ -50,7 +42,9 @@ typedef struct
 	int length;
 	int nw;
 	int nh;
-	geometry_item item;
+	struct mlt_geometry_item_s *items;
+	int count;
+	int size;
 }
 geometry_s, *geometry;
 
@@ -85,115 +79,112 @@ static inline double linearstep( double start, double end, double position, int
 	return start + position * o;
 }
 
+/** Find the last key at or before a position.
+ *
+ * \return the index of the key or -1 if the position precedes all keys
+ */
+
+static int geometry_find( geometry g, double position )
+{
+	int low = 0;
+	int high = g->count - 1;
+	int result = -1;
+
+	while ( low <= high )
+	{
+		int mid = ( low + high ) / 2;
+		if ( position >= g->items[ mid ].frame )
+		{
+			result = mid;
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+	return result;
+}
+
+static inline void set_all_fixed( mlt_geometry_item item )
+{
+	item->f[0] = 1;
+	item->f[1] = 1;
+	item->f[2] = 1;
+	item->f[3] = 1;
+	item->f[4] = 1;
+}
+
+static inline float *item_value( mlt_geometry_item item, int i )
+{
+	switch( i )
+	{
+		case 0: return &item->x;
+		case 1: return &item->y;
+		case 2: return &item->w;
+		case 3: return &item->h;
+		default: return &item->mix;
+	}
+}
+
 void mlt_geometry_interpolate( mlt_geometry self )
 {
 	geometry g = self->local;
+	int i, n;
 
 	// Parse of all items to ensure unspecified keys are calculated correctly
-	if ( g->item != NULL )
+	for ( i = 0; i < 5; i ++ )
 	{
-		int i = 0;
-		for ( i = 0; i < 5; i ++ )
+		int prev = -1;
+		int next = 0;
+
+		for ( n = 0; n < g->count; n ++ )
 		{
-			geometry_item current = g->item;
-			while( current != NULL )
+			mlt_geometry_item current = &g->items[ n ];
+
+			if ( !current->f[ i ] )
 			{
-				int fixed = current->data.f[ i ];
-				if ( !fixed )
+				// Advance to the next fixed key after this one
+				if ( next <= n )
+					next = n + 1;
+				while ( next < g->count && !g->items[ next ].f[ i ] )
+					next ++;
+
+				// This should never happen
+				if ( prev < 0 )
 				{
-					geometry_item prev = current->prev;
-					geometry_item next = current->next;
-
-					double prev_value = 0;
-					double next_value = 0;
-					double value = 0;
-
-					while( prev != NULL && !prev->data.f[ i ] ) prev = prev->prev;
-					while( next != NULL && !next->data.f[ i ] ) next = next->next;
-
-					switch( i )
-					{
-						case 0:
-							if ( prev ) prev_value = prev->data.x;
-							if ( next ) next_value = next->data.x;
-							break;
-						case 1:
-							if ( prev ) prev_value = prev->data.y;
-							if ( next ) next_value = next->data.y;
-							break;
-						case 2:
-							if ( prev ) prev_value = prev->data.w;
-							if ( next ) next_value = next->data.w;
-							break;
-						case 3:
-							if ( prev ) prev_value = prev->data.h;
-							if ( next ) next_value = next->data.h;
-							break;
-						case 4:
-							if ( prev ) prev_value = prev->data.mix;
-							if ( next ) next_value = next->data.mix;
-							break;
-					}
-
-					// This should never happen
-					if ( prev == NULL )
-						current->data.f[ i ] = 1;
-					else if ( next == NULL )
-						value = prev_value;
-					else 
-						value = linearstep( prev_value, next_value, current->data.frame - prev->data.frame, next->data.frame - prev->data.frame );
-
-					switch( i )
-					{
-						case 0: current->data.x = value; break;
-						case 1: current->data.y = value; break;
-						case 2: current->data.w = value; break;
-						case 3: current->data.h = value; break;
-						case 4: current->data.mix = value; break;
-					}
+					current->f[ i ] = 1;
+					*item_value( current, i ) = 0;
+				}
+				else if ( next >= g->count )
+				{
+					*item_value( current, i ) = *item_value( &g->items[ prev ], i );
+				}
+				else
+				{
+					mlt_geometry_item p = &g->items[ prev ];
+					mlt_geometry_item q = &g->items[ next ];
+					*item_value( current, i ) = linearstep( *item_value( p, i ), *item_value( q, i ),
+						current->frame - p->frame, q->frame - p->frame );
 				}
-
-				// Move to the next item
-				current = current->next;
 			}
+
+			if ( current->f[ i ] )
+				prev = n;
 		}
 	}
 }
 
-static int mlt_geometry_drop( mlt_geometry self, geometry_item item )
+static int mlt_geometry_drop( mlt_geometry self, int index )
 {
 	geometry g = self->local;
 
-	if ( item == g->item )
-	{
-		g->item = item->next;
-		if ( g->item != NULL )
-			g->item->prev = NULL;
-		// To ensure correct seeding, ensure all values are fixed
-		if ( g->item != NULL )
-		{
-			g->item->data.f[0] = 1;
-			g->item->data.f[1] = 1;
-			g->item->data.f[2] = 1;
-			g->item->data.f[3] = 1;
-			g->item->data.f[4] = 1;
-		}
-	}
-	else if ( item->next != NULL && item->prev != NULL )
-	{
-		item->prev->next = item->next;
-		item->next->prev = item->prev;
-	}
-	else if ( item->next != NULL )
-	{
-		item->next->prev = item->prev;
-	}
-	else if ( item->prev != NULL )
-	{
-		item->prev->next = item->next;
-	}
+	g->count --;
+	memmove( &g->items[ index ], &g->items[ index + 1 ], ( g->count - index ) * sizeof( struct mlt_geometry_item_s ) );
 
-	free( item );
+	// To ensure correct seeding, ensure all values are fixed
+	if ( index == 0 && g->count > 0 )
+		set_all_fixed( &g->items[ 0 ] );
 
 	return 0;
 }
@@ -203,8 +194,7 @@ static void mlt_geometry_clean( mlt_geometry self )
 	geometry g = self->local;
 	free( g->data );
 	g->data = NULL;
-	while( g->item )
-		mlt_geometry_drop( self, g->item );
+	g->count = 0;
 }
 
 // Parse the geometry specification for a given length and normalised width/height (-1 for default)
@@ -404,29 +394,27 @@ int mlt_geometry_fetch( mlt_geometry self, mlt_geometry_item item, float positio
 	geometry g = self->local;
 
 	// Need to find the nearest key to the position specifed
-	geometry_item key = g->item;
-
-	// Iterate through the keys until we reach last or have 
-	while( key != NULL && key->next != NULL && position >= key->next->data.frame )
-		key = key->next;
+	int index = geometry_find( g, position );
+	mlt_geometry_item key = g->count ? &g->items[ index < 0 ? 0 : index ] : NULL;
+	mlt_geometry_item next = ( key && index + 1 < g->count && index >= 0 ) ? &g->items[ index + 1 ] : NULL;
 
 	if ( key != NULL )
 	{
 		// Position is situated before the first key - all zeroes
-		if ( position < key->data.frame )
+		if ( position < key->frame )
 		{
 			memset( item, 0, sizeof( struct mlt_geometry_item_s ) );
 			item->mix = 100;
 		}
 		// Position is a key itself - no iterpolation need
-		else if ( position == key->data.frame )
+		else if ( position == key->frame )
 		{
-			memcpy( item, &key->data, sizeof( struct mlt_geometry_item_s ) );
+			memcpy( item, key, sizeof( struct mlt_geometry_item_s ) );
 		}
 		// Position is after the last key - no interpolation, but not a key frame
-		else if ( key->next == NULL )
+		else if ( next == NULL )
 		{
-			memcpy( item, &key->data, sizeof( struct mlt_geometry_item_s ) );
+			memcpy( item, key, sizeof( struct mlt_geometry_item_s ) );
 			item->key = 0;
 			item->f[ 0 ] = 0;
 			item->f[ 1 ] = 0;
@@ -439,14 +427,14 @@ int mlt_geometry_fetch( mlt_geometry self, mlt_geometry_item item, float positio
 		{
 			item->key = 0;
 			item->frame = position;
-			position -= key->data.frame;
-			item->x = linearstep( key->data.x, key->next->data.x, position, key->next->data.frame - key->data.frame );
-			item->y = linearstep( key->data.y, key->next->data.y, position, key->next->data.frame - key->data.frame );
-			item->w = linearstep( key->data.w, key->next->data.w, position, key->next->data.frame - key->data.frame );
-			item->h = linearstep( key->data.h, key->next->data.h, position, key->next->data.frame - key->data.frame );
-			item->mix = linearstep( key->data.mix, key->next->data.mix, position, key->next->data.frame - key->data.frame );
-			item->distort = key->data.distort;
-			position += key->data.frame;
+			position -= key->frame;
+			item->x = linearstep( key->x, next->x, position, next->frame - key->frame );
+			item->y = linearstep( key->y, next->y, position, next->frame - key->frame );
+			item->w = linearstep( key->w, next->w, position, next->frame - key->frame );
+			item->h = linearstep( key->h, next->h, position, next->frame - key->frame );
+			item->mix = linearstep( key->mix, next->mix, position, next->frame - key->frame );
+			item->distort = key->distort;
+			position += key->frame;
 		}
 
 		item->frame = position;
@@ -467,59 +455,38 @@ int mlt_geometry_insert( mlt_geometry self, mlt_geometry_item item )
 	// Get the local/private geometry structure
 	geometry g = self->local;
 
-	// Create a new local item (this may be removed if a key already exists at self position)
-	geometry_item gi = calloc( 1, sizeof( struct geometry_item_s ) );
-	memcpy( &gi->data, item, sizeof( struct mlt_geometry_item_s ) );
-	gi->data.key = 1;
+	// Locate the key at or before this position (appending is the common case)
+	int index = g->count && item->frame > g->items[ g->count - 1 ].frame ? g->count - 1 : geometry_find( g, item->frame );
 
-	// Determine if we need to insert or append to the list, or if it's a new list
-	if ( g->item != NULL )
+	// Replace an existing key at this position
+	if ( index >= 0 && g->items[ index ].frame == item->frame )
 	{
-		// Get the first item
-		geometry_item place = g->item;
-
-		// Locate an existing nearby item
-		while ( place->next != NULL && item->frame > place->data.frame )
-			place = place->next;
-
-		if ( item->frame < place->data.frame )
-		{
-			if ( place == g->item )
-				g->item = gi;
-			if ( place->prev )
-				place->prev->next = gi;
-			gi->next = place;
-			gi->prev = place->prev;
-			place->prev = gi;
-		}
-		else if ( item->frame > place->data.frame )
-		{
-			if ( place->next )
-				place->next->prev = gi;
-			gi->next = place->next;
-			gi->prev = place;
-			place->next = gi;
-		}
-		else
-		{
-			memcpy( &place->data, &gi->data, sizeof( struct mlt_geometry_item_s ) );
-			free( gi );
-		}
+		memcpy( &g->items[ index ], item, sizeof( struct mlt_geometry_item_s ) );
+		g->items[ index ].key = 1;
+		return 0;
 	}
-	else
+
+	// Make room for a new key
+	if ( g->count == g->size )
 	{
-		// Set the first item
-		g->item = gi;
-
-		// To ensure correct seeding, ensure all values are fixed
-		g->item->data.f[0] = 1;
-		g->item->data.f[1] = 1;
-		g->item->data.f[2] = 1;
-		g->item->data.f[3] = 1;
-		g->item->data.f[4] = 1;
+		int size = g->size ? g->size * 2 : 16;
+		struct mlt_geometry_item_s *items = realloc( g->items, size * sizeof( struct mlt_geometry_item_s ) );
+		if ( items == NULL )
+			return 1;
+		g->items = items;
+		g->size = size;
 	}
 
-	// TODO: Error checking
+	index ++;
+	memmove( &g->items[ index + 1 ], &g->items[ index ], ( g->count - index ) * sizeof( struct mlt_geometry_item_s ) );
+	memcpy( &g->items[ index ], item, sizeof( struct mlt_geometry_item_s ) );
+	g->items[ index ].key = 1;
+	g->count ++;
+
+	// To ensure correct seeding, ensure all values are fixed
+	if ( g->count == 1 )
+		set_all_fixed( &g->items[ 0 ] );
+
 	return 0;
 }
 
@@ -531,14 +498,10 @@ int mlt_geometry_remove( mlt_geometry self, int position )
 	// Get the local/private geometry structure
 	geometry g = self->local;
 
-	// Get the first item
-	geometry_item place = g->item;
-
-	while( place != NULL && position != place->data.frame )
-		place = place->next;
+	int index = geometry_find( g, position );
 
-	if ( place != NULL && position == place->data.frame )
-		ret = mlt_geometry_drop( self, place );
+	if ( index >= 0 && position == g->items[ index ].frame )
+		ret = mlt_geometry_drop( self, index );
 
 	return ret;
 }
@@ -549,16 +512,16 @@ int mlt_geometry_next_key( mlt_geometry self, mlt_geometry_item item, int positi
 	// Get the local/private geometry structure
 	geometry g = self->local;
 
-	// Get the first item
-	geometry_item place = g->item;
+	// Get the last key before the position, then step forward if needed
+	int index = geometry_find( g, position );
 
-	while( place != NULL && position > place->data.frame )
-		place = place->next;
+	if ( index < 0 || g->items[ index ].frame < position )
+		index ++;
 
-	if ( place != NULL )
-		memcpy( item, &place->data, sizeof( struct mlt_geometry_item_s ) );
+	if ( index < g->count )
+		memcpy( item, &g->items[ index ], sizeof( struct mlt_geometry_item_s ) );
 
-	return place == NULL;
+	return index >= g->count;
 }
 
 // Get the key at the position or the previous key
@@ -567,16 +530,16 @@ int mlt_geometry_prev_key( mlt_geometry self, mlt_geometry_item item, int positi
 	// Get the local/private geometry structure
 	geometry g = self->local;
 
-	// Get the first item
-	geometry_item place = g->item;
+	int index = geometry_find( g, position );
 
-	while( place != NULL && place->next != NULL && position >= place->next->data.frame )
-		place = place->next;
+	// Positions before the first key yield the first key
+	if ( index < 0 && g->count > 0 )
+		index = 0;
 
-	if ( place != NULL )
-		memcpy( item, &place->data, sizeof( struct mlt_geometry_item_s ) );
+	if ( index >= 0 )
+		memcpy( item, &g->items[ index ], sizeof( struct mlt_geometry_item_s ) );
 
-	return place == NULL;
+	return index < 0;
 }
 
 char *mlt_geometry_serialise_cut( mlt_geometry self, int in, int out )
@@ -612,7 +575,7 @@ char *mlt_geometry_serialise_cut( mlt_geometry self, int in, int out )
 
 				// If the first key is larger than the current position
 				// then do nothing here
-				if ( g->item->data.frame > item.frame )
+				if ( g->items[ 0 ].frame > item.frame )
 				{
 					item.frame ++;
 					continue;
@@ -663,21 +626,20 @@ char *mlt_geometry_serialise_cut( mlt_geometry self, int in, int out )
 				sprintf( temp + strlen( temp ), "%g", item.mix );
 			}
 
-			if ( used + strlen( temp ) + 2 > size ) // +2 for ';' and NULL
+			int length = strlen( temp );
+			if ( used + length + 2 > size ) // +2 for ';' and NULL
 			{
-				size += 1000;
+				size = ( used + length + 2 ) * 2;
 				ret = realloc( ret, size );
 			}
 
+			// Append at the known end rather than rescanning the string
 			if ( ret != NULL && used != 0 )
-			{
-				used ++;
-				strcat( ret, ";" );
-			}
+				ret[ used ++ ] = ';';
 			if ( ret != NULL )
 			{
-				used += strlen( temp );
-				strcat( ret, temp );
+				memcpy( ret + used, temp, length + 1 );
+				used += length;
 			}
 
 			item.frame ++;
@@ -700,12 +662,181 @@ char *mlt_geometry_serialise( mlt_geometry self )
 	return strdup( ret );
 }
 
+/** The version of the block made by mlt_geometry_pack */
+#define GEOMETRY_PACK_VERSION 2
+
+/** The size of the block header: magic, version, length, nw, nh, count and data size */
+#define GEOMETRY_PACK_HEADER ( 4 + 6 * sizeof( int32_t ) )
+
+/** The size of a packed key: frame, x, y, w, h, mix and flags */
+#define GEOMETRY_PACK_KEY ( sizeof( int32_t ) + 5 * sizeof( float ) + 1 )
+
+static inline uint8_t *pack_int( uint8_t *p, int32_t value )
+{
+	memcpy( p, &value, sizeof( value ) );
+	return p + sizeof( value );
+}
+
+static inline uint8_t *pack_float( uint8_t *p, float value )
+{
+	memcpy( p, &value, sizeof( value ) );
+	return p + sizeof( value );
+}
+
+static inline const uint8_t *unpack_int( const uint8_t *p, int32_t *value )
+{
+	memcpy( value, p, sizeof( *value ) );
+	return p + sizeof( *value );
+}
+
+static inline const uint8_t *unpack_float( const uint8_t *p, float *value )
+{
+	memcpy( value, p, sizeof( *value ) );
+	return p + sizeof( *value );
+}
+
+// Pack the keys and the specification they were parsed from into a binary block.
+// The caller must free the result. The block uses host byte order and is meant
+// for caching large geometries, e.g. tracking data, without parsing them again.
+void *mlt_geometry_pack( mlt_geometry self, int *size )
+{
+	geometry g = self->local;
+	int data_size = g->data ? strlen( g->data ) : -1;
+	size_t total = GEOMETRY_PACK_HEADER + ( data_size > 0 ? data_size : 0 ) + ( size_t )g->count * GEOMETRY_PACK_KEY;
+	uint8_t *block = total <= INT32_MAX ? malloc( total ) : NULL;
+
+	if ( block != NULL )
+	{
+		uint8_t *p = block;
+		int i, j;
+
+		memcpy( p, "MLTG", 4 );
+		p = pack_int( p + 4, GEOMETRY_PACK_VERSION );
+		p = pack_int( p, g->length );
+		p = pack_int( p, g->nw );
+		p = pack_int( p, g->nh );
+		p = pack_int( p, g->count );
+		p = pack_int( p, data_size );
+		if ( data_size > 0 )
+		{
+			memcpy( p, g->data, data_size );
+			p += data_size;
+		}
+		for ( i = 0; i < g->count; i ++ )
+		{
+			mlt_geometry_item item = &g->items[ i ];
+			uint8_t flags = ( item->key ? 1 : 0 ) | ( item->distort ? 2 : 0 );
+
+			for ( j = 0; j < 5; j ++ )
+				if ( item->f[ j ] )
+					flags |= 4 << j;
+			p = pack_int( p, item->frame );
+			p = pack_float( p, item->x );
+			p = pack_float( p, item->y );
+			p = pack_float( p, item->w );
+			p = pack_float( p, item->h );
+			p = pack_float( p, item->mix );
+			*p ++ = flags;
+		}
+		if ( size != NULL )
+			*size = total;
+	}
+	return block;
+}
+
+// Replace the geometry with a block made by mlt_geometry_pack.
+// The geometry is left unchanged if the block is not valid. A later refresh
+// with the same specification, length and size does not parse it again.
+int mlt_geometry_unpack( mlt_geometry self, const void *data, int size )
+{
+	geometry g = self->local;
+	const uint8_t *p = data;
+	int32_t version, length, nw, nh, count, data_size;
+	struct mlt_geometry_item_s *items = NULL;
+	char *spec = NULL;
+	int i, j;
+
+	if ( data == NULL || size < ( int )GEOMETRY_PACK_HEADER || memcmp( p, "MLTG", 4 ) )
+		return 1;
+	p = unpack_int( p + 4, &version );
+	p = unpack_int( p, &length );
+	p = unpack_int( p, &nw );
+	p = unpack_int( p, &nh );
+	p = unpack_int( p, &count );
+	p = unpack_int( p, &data_size );
+	size -= GEOMETRY_PACK_HEADER;
+	if ( version != GEOMETRY_PACK_VERSION || count < 0 || data_size < -1
+		 || ( data_size > 0 && data_size > size )
+		 || count != ( size - ( data_size > 0 ? data_size : 0 ) ) / ( int )GEOMETRY_PACK_KEY
+		 || ( size - ( data_size > 0 ? data_size : 0 ) ) % ( int )GEOMETRY_PACK_KEY )
+		return 1;
+
+	if ( data_size >= 0 )
+	{
+		spec = malloc( data_size + 1 );
+		if ( spec == NULL )
+			return 1;
+		memcpy( spec, p, data_size );
+		spec[ data_size ] = '\0';
+		p += data_size;
+	}
+	if ( count > 0 )
+	{
+		items = malloc( count * sizeof( struct mlt_geometry_item_s ) );
+		if ( items == NULL )
+		{
+			free( spec );
+			return 1;
+		}
+	}
+	for ( i = 0; i < count; i ++ )
+	{
+		mlt_geometry_item item = &items[ i ];
+		int32_t frame;
+		uint8_t flags;
+
+		p = unpack_int( p, &frame );
+		p = unpack_float( p, &item->x );
+		p = unpack_float( p, &item->y );
+		p = unpack_float( p, &item->w );
+		p = unpack_float( p, &item->h );
+		p = unpack_float( p, &item->mix );
+		flags = *p ++;
+
+		// The keys must be sorted for the binary search
+		if ( i > 0 && frame <= items[ i - 1 ].frame )
+		{
+			free( items );
+			free( spec );
+			return 1;
+		}
+		item->frame = frame;
+		item->key = flags & 1;
+		item->distort = ( flags & 2 ) != 0;
+		for ( j = 0; j < 5; j ++ )
+			item->f[ j ] = ( flags & ( 4 << j ) ) != 0;
+	}
+
+	free( g->data );
+	free( g->items );
+	g->data = spec;
+	g->items = items;
+	g->count = count;
+	g->size = count;
+	g->length = length;
+	g->nw = nw;
+	g->nh = nh;
+
+	return 0;
+}
+
 // Close the geometry
 void mlt_geometry_close( mlt_geometry self )
 {
 	if ( self != NULL )
 	{
 		mlt_geometry_clean( self );
+		free( ( ( geometry )self->local )->items );
 		free( self->local );
 		free( self );
 	}
@@ -78,6 +78,9 @@ extern int mlt_geometry_prev_key( mlt_geometry self, mlt_geometry_item item, int
 /* Serialise the current geometry */
 extern char *mlt_geometry_serialise_cut( mlt_geometry self, int in, int out );
 extern char *mlt_geometry_serialise( mlt_geometry self );
+/* Pack the keys into a binary block and restore them without parsing */
+extern void *mlt_geometry_pack( mlt_geometry self, int *size );
+extern int mlt_geometry_unpack( mlt_geometry self, const void *data, int size );
 /* Close the geometry */
 extern void mlt_geometry_close( mlt_geometry self );
 
@@ -79,14 +79,26 @@ void mlt_log( void *service, int level, const char *fmt, ... ) __attribute__ ((_
 void mlt_log( void *service, int level, const char *fmt, ... );
 #endif
 
-#define mlt_log_panic(service, format, args...) mlt_log((service), MLT_LOG_PANIC, (format), ## args)
-#define mlt_log_fatal(service, format, args...) mlt_log((service), MLT_LOG_FATAL, (format), ## args)
-#define mlt_log_error(service, format, args...) mlt_log((service), MLT_LOG_ERROR, (format), ## args)
-#define mlt_log_warning(service, format, args...) mlt_log((service), MLT_LOG_WARNING, (format), ## args)
-#define mlt_log_info(service, format, args...) mlt_log((service), MLT_LOG_INFO, (format), ## args)
-#define mlt_log_verbose(service, format, args...) mlt_log((service), MLT_LOG_VERBOSE, (format), ## args)
-#define mlt_log_timings(service, format, args...) mlt_log((service), MLT_LOG_TIMINGS, (format), ## args)
-#define mlt_log_debug(service, format, args...) mlt_log((service), MLT_LOG_DEBUG, (format), ## args)
+/**
+ * Evaluate to true if messages of the given level are sent to the log.
+ * Use it to skip work that only prepares a message.
+ */
+#define mlt_log_enabled(level) ( (level) <= mlt_log_get_level() )
+
+/* These check the level first so the arguments are not evaluated for
+ * messages that would be dropped.
+ */
+#define mlt_log_checked(service, level, format, args...) \
+	( mlt_log_enabled( level ) ? mlt_log((service), (level), (format), ## args) : (void) 0 )
+
+#define mlt_log_panic(service, format, args...) mlt_log_checked((service), MLT_LOG_PANIC, (format), ## args)
+#define mlt_log_fatal(service, format, args...) mlt_log_checked((service), MLT_LOG_FATAL, (format), ## args)
+#define mlt_log_error(service, format, args...) mlt_log_checked((service), MLT_LOG_ERROR, (format), ## args)
+#define mlt_log_warning(service, format, args...) mlt_log_checked((service), MLT_LOG_WARNING, (format), ## args)
+#define mlt_log_info(service, format, args...) mlt_log_checked((service), MLT_LOG_INFO, (format), ## args)
+#define mlt_log_verbose(service, format, args...) mlt_log_checked((service), MLT_LOG_VERBOSE, (format), ## args)
+#define mlt_log_timings(service, format, args...) mlt_log_checked((service), MLT_LOG_TIMINGS, (format), ## args)
+#define mlt_log_debug(service, format, args...) mlt_log_checked((service), MLT_LOG_DEBUG, (format), ## args)
 
 void mlt_vlog( void *service, int level, const char *fmt, va_list );
 int mlt_log_get_level( void );
@@ -0,0 +1,666 @@
+/**
+ * \file mlt_luma_map.c
+ * \brief procedural luma wipe maps
+ * \see mlt_luma_map_s
+ *
+ * Copyright (C) 2003-2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mlt_luma_map.h"
+#include "mlt_slices.h"
+#include "mlt_factory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/** The number of unreferenced maps kept by mlt_luma_map_acquire(). */
+#define LUMA_CACHE_SIZE 8
+
+/** Initialise the generator parameters to a plain left to right wipe.
+ *
+ * \public \memberof mlt_luma_map_s
+ * \param self a luma map
+ */
+
+void mlt_luma_map_init( mlt_luma_map self )
+{
+	memset( self, 0, sizeof( struct mlt_luma_map_s ) );
+	self->w = 720;
+	self->h = 576;
+	self->bands = 1;
+}
+
+/** The generator options of the stock wipes.
+ *
+ * A bands value of -1 means one band per line.
+ */
+
+static const struct
+{
+	const char *name;
+	struct mlt_luma_map_s map;
+}
+presets[] =
+{
+	/*             type w  h  bands rband vmir hmir dmir inv offset flip flop pflip pflop quart rotate */
+	{ "luma01", { 0, 0, 0,  1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma02", { 0, 0, 0, -1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma03", { 0, 0, 0,  1, 0, 0, 1, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma04", { 0, 0, 0, -1, 0, 1, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma05", { 0, 0, 0,  1, 0, 0, 0, 1, 0, 32768, 0, 0, 0, 0, 0, 0 } },
+	{ "luma06", { 0, 0, 0,  1, 0, 0, 0, 1, 0, 32768, 1, 0, 0, 0, 0, 0 } },
+	{ "luma07", { 0, 0, 0,  1, 0, 0, 0, 1, 0, 32768, 0, 0, 0, 0, 1, 0 } },
+	{ "luma08", { 0, 0, 0,  1, 0, 0, 0, 1, 0, 32768, 1, 0, 0, 0, 1, 0 } },
+	{ "luma09", { 0, 0, 0, 12, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma10", { 0, 0, 0, 12, 0, 0, 0, 0, 0,     0, 0, 1, 0, 0, 0, 1 } },
+	{ "luma11", { 0, 0, 0, 12, 1, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma12", { 0, 0, 0, 12, 1, 1, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma13", { 0, 0, 0, 12, 1, 0, 0, 0, 0,     0, 0, 1, 0, 0, 0, 1 } },
+	{ "luma14", { 0, 0, 0, 12, 1, 1, 0, 0, 0,     0, 0, 0, 0, 0, 0, 1 } },
+	{ "luma15", { 0, 0, 0,  1, 0, 0, 1, 1, 0, 32768, 0, 0, 0, 0, 0, 0 } },
+	{ "luma16", { 1, 0, 0,  1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma17", { 1, 0, 0,  2, 1, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma18", { 2, 0, 0,  1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ "luma19", { 2, 0, 0,  1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 1, 0 } },
+	{ "luma20", { 2, 0, 0,  1, 0, 0, 0, 0, 0,     0, 1, 0, 0, 0, 1, 0 } },
+	{ "luma21", { 2, 0, 0,  2, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 1, 0 } },
+	{ "luma22", { 3, 0, 0,  1, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0 } },
+	{ NULL }
+};
+
+/** Configure the generator for one of the stock wipes.
+ *
+ * The name may be given as a resource, such as "%luma01.pgm" or a path to
+ * one of the installed files; the directory and extension are ignored.
+ * The size must already be set, as some wipes depend upon it.
+ *
+ * \public \memberof mlt_luma_map_s
+ * \param self a luma map
+ * \param name the name of a stock wipe
+ * \return true if the name is not a stock wipe
+ */
+
+int mlt_luma_map_preset( mlt_luma_map self, const char *name )
+{
+	const char *base = name ? strrchr( name, '/' ) : NULL;
+	int i;
+
+	if ( name == NULL )
+		return 1;
+	base = base ? base + 1 : name;
+	if ( *base == '%' )
+		base ++;
+
+	for ( i = 0; presets[ i ].name != NULL; i ++ )
+	{
+		size_t length = strlen( presets[ i ].name );
+		if ( !strncmp( base, presets[ i ].name, length ) && ( base[ length ] == '\0' || base[ length ] == '.' ) )
+		{
+			int w = self->w;
+			int h = self->h;
+			*self = presets[ i ].map;
+			self->w = w;
+			self->h = h;
+			if ( self->bands < 0 )
+				self->bands = h;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static inline int sqrti( int n )
+{
+	int p = 0;
+	int q = 1;
+	int r = n;
+	int h = 0;
+
+	while( q <= n )
+		q = 4 * q;
+
+	while( q != 1 )
+	{
+		q = q / 4;
+		h = p + q;
+		p = p / 2;
+		if ( r >= h )
+		{
+			p = p + q;
+			r = r - h;
+		}
+	}
+
+	return p;
+}
+
+typedef struct
+{
+	mlt_luma_map self;
+	uint16_t *image;
+	int rows;
+	int lpb;
+	int rpb;
+	int length;
+}
+render_desc;
+
+/** Generate one line of the unmirrored pattern.
+ *
+ * Every line depends only upon its band and position within the band, so
+ * the lines can be generated in any order.
+ */
+
+static void render_line( render_desc *desc, int line, uint16_t *p )
+{
+	mlt_luma_map self = desc->self;
+	int64_t max = ( 1 << 16 ) - 1;
+	int half_w = self->w / 2;
+	int half_h = self->h / 2;
+	int lpb = desc->lpb;
+	int64_t rpb = desc->rpb;
+	uint16_t *start = p;
+	int j, k;
+
+	if ( self->type == 3 )
+	{
+		int length;
+		j = line - half_h;
+		if ( j < 0 )
+		{
+			for ( k = - half_w; k < half_w; k ++ )
+			{
+				length = sqrti( k * k + j * j );
+				*p ++ = ( max / 4 * k ) / ( length + 1 );
+			}
+		}
+		else
+		{
+			for ( k = half_w; k > - half_w; k -- )
+			{
+				length = sqrti( k * k + j * j );
+				*p ++ = ( max / 2 ) + ( max / 4 * k ) / ( length + 1 );
+			}
+		}
+	}
+	else
+	{
+		int i = line / lpb;
+		int64_t lower = i * rpb;
+		int direction = 1;
+
+		j = line % lpb;
+		if ( self->rband && i % 2 == 1 )
+		{
+			direction = -1;
+			lower += rpb;
+		}
+
+		switch( self->type )
+		{
+			case 1:
+				{
+					int y = j - lpb / 2;
+					for ( k = 0; k < self->w; k ++ )
+					{
+						int x = k - half_w;
+						int64_t value = sqrti( x * x + y * y );
+						*p ++ = lower + ( direction * rpb * ( ( max * value ) / desc->length ) / max ) + ( j * self->offset * 2 / lpb ) + ( j * self->offset / lpb );
+					}
+				}
+				break;
+
+			case 2:
+				{
+					int value = ( ( j * self->w ) / lpb ) - half_w;
+					int scale = half_w > 0 ? half_w : 1;
+					if ( value > 0 )
+						value = - value;
+					for ( k = - half_w; k < value; k ++ )
+						*p ++ = lower + ( direction * rpb * ( ( max * abs( k ) ) / scale ) / max );
+					for ( k = value; k < abs( value ) && p < start + self->w; k ++ )
+						*p ++ = lower + ( direction * rpb * ( ( max * abs( value ) ) / scale ) / max ) + ( j * self->offset * 2 / lpb ) + ( j * self->offset / lpb );
+					for ( k = abs( value ); k < half_w; k ++ )
+						*p ++ = lower + ( direction * rpb * ( ( max * abs( k ) ) / scale ) / max );
+				}
+				break;
+
+			default:
+				for ( k = 0; k < self->w; k ++ )
+					*p ++ = lower + ( direction * ( rpb * ( ( k * max ) / self->w ) / max ) ) + ( j * self->offset * 2 / lpb );
+				break;
+		}
+	}
+
+	// Odd widths leave one column to fill
+	while ( p < start + self->w )
+	{
+		*p = p > start ? *( p - 1 ) : 0;
+		p ++;
+	}
+}
+
+static int render_slice( int id, int idx, int jobs, void *cookie )
+{
+	render_desc *desc = cookie;
+	int w = desc->self->w;
+	int size = ( desc->rows + jobs - 1 ) / jobs;
+	int start = idx * size;
+	int end = start + size > desc->rows ? desc->rows : start + size;
+	int line;
+
+	for ( line = start; line < end; line ++ )
+		render_line( desc, line, desc->image + line * w );
+	return 0;
+}
+
+/** Render a luma map.
+ *
+ * The pattern is generated across the normal slice threads and then mirrored,
+ * flipped and rotated as requested.
+ *
+ * \public \memberof mlt_luma_map_s
+ * \param self a luma map
+ * \return a map of w * h 16 bit values that the caller must free()
+ */
+
+uint16_t *mlt_luma_map_render( mlt_luma_map self )
+{
+	int i = 0;
+	int j = 0;
+
+	if ( self->quart )
+	{
+		self->w *= 2;
+		self->h *= 2;
+	}
+
+	if ( self->rotate )
+	{
+		int t = self->w;
+		self->w = self->h;
+		self->h = t;
+	}
+
+	int max = ( 1 << 16 ) - 1;
+	uint16_t *image = malloc( self->w * self->h * sizeof( uint16_t ) );
+	uint16_t *end, *p, *r;
+	render_desc desc;
+
+	if ( image == NULL )
+		return NULL;
+	end = image + self->w * self->h;
+	p = image;
+	r = image;
+
+	desc.self = self;
+	desc.image = image;
+	if ( self->bands < 1 )
+		self->bands = 1;
+	if ( self->bands > self->h )
+		self->bands = self->h;
+	desc.lpb = self->h / self->bands;
+	desc.rpb = max / self->bands;
+	desc.rows = self->type == 3 ? self->h / 2 * 2 : desc.lpb * self->bands;
+	desc.length = sqrti( self->w / 2 * ( self->w / 2 ) + desc.lpb * desc.lpb / 4 );
+	if ( desc.length < 1 )
+		desc.length = 1;
+
+	if ( !self->dmirror && ( self->hmirror || self->vmirror ) )
+		desc.rpb *= 2;
+
+	// Lines past the last whole band repeat the one before
+	mlt_slices_run_normal( 0, render_slice, &desc );
+	if ( desc.rows == 0 )
+		memset( image, 0, self->w * sizeof( uint16_t ) );
+	for ( i = desc.rows > 0 ? desc.rows : 1; i < self->h; i ++ )
+		memcpy( image + i * self->w, image + ( i - 1 ) * self->w, self->w * sizeof( uint16_t ) );
+
+	if ( self->quart )
+	{
+		self->w /= 2;
+		self->h /= 2;
+		for ( i = 1; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = image + i * 2 * self->w;
+			j = self->w;
+			while ( j -- > 0 )
+				*p ++ = *r ++;
+		}
+	}
+
+	if ( self->dmirror )
+	{
+		for ( i = 0; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = end - i * self->w;
+			j = ( self->w * ( self->h - i ) ) / self->h;
+			while ( j -- )
+				*( -- r ) = *p ++;
+		}
+	}
+
+	if ( self->flip )
+	{
+		uint16_t t;
+		for ( i = 0; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = p + self->w;
+			j = self->w / 2;
+			while( j -- )
+			{
+				t = *p;
+				*p ++ = *( -- r );
+				*r = t;
+			}
+		}
+	}
+
+	if ( self->flop )
+	{
+		uint16_t t;
+		r = end;
+		for ( i = 1; i < self->h / 2; i ++ )
+		{
+			p = image + i * self->w;
+			j = self->w;
+			while( j -- )
+			{
+				t = *( -- p );
+				*p = *( -- r );
+				*r = t;
+			}
+		}
+	}
+
+	if ( self->hmirror )
+	{
+		for ( i = 0; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = p + self->w;
+			j = self->w / 2;
+			while ( j -- )
+				*( -- r ) = *p ++;
+		}
+	}
+
+	if ( self->vmirror )
+	{
+		p = image;
+		r = image + self->w * self->h;
+		j = self->w * self->h / 2;
+		while ( j -- )
+			*( -- r ) = *p ++;
+	}
+
+	if ( self->invert )
+	{
+		p = image;
+		r = image;
+		while ( p < end )
+			*p ++ = max - *r ++;
+	}
+
+	if ( self->pflip )
+	{
+		uint16_t t;
+		for ( i = 0; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = p + self->w;
+			j = self->w / 2;
+			while( j -- )
+			{
+				t = *p;
+				*p ++ = *( -- r );
+				*r = t;
+			}
+		}
+	}
+
+	if ( self->pflop )
+	{
+		uint16_t t;
+		end = image + self->w * self->h;
+		r = end;
+		for ( i = 1; i < self->h / 2; i ++ )
+		{
+			p = image + i * self->w;
+			j = self->w;
+			while( j -- )
+			{
+				t = *( -- p );
+				*p = *( -- r );
+				*r = t;
+			}
+		}
+	}
+
+	if ( self->rotate )
+	{
+		uint16_t *image2 = malloc( self->w * self->h * sizeof( uint16_t ) );
+		if ( image2 == NULL )
+		{
+			free( image );
+			return NULL;
+		}
+		for ( i = 0; i < self->h; i ++ )
+		{
+			p = image + i * self->w;
+			r = image2 + self->h - i - 1;
+			for ( j = 0; j < self->w; j ++ )
+			{
+				*r = *( p ++ );
+				r += self->h;
+			}
+		}
+		i = self->w;
+		self->w = self->h;
+		self->h = i;
+		free( image );
+		image = image2;
+	}
+
+	return image;
+}
+
+/** A rendered stock wipe held by the process wide store.
+ */
+
+typedef struct luma_entry_s
+{
+	char key[ 64 ];
+	uint16_t *bitmap;
+	int refs;
+	struct luma_entry_s *next;
+}
+*luma_entry;
+
+static pthread_mutex_t luma_lock = PTHREAD_MUTEX_INITIALIZER;
+static luma_entry luma_entries = NULL;
+static int luma_registered = 0;
+
+/** Free unreferenced maps beyond the store size, least recently used first.
+ */
+
+static void luma_trim( int keep )
+{
+	luma_entry *link = &luma_entries;
+	int count = 0;
+
+	while ( *link != NULL )
+	{
+		luma_entry entry = *link;
+		if ( entry->refs == 0 && ++ count > keep )
+		{
+			*link = entry->next;
+			free( entry->bitmap );
+			free( entry );
+		}
+		else
+		{
+			link = &entry->next;
+		}
+	}
+}
+
+/** Find a map, take a reference and move it to the front of the store.
+ *
+ * Called with luma_lock held.
+ */
+
+static luma_entry luma_find( const char *key )
+{
+	luma_entry *link;
+
+	for ( link = &luma_entries; *link != NULL; link = &( *link )->next )
+	{
+		if ( !strcmp( ( *link )->key, key ) )
+		{
+			luma_entry entry = *link;
+			*link = entry->next;
+			entry->refs ++;
+			entry->next = luma_entries;
+			luma_entries = entry;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void luma_close( void *arg )
+{
+	pthread_mutex_lock( &luma_lock );
+	luma_trim( 0 );
+	luma_registered = 0;
+	pthread_mutex_unlock( &luma_lock );
+}
+
+/** Get a stock wipe rendered at an exact size.
+ *
+ * Maps are shared by every caller in the process and rendered only once for
+ * each combination of arguments. Release the map with mlt_luma_map_release()
+ * when it is no longer needed.
+ *
+ * \public \memberof mlt_luma_map_s
+ * \param name the name of a stock wipe, see mlt_luma_map_preset()
+ * \param width the width of the map
+ * \param height the height of the map
+ * \param invert whether to invert the map
+ * \return the map or NULL if name is not a stock wipe
+ */
+
+uint16_t *mlt_luma_map_acquire( const char *name, int width, int height, int invert )
+{
+	struct mlt_luma_map_s map;
+	luma_entry entry = NULL;
+	char key[ 64 ];
+	const char *base;
+
+	if ( width <= 0 || height <= 0 )
+		return NULL;
+
+	mlt_luma_map_init( &map );
+	map.w = width;
+	map.h = height;
+	if ( mlt_luma_map_preset( &map, name ) )
+		return NULL;
+	map.invert = !!invert;
+
+	base = strrchr( name, '/' );
+	base = base ? base + 1 : name;
+	snprintf( key, sizeof( key ), "%.6s %dx%d %d", base + ( *base == '%' ), width, height, map.invert );
+
+	pthread_mutex_lock( &luma_lock );
+	entry = luma_find( key );
+	pthread_mutex_unlock( &luma_lock );
+
+	// Render without the lock so other sizes and wipes are not held up
+	if ( entry == NULL )
+	{
+		uint16_t *bitmap = mlt_luma_map_render( &map );
+		luma_entry created = bitmap ? calloc( 1, sizeof( struct luma_entry_s ) ) : NULL;
+
+		if ( created == NULL )
+		{
+			free( bitmap );
+			return NULL;
+		}
+		strcpy( created->key, key );
+		created->bitmap = bitmap;
+
+		pthread_mutex_lock( &luma_lock );
+		// Another thread may have rendered the same map meanwhile
+		entry = luma_find( key );
+		if ( entry == NULL )
+		{
+			entry = created;
+			created = NULL;
+			entry->refs ++;
+			entry->next = luma_entries;
+			luma_entries = entry;
+		}
+		if ( !luma_registered )
+		{
+			mlt_factory_register_for_clean_up( &luma_entries, luma_close );
+			luma_registered = 1;
+		}
+		pthread_mutex_unlock( &luma_lock );
+
+		if ( created != NULL )
+		{
+			free( created->bitmap );
+			free( created );
+		}
+	}
+
+	return entry ? entry->bitmap : NULL;
+}
+
+/** Release a map obtained from mlt_luma_map_acquire().
+ *
+ * This is suitable for use as the destructor of a properties data item.
+ *
+ * \public \memberof mlt_luma_map_s
+ * \param bitmap the map
+ */
+
+void mlt_luma_map_release( uint16_t *bitmap )
+{
+	luma_entry entry;
+
+	if ( bitmap == NULL )
+		return;
+
+	pthread_mutex_lock( &luma_lock );
+	for ( entry = luma_entries; entry != NULL; entry = entry->next )
+	{
+		if ( entry->bitmap == bitmap )
+		{
+			entry->refs --;
+			break;
+		}
+	}
+	luma_trim( LUMA_CACHE_SIZE );
+	pthread_mutex_unlock( &luma_lock );
+}
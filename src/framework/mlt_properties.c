@@ -53,6 +53,7 @@ typedef struct
 	mlt_property *value;
 	int count;
 	int size;
+	int allocated;
 	mlt_properties mirror;
 	int ref_count;
 	pthread_mutex_t mutex;
@@ -553,9 +554,21 @@ static mlt_property mlt_properties_add( mlt_properties self, const char *name )
 		list->value = realloc( list->value, list->size * sizeof( mlt_property ) );
 	}
 
-	// Assign name/value pair
-	list->name[ list->count ] = strdup( name );
-	list->value[ list->count ] = mlt_property_init( );
+	// Assign name/value pair, reusing what a reset left behind
+	if ( list->count < list->allocated )
+	{
+		if ( strcmp( list->name[ list->count ], name ) )
+		{
+			free( list->name[ list->count ] );
+			list->name[ list->count ] = strdup( name );
+		}
+	}
+	else
+	{
+		list->name[ list->count ] = strdup( name );
+		list->value[ list->count ] = mlt_property_init( );
+		list->allocated ++;
+	}
 
 	// Assign to hash table
 	if ( list->hash[ key ] == 0 )
@@ -592,6 +605,7 @@ static mlt_property mlt_properties_fetch( mlt_properties self, const char *name
 
 /** Copy a property to another properties list.
  *
+ * The event "property-changed" is fired after the property has been copied.
  * \public \memberof mlt_properties_s
  * \author Zach <zachary.drew@gmail.com>
  * \param self the properties to copy to
@@ -607,6 +621,7 @@ void mlt_properties_pass_property( mlt_properties self, mlt_properties that, con
 		return;
 
 	mlt_property_pass( mlt_properties_fetch( self, name ), that_prop );
+	mlt_events_fire( self, "property-changed", name, NULL );
 }
 
 /** Copy all properties specified in a comma-separated list to another properties list.
@@ -1419,6 +1434,13 @@ void mlt_properties_close( mlt_properties self )
 				free( list->name[ index ] );
 			}
 
+			// And those kept by mlt_properties_reset()
+			for ( index = list->count; index < list->allocated; index ++ )
+			{
+				mlt_property_close( list->value[ index ] );
+				free( list->name[ index ] );
+			}
+
 #if defined(__GLIBC__) || defined(__APPLE__)
 			// Cleanup locale
 			if ( list->locale )
@@ -1441,6 +1463,39 @@ void mlt_properties_close( mlt_properties self )
 	}
 }
 
+/** Remove all properties but keep their storage.
+ *
+ * The values are cleared as if by mlt_properties_close(), but the arrays, the
+ * property objects and their names are kept so that setting the same
+ * properties again does not allocate. The reference count is left alone.
+ * Nothing else may be using the properties while they are reset.
+ * \public \memberof mlt_properties_s
+ * \param self a properties object
+ */
+
+void mlt_properties_reset( mlt_properties self )
+{
+	if ( self != NULL )
+	{
+		property_list *list = self->local;
+		int index = 0;
+
+		for ( index = list->count - 1; index >= 0; index -- )
+			mlt_property_clear( list->value[ index ] );
+		list->count = 0;
+		memset( list->hash, 0, sizeof( list->hash ) );
+		list->mirror = NULL;
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+		if ( list->locale )
+			freelocale( list->locale );
+#else
+		free( list->locale );
+#endif
+		list->locale = NULL;
+	}
+}
+
 /** Determine if the properties list is really just a sequence or ordered list.
  *
  * \public \memberof mlt_properties_s
@@ -35,6 +35,9 @@
 #include <pthread.h>
 #include <float.h>
 #include <math.h>
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <langinfo.h>
+#endif
 
 
 /** Bit pattern used internally to indicated representations available.
@@ -73,6 +76,9 @@ struct mlt_property_s
 	/// String handling
 	char *prop_string;
 
+	/// Numbers and times are formatted here rather than into a new allocation
+	char prop_buffer[ 32 ];
+
 	/// Generic type handling
 	void *data;
 	int length;
@@ -95,6 +101,19 @@ mlt_property mlt_property_init( )
 	return self;
 }
 
+/** Release the string representation of a property.
+ *
+ * \private \memberof mlt_property_s
+ * \param self a property
+ */
+
+static inline void clear_string( mlt_property self )
+{
+	if ( self->prop_string != self->prop_buffer )
+		free( self->prop_string );
+	self->prop_string = NULL;
+}
+
 /** Clear (0/null) a property.
  *
  * Frees up any associated resources in the process.
@@ -109,8 +128,7 @@ static void clear_property( mlt_property self )
 		self->destructor( self->data );
 
 	// Special case string handling
-	if ( self->prop_string )
-		free( self->prop_string );
+	clear_string( self );
 
 	mlt_animation_close( self->animation );
 
@@ -273,77 +291,153 @@ int mlt_property_set_data( mlt_property self, void *value, int length, mlt_destr
 	return 0;
 }
 
-/** Parse a SMIL clock value.
+/** Test for white space as isspace() does in the C locale.
  *
  * \private \memberof mlt_property_s
- * \param self a property
+ * \param c a character
+ * \return true if c is white space
+ */
+
+static inline int is_space( char c )
+{
+	return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+/** Find the last occurrence of a character in a range of a string.
+ *
+ * \private \memberof mlt_property_s
+ * \param s the start of the string
+ * \param end the end of the range to search
+ * \param c the character to find
+ * \return a pointer to the character or NULL if not found
+ */
+
+static const char *last_of( const char *s, const char *end, char c )
+{
+	while ( end > s )
+		if ( *--end == c )
+			return end;
+	return NULL;
+}
+
+/** Parse the leading decimal integer of a string.
+ *
+ * This behaves like atoi() and stops at the first character that is not a digit.
+ * \private \memberof mlt_property_s
  * \param s the string to parse
- * \param fps frames per second
- * \param locale the locale to use for parsing a real number value
- * \return position in frames
+ * \return the integer value or 0 if there are no digits
  */
 
-static int time_clock_to_frames( mlt_property self, const char *s, double fps, locale_t locale )
+static int parse_int( const char *s )
 {
-	char *pos, *copy = strdup( s );
-	int hours = 0, minutes = 0;
-	double seconds;
+	unsigned int value = 0;
+	int negative = 0;
+
+	while ( is_space( *s ) )
+		s++;
+	if ( *s == '-' || *s == '+' )
+		negative = *s++ == '-';
+	for ( ; *s >= '0' && *s <= '9'; s++ )
+		value = value * 10 + ( *s - '0' );
+	return negative ? -value : value;
+}
 
-	s = copy;
-	pos = strrchr( s, ':' );
+/** Parse the leading real number of a string.
+ *
+ * This behaves like strtod() except that it accepts either a period or a comma
+ * as the decimal point regardless of locale, and it does not handle hexadecimal,
+ * infinity or NaN. The result is correctly rounded for up to 15 significant
+ * digits, which covers any clock value.
+ * \private \memberof mlt_property_s
+ * \param s the string to parse
+ * \return the real number or 0 if there are no digits
+ */
 
-#if !defined(__GLIBC__) && !defined(__APPLE__) && !defined(_WIN32) && !HAVE_STRTOD_L
-	char *orig_localename = NULL;
-	if ( locale )
+static double parse_real( const char *s )
+{
+	static const double powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	uint64_t mantissa = 0;
+	int negative = 0, digits = 0, exponent = 0;
+	double value;
+
+	while ( is_space( *s ) )
+		s++;
+	if ( *s == '-' || *s == '+' )
+		negative = *s++ == '-';
+	for ( ; *s >= '0' && *s <= '9'; s++, digits++ )
 	{
-		// Protect damaging the global locale from a temporary locale on another thread.
-		pthread_mutex_lock( &self->mutex );
+		if ( mantissa < 1000000000000000000ULL )
+			mantissa = mantissa * 10 + ( *s - '0' );
+		else
+			exponent++;
+	}
+	if ( *s == '.' || *s == ',' )
+	{
+		for ( s++; *s >= '0' && *s <= '9'; s++, digits++ )
+		{
+			if ( mantissa < 1000000000000000000ULL )
+			{
+				mantissa = mantissa * 10 + ( *s - '0' );
+				exponent--;
+			}
+		}
+	}
+	if ( !digits )
+		return 0;
+	if ( *s == 'e' || *s == 'E' )
+	{
+		int exponent_negative = 0, exponent_value = 0;
+
+		s++;
+		if ( *s == '-' || *s == '+' )
+			exponent_negative = *s++ == '-';
+		for ( ; *s >= '0' && *s <= '9'; s++ )
+			if ( exponent_value < 10000 )
+				exponent_value = exponent_value * 10 + ( *s - '0' );
+		exponent += exponent_negative ? -exponent_value : exponent_value;
+	}
 
-		// Get the current locale
-		orig_localename = strdup( setlocale( LC_NUMERIC, NULL ) );
+	// A mantissa and power of ten that are both exact give an exact quotient or product.
+	value = mantissa;
+	if ( mantissa < ( 1ULL << 53 ) && exponent >= -22 && exponent <= 22 )
+		value = exponent < 0 ? value / powers[ -exponent ] : value * powers[ exponent ];
+	else
+		value *= pow( 10, exponent );
+	return negative ? -value : value;
+}
 
-		// Set the new locale
-		setlocale( LC_NUMERIC, locale );
-	}
-#endif
+/** Parse a SMIL clock value.
+ *
+ * The seconds may use either a period or a comma as the decimal point.
+ * \private \memberof mlt_property_s
+ * \param s the string to parse
+ * \param fps frames per second
+ * \return position in frames
+ */
+
+static int time_clock_to_frames( const char *s, double fps )
+{
+	const char *pos = last_of( s, s + strlen( s ), ':' );
+	int hours = 0, minutes = 0;
+	double seconds;
 
 	if ( pos ) {
-#if defined(__GLIBC__) || defined(__APPLE__) || HAVE_STRTOD_L
-		if ( locale )
-			seconds = strtod_l( pos + 1, NULL, locale );
-		else
-#endif
-			seconds = strtod( pos + 1, NULL );
-		*pos = 0;
-		pos = strrchr( s, ':' );
+		seconds = parse_real( pos + 1 );
+		pos = last_of( s, pos, ':' );
 		if ( pos ) {
-			minutes = atoi( pos + 1 );
-			*pos = 0;
-			hours = atoi( s );
+			minutes = parse_int( pos + 1 );
+			hours = parse_int( s );
 		}
 		else {
-			minutes = atoi( s );
+			minutes = parse_int( s );
 		}
 	}
 	else {
-#if defined(__GLIBC__) || defined(__APPLE__) || HAVE_STRTOD_L
-		if ( locale )
-			seconds = strtod_l( s, NULL, locale );
-		else
-#endif
-			seconds = strtod( s, NULL );
-	}
-
-#if !defined(__GLIBC__) && !defined(__APPLE__) && !defined(_WIN32) && !HAVE_STRTOD_L
-	if ( locale ) {
-		// Restore the current locale
-		setlocale( LC_NUMERIC, orig_localename );
-		free( orig_localename );
-		pthread_mutex_unlock( &self->mutex );
+		seconds = parse_real( s );
 	}
-#endif
-
-	free( copy );
 
 	return floor( fps * hours * 3600 ) + floor( fps * minutes * 60 ) + lrint( fps * seconds );
 }
@@ -351,46 +445,40 @@ static int time_clock_to_frames( mlt_property self, const char *s, double fps, l
 /** Parse a SMPTE timecode string.
  *
  * \private \memberof mlt_property_s
- * \param self a property
  * \param s the string to parse
  * \param fps frames per second
  * \return position in frames
  */
 
-static int time_code_to_frames( mlt_property self, const char *s, double fps )
+static int time_code_to_frames( const char *s, double fps )
 {
-	char *pos, *copy = strdup( s );
+	const char *end = s + strlen( s );
+	const char *pos = last_of( s, end, ';' );
 	int hours = 0, minutes = 0, seconds = 0, frames;
 
-	s = copy;
-	pos = strrchr( s, ';' );
 	if ( !pos )
-		pos = strrchr( s, ':' );
+		pos = last_of( s, end, ':' );
 	if ( pos ) {
-		frames = atoi( pos + 1 );
-		*pos = 0;
-		pos = strrchr( s, ':' );
+		frames = parse_int( pos + 1 );
+		pos = last_of( s, pos, ':' );
 		if ( pos ) {
-			seconds = atoi( pos + 1 );
-			*pos = 0;
-			pos = strrchr( s, ':' );
+			seconds = parse_int( pos + 1 );
+			pos = last_of( s, pos, ':' );
 			if ( pos ) {
-				minutes = atoi( pos + 1 );
-				*pos = 0;
-				hours = atoi( s );
+				minutes = parse_int( pos + 1 );
+				hours = parse_int( s );
 			}
 			else {
-				minutes = atoi( s );
+				minutes = parse_int( s );
 			}
 		}
 		else {
-			seconds = atoi( s );
+			seconds = parse_int( s );
 		}
 	}
 	else {
-		frames = atoi( s );
+		frames = parse_int( s );
 	}
-	free( copy );
 
 	return floor( fps * hours * 3600 ) + floor( fps * minutes * 60 ) + ceil( fps * seconds ) + frames;
 }
@@ -438,9 +526,9 @@ static int mlt_property_atoi( mlt_property self, double fps, locale_t locale )
 	else if ( fps > 0 && strchr( value, ':' ) )
 	{
 		if ( strchr( value, '.' ) || strchr( value, ',' ) )
-			return time_clock_to_frames( self, value, fps, locale );
+			return time_clock_to_frames( value, fps );
 		else
-			return time_code_to_frames( self, value, fps );
+			return time_code_to_frames( value, fps );
 	}
 	else
 	{
@@ -494,9 +582,9 @@ static double mlt_property_atof( mlt_property self, double fps, locale_t locale
     if ( fps > 0 && strchr( value, ':' ) )
 	{
 		if ( strchr( value, '.' ) || strchr( value, ',' ) )
-			return time_clock_to_frames( self, value, fps, locale );
+			return time_clock_to_frames( value, fps );
 		else
-			return time_code_to_frames( self, value, fps );
+			return time_code_to_frames( value, fps );
 	}
 	else
 	{
@@ -633,6 +721,93 @@ int64_t mlt_property_get_int64( mlt_property self )
 	return 0;
 }
 
+/** Write an integer in decimal.
+ *
+ * This behaves like sprintf() with "%0*d" where the sign counts toward the width.
+ * \private \memberof mlt_property_s
+ * \param[out] s the string to write into
+ * \param value the integer
+ * \param width the minimum number of characters to write
+ * \return the end of the written string
+ */
+
+static char *format_int( char *s, int64_t value, int width )
+{
+	uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+	char digits[ 20 ];
+	int n = 0;
+
+	do {
+		digits[ n++ ] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while ( magnitude );
+	if ( value < 0 ) {
+		*s++ = '-';
+		width--;
+	}
+	while ( width-- > n )
+		*s++ = '0';
+	while ( n )
+		*s++ = digits[ --n ];
+	*s = 0;
+	return s;
+}
+
+/** Write the seconds of a clock value.
+ *
+ * This behaves like sprintf() with "%06.3f", rounding half to even as glibc does.
+ * \private \memberof mlt_property_s
+ * \param[out] s the string to write into - must have room for 30 characters
+ * \param seconds the seconds
+ * \param point the decimal point
+ * \return the end of the written string
+ */
+
+static char *format_seconds( char *s, double seconds, char point )
+{
+	double magnitude = fabs( seconds );
+	double milliseconds, above_half;
+	uint64_t rounded;
+	int negative = signbit( seconds ) != 0;
+
+	if ( !( magnitude < 1e15 ) )
+		magnitude = 1e15;
+
+	// The product may round up to the next integer, so decide on the rounding
+	// with the exact difference from the halfway point.
+	milliseconds = floor( magnitude * 1000 );
+	rounded = milliseconds;
+	above_half = fma( magnitude, 1000, -( milliseconds + 0.5 ) );
+	if ( above_half > 0 || ( above_half == 0 && ( rounded & 1 ) ) )
+		rounded++;
+
+	if ( negative )
+		*s++ = '-';
+	s = format_int( s, rounded / 1000, 2 - negative );
+	*s++ = point;
+	return format_int( s, rounded % 1000, 3 );
+}
+
+/** Get the decimal point of a locale.
+ *
+ * \private \memberof mlt_property_s
+ * \param locale a locale or NULL for the C locale
+ * \return the decimal point character
+ */
+
+static char decimal_point( locale_t locale )
+{
+#if defined(__GLIBC__) || defined(__APPLE__)
+	if ( locale )
+	{
+		const char *point = nl_langinfo_l( RADIXCHAR, locale );
+		if ( point && point[0] )
+			return point[0];
+	}
+#endif
+	return '.';
+}
+
 /** Get the property as a string (with time format).
  *
  * The caller is not responsible for deallocating the returned string!
@@ -651,8 +826,7 @@ char *mlt_property_get_string_tf( mlt_property self, mlt_time_format time_format
 	pthread_mutex_lock( &self->mutex );
 	if ( self->animation && self->serialiser )
 	{
-		if ( self->prop_string )
-			free( self->prop_string );
+		clear_string( self );
 		self->prop_string = self->serialiser( self->animation, time_format );
 	}
 	else if ( ! ( self->types & mlt_prop_string ) )
@@ -660,26 +834,26 @@ char *mlt_property_get_string_tf( mlt_property self, mlt_time_format time_format
 		if ( self->types & mlt_prop_int )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%d", self->prop_int );
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, self->prop_int, 0 );
 		}
 		else if ( self->types & mlt_prop_double )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%g", self->prop_double );
+			self->prop_string = self->prop_buffer;
+			snprintf( self->prop_string, sizeof( self->prop_buffer ), "%g", self->prop_double );
 		}
 		else if ( self->types & mlt_prop_position )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%d", (int)self->prop_position );
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, (int)self->prop_position, 0 );
 		}
 		else if ( self->types & mlt_prop_int64 )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%"PRId64, self->prop_int64 );
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, self->prop_int64, 0 );
 		}
 		else if ( self->types & mlt_prop_data && self->data && self->serialiser )
 		{
@@ -738,63 +912,64 @@ char *mlt_property_get_string_l_tf( mlt_property self, locale_t locale, mlt_time
 	pthread_mutex_lock( &self->mutex );
 	if ( self->animation && self->serialiser )
 	{
-		if ( self->prop_string )
-			free( self->prop_string );
+		clear_string( self );
 		self->prop_string = self->serialiser( self->animation, time_format );
 	}
 	else if ( ! ( self->types & mlt_prop_string ) )
 	{
+		if ( self->types & mlt_prop_int )
+		{
+			self->types |= mlt_prop_string;
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, self->prop_int, 0 );
+		}
+		else if ( self->types & mlt_prop_double )
+		{
 #if !defined(_WIN32)
-		// TODO: when glibc gets sprintf_l, start using it! For now, hack on setlocale.
-		// Save the current locale
+			// Only the decimal point of a real number depends on the locale.
+			// TODO: when glibc gets sprintf_l, start using it! For now, hack on setlocale.
+			// Save the current locale
 #if defined(__APPLE__)
-		const char *localename = querylocale( LC_NUMERIC_MASK, locale );
+			const char *localename = querylocale( LC_NUMERIC_MASK, locale );
 #elif defined(__GLIBC__)
-		const char *localename = locale->__names[ LC_NUMERIC ];
+			const char *localename = locale->__names[ LC_NUMERIC ];
 #else
-		const char *localename = locale;
+			const char *localename = locale;
 #endif
-		// Get the current locale
-		char *orig_localename = strdup( setlocale( LC_NUMERIC, NULL ) );
+			// Get the current locale
+			char *orig_localename = strdup( setlocale( LC_NUMERIC, NULL ) );
 
-		// Set the new locale
-		setlocale( LC_NUMERIC, localename );
+			// Set the new locale
+			setlocale( LC_NUMERIC, localename );
 #endif // _WIN32
 
-		if ( self->types & mlt_prop_int )
-		{
-			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%d", self->prop_int );
-		}
-		else if ( self->types & mlt_prop_double )
-		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%g", self->prop_double );
+			self->prop_string = self->prop_buffer;
+			snprintf( self->prop_string, sizeof( self->prop_buffer ), "%g", self->prop_double );
+
+#if !defined(_WIN32)
+			// Restore the current locale
+			setlocale( LC_NUMERIC, orig_localename );
+			free( orig_localename );
+#endif
 		}
 		else if ( self->types & mlt_prop_position )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%d", (int)self->prop_position );
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, (int)self->prop_position, 0 );
 		}
 		else if ( self->types & mlt_prop_int64 )
 		{
 			self->types |= mlt_prop_string;
-			self->prop_string = malloc( 32 );
-			sprintf( self->prop_string, "%"PRId64, self->prop_int64 );
+			self->prop_string = self->prop_buffer;
+			format_int( self->prop_string, self->prop_int64, 0 );
 		}
 		else if ( self->types & mlt_prop_data && self->data && self->serialiser )
 		{
 			self->types |= mlt_prop_string;
 			self->prop_string = self->serialiser( self->data, self->length );
 		}
-#if !defined(_WIN32)
-		// Restore the current locale
-		setlocale( LC_NUMERIC, orig_localename );
-		free( orig_localename );
-#endif
 	}
 	pthread_mutex_unlock( &self->mutex );
 
@@ -913,7 +1088,7 @@ void mlt_property_pass( mlt_property self, mlt_property that )
  * \private \memberof mlt_property_s
  * \param frames a frame count
  * \param fps frames per second
- * \param[out] s the string to write into - must have enough space to hold largest time string
+ * \param[out] s the string to write into - must have room for 48 characters
  */
 
 static void time_smpte_from_frames( int frames, double fps, char *s, int drop )
@@ -944,8 +1119,13 @@ static void time_smpte_from_frames( int frames, double fps, char *s, int drop )
 	secs = frames / fps;
 	frames -= ceil( secs * fps );
 
-	sprintf( s, "%02d:%02d:%02d%c%0*d", hours, mins, secs, frame_sep,
-			 ( fps > 999? 4 : fps > 99? 3 : 2 ), frames );
+	s = format_int( s, hours, 2 );
+	*s++ = ':';
+	s = format_int( s, mins, 2 );
+	*s++ = ':';
+	s = format_int( s, secs, 2 );
+	*s++ = frame_sep;
+	format_int( s, frames, fps > 999? 4 : fps > 99? 3 : 2 );
 }
 
 /** Convert frame count to a SMIL clock value string.
@@ -953,10 +1133,11 @@ static void time_smpte_from_frames( int frames, double fps, char *s, int drop )
  * \private \memberof mlt_property_s
  * \param frames a frame count
  * \param fps frames per second
- * \param[out] s the string to write into - must have enough space to hold largest time string
+ * \param[out] s the string to write into - must have room for 56 characters
+ * \param point the decimal point
  */
 
-static void time_clock_from_frames( int frames, double fps, char *s )
+static void time_clock_from_frames( int frames, double fps, char *s, char point )
 {
 	int hours, mins;
 	double secs;
@@ -967,7 +1148,11 @@ static void time_clock_from_frames( int frames, double fps, char *s )
 	frames -= floor( mins * 60  * fps );
 	secs = frames / fps;
 
-	sprintf( s, "%02d:%02d:%06.3f", hours, mins, secs );
+	s = format_int( s, hours, 2 );
+	*s++ = ':';
+	s = format_int( s, mins, 2 );
+	*s++ = ':';
+	format_seconds( s, secs, point );
 }
 
 /** Get the property as a time string.
@@ -979,15 +1164,14 @@ static void time_clock_from_frames( int frames, double fps, char *s )
  * \param self a property
  * \param format the time format that you want
  * \param fps frames per second
- * \param locale the locale to use for this conversion
+ * \param locale the locale to use for the decimal point of a clock value
  * \return a string representation of the property or NULL if failed
  */
 
 char *mlt_property_get_time( mlt_property self, mlt_time_format format, double fps, locale_t locale )
 {
-#if !defined(_WIN32)
-	char *orig_localename = NULL;
-#endif
+	char time[ 64 ];
+	size_t length;
 	int frames = 0;
 
 	// Remove existing string
@@ -998,36 +1182,8 @@ char *mlt_property_get_time( mlt_property self, mlt_time_format format, double f
 	if ( format == mlt_time_frames )
 		return mlt_property_get_string_l( self, locale );
 
-#if !defined(_WIN32)
-	// Use the specified locale
-	if ( locale )
-	{
-		// TODO: when glibc gets sprintf_l, start using it! For now, hack on setlocale.
-		// Save the current locale
-#if defined(__APPLE__)
-		const char *localename = querylocale( LC_NUMERIC_MASK, locale );
-#elif defined(__GLIBC__)
-		const char *localename = locale->__names[ LC_NUMERIC ];
-#else
-		// TODO: not yet sure what to do on other platforms
-		const char *localename = locale;
-#endif // _WIN32
-
-		// Protect damaging the global locale from a temporary locale on another thread.
-		pthread_mutex_lock( &self->mutex );
-
-		// Get the current locale
-		orig_localename = strdup( setlocale( LC_NUMERIC, NULL ) );
-
-		// Set the new locale
-		setlocale( LC_NUMERIC, localename );
-	}
-	else
-#endif // _WIN32
-	{
-		// Make sure we have a lock before accessing self->types
-		pthread_mutex_lock( &self->mutex );
-	}
+	// Make sure we have a lock before accessing self->types
+	pthread_mutex_lock( &self->mutex );
 
 	// Convert number to string
 	if ( self->types & mlt_prop_int )
@@ -1047,30 +1203,23 @@ char *mlt_property_get_time( mlt_property self, mlt_time_format format, double f
 		frames = (int) self->prop_int64;
 	}
 
-	self->types |= mlt_prop_string;
-	self->prop_string = malloc( 32 );
-
 	if ( format == mlt_time_clock )
-		time_clock_from_frames( frames, fps, self->prop_string );
+		time_clock_from_frames( frames, fps, time, decimal_point( locale ) );
 	else if ( format == mlt_time_smpte_ndf )
-		time_smpte_from_frames( frames, fps, self->prop_string, 0 );
+		time_smpte_from_frames( frames, fps, time, 0 );
 	else // Use smpte drop frame by default
-		time_smpte_from_frames( frames, fps, self->prop_string, 1 );
+		time_smpte_from_frames( frames, fps, time, 1 );
 
-#if !defined(_WIN32)
-	// Restore the current locale
-	if ( locale )
-	{
-		setlocale( LC_NUMERIC, orig_localename );
-		free( orig_localename );
-		pthread_mutex_unlock( &self->mutex );
-	}
-	else
-#endif // _WIN32
-	{
-		// Make sure we have a lock before accessing self->types
-		pthread_mutex_unlock( &self->mutex );
-	}
+	// Only a nonsensical frame rate can give a time that does not fit.
+	length = strlen( time );
+	if ( length >= sizeof( self->prop_buffer ) )
+		length = sizeof( self->prop_buffer ) - 1;
+	self->types |= mlt_prop_string;
+	self->prop_string = self->prop_buffer;
+	memcpy( self->prop_string, time, length );
+	self->prop_string[ length ] = 0;
+
+	pthread_mutex_unlock( &self->mutex );
 
 	// Return the string (may be NULL)
 	return self->prop_string;
@@ -1376,7 +1525,7 @@ char* mlt_property_anim_get_string( mlt_property self, double fps, locale_t loca
 			refresh_animation( self, fps, locale, length );
 		mlt_animation_get_item( self->animation, &item, position );
 
-		free( self->prop_string );
+		clear_string( self );
 
 		pthread_mutex_unlock( &self->mutex );
 		self->prop_string = mlt_property_get_string_l( item.property, locale );
@@ -44,6 +44,22 @@
 	CONTROL THIS IN EXTENDING CLASSES.
 */
 
+/** \brief the render plan of an attached filter
+ *
+ * The filter properties needed on every frame, kept until the filters are
+ * changed or one of these properties is set.
+ */
+
+typedef struct
+{
+	mlt_filter filter;
+	int serial;
+	mlt_position in;
+	mlt_position out;
+	int disable;
+}
+filter_plan;
+
 /** \brief private service definition */
 
 typedef struct
@@ -55,6 +71,9 @@ typedef struct
 	int filter_count;
 	int filter_size;
 	mlt_filter *filters;
+	filter_plan *plans;
+	int plan_serial;
+	pthread_mutex_t plan_mutex;
 	pthread_mutex_t mutex;
 }
 mlt_service_base;
@@ -102,6 +121,7 @@ int mlt_service_init( mlt_service self, void *child )
 		mlt_events_register( &self->parent, "service-changed", NULL );
 		mlt_events_register( &self->parent, "property-changed", ( mlt_transmitter )mlt_service_property_changed );
 		pthread_mutex_init( &( ( mlt_service_base * )self->local )->mutex, NULL );
+		pthread_mutex_init( &( ( mlt_service_base * )self->local )->plan_mutex, NULL );
 	}
 
 	return error;
@@ -523,6 +543,59 @@ mlt_properties mlt_service_properties( mlt_service self )
 	return self != NULL ? &self->parent : NULL;
 }
 
+/** Get the render plan of an attached filter.
+ *
+ * The plan is refreshed from the filter properties when the filters or the
+ * properties in the plan have changed since it was made. The plans are shared
+ * by the threads that get frames, so they are only touched with the plan lock.
+ * \private \memberof mlt_service_s
+ * \param base the private data of a service
+ * \param index the index of an attached filter
+ * \param[out] result a copy of the plan (optional)
+ */
+
+static void service_plan_filter( mlt_service_base *base, int index, filter_plan *result )
+{
+	pthread_mutex_lock( &base->plan_mutex );
+	filter_plan *plan = &base->plans[ index ];
+	mlt_filter filter = base->filters[ index ];
+
+	if ( plan->filter != filter || plan->serial != base->plan_serial )
+	{
+		plan->in = mlt_filter_get_in( filter );
+		plan->out = mlt_filter_get_out( filter );
+		plan->disable = mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "disable" );
+		plan->serial = base->plan_serial;
+		plan->filter = filter;
+	}
+	if ( result != NULL )
+		*result = *plan;
+	pthread_mutex_unlock( &base->plan_mutex );
+}
+
+/** Prepare a service for rendering.
+ *
+ * This makes the render plan of each attached filter ahead of the first
+ * frame. Plans are otherwise made and refreshed as frames are requested, so
+ * this is optional.
+ * \public \memberof mlt_service_s
+ * \param self a service
+ * \see mlt_consumer_start
+ */
+
+void mlt_service_prepare( mlt_service self )
+{
+	if ( self != NULL )
+	{
+		mlt_service_base *base = self->local;
+		int i;
+
+		for ( i = 0; i < base->filter_count; i ++ )
+			if ( base->filters[ i ] != NULL )
+				service_plan_filter( base, i, NULL );
+	}
+}
+
 /** Recursively apply attached filters.
  *
  * \public \memberof mlt_service_s
@@ -538,8 +611,9 @@ void mlt_service_apply_filters( mlt_service self, mlt_frame frame, int index )
 	mlt_properties service_properties = MLT_SERVICE_PROPERTIES( self );
 	mlt_service_base *base = self->local;
 	mlt_position position = mlt_frame_get_position( frame );
-	mlt_position self_in = mlt_properties_get_position( service_properties, "in" );
-	mlt_position self_out = mlt_properties_get_position( service_properties, "out" );
+	mlt_position self_in = 0;
+	mlt_position self_out = 0;
+	int self_known = 0;
 
 	if ( index == 0 || mlt_properties_get_int( service_properties, "_filter_private" ) == 0 )
 	{
@@ -548,11 +622,19 @@ void mlt_service_apply_filters( mlt_service self, mlt_frame frame, int index )
 		{
 			if ( base->filters[ i ] != NULL )
 			{
-				mlt_position in = mlt_filter_get_in( base->filters[ i ] );
-				mlt_position out = mlt_filter_get_out( base->filters[ i ] );
-				int disable = mlt_properties_get_int( MLT_FILTER_PROPERTIES( base->filters[ i ] ), "disable" );
-				if ( !disable && ( ( in == 0 && out == 0 ) || ( position >= in && ( position <= out || out == 0 ) ) ) )
+				filter_plan plan;
+				service_plan_filter( base, i, &plan );
+				mlt_position in = plan.in;
+				mlt_position out = plan.out;
+				if ( !plan.disable && ( ( in == 0 && out == 0 ) || ( position >= in && ( position <= out || out == 0 ) ) ) )
 				{
+					// The service in and out points change with the service, so only look them up when used
+					if ( !self_known && ( in == 0 || out == 0 ) )
+					{
+						self_in = mlt_properties_get_position( service_properties, "in" );
+						self_out = mlt_properties_get_position( service_properties, "out" );
+						self_known = 1;
+					}
 					mlt_properties_set_position( frame_properties, "in", in == 0 ? self_in : in );
 					mlt_properties_set_position( frame_properties, "out", out == 0 ? self_out : out );
 					mlt_filter_process( base->filters[ i ], frame );
@@ -667,6 +749,15 @@ static void mlt_service_filter_changed( mlt_service owner, mlt_service self )
 
 static void mlt_service_filter_property_changed( mlt_service owner, mlt_service self, char *name )
 {
+	// Refresh the render plans when a property they hold changes
+	if ( name == NULL || !strcmp( name, "in" ) || !strcmp( name, "out" ) ||
+		 !strcmp( name, "disable" ) || !strcmp( name, "_profile" ) )
+	{
+		mlt_service_base *base = self->local;
+		pthread_mutex_lock( &base->plan_mutex );
+		base->plan_serial ++;
+		pthread_mutex_unlock( &base->plan_mutex );
+	}
     mlt_events_fire( MLT_SERVICE_PROPERTIES( self ), "property-changed", name, NULL );
 }
 
@@ -693,17 +784,31 @@ int mlt_service_attach( mlt_service self, mlt_filter filter )
 
 		if ( error == 0 )
 		{
+			pthread_mutex_lock( &base->plan_mutex );
 			if ( base->filter_count == base->filter_size )
 			{
-				base->filter_size += 10;
-				base->filters = realloc( base->filters, base->filter_size * sizeof( mlt_filter ) );
+				int size = base->filter_size + 10;
+				mlt_filter *filters = realloc( base->filters, size * sizeof( mlt_filter ) );
+				if ( filters != NULL )
+				{
+					filter_plan *plans = realloc( base->plans, size * sizeof( filter_plan ) );
+					base->filters = filters;
+					if ( plans != NULL )
+					{
+						base->plans = plans;
+						base->filter_size = size;
+					}
+				}
 			}
 
-			if ( base->filters != NULL )
+			if ( base->filter_count < base->filter_size )
 			{
 				mlt_properties props = MLT_FILTER_PROPERTIES( filter );
 				mlt_properties_inc_ref( MLT_FILTER_PROPERTIES( filter ) );
+				memset( &base->plans[ base->filter_count ], 0, sizeof( filter_plan ) );
 				base->filters[ base->filter_count ++ ] = filter;
+				base->plan_serial ++;
+				pthread_mutex_unlock( &base->plan_mutex );
 				mlt_properties_set_data( props, "service", self, 0, NULL, NULL );
 				mlt_events_fire( properties, "service-changed", NULL );
 				mlt_events_fire( props, "service-changed", NULL );
@@ -715,6 +820,7 @@ int mlt_service_attach( mlt_service self, mlt_filter filter )
 			}
 			else
 			{
+				pthread_mutex_unlock( &base->plan_mutex );
 				error = 2;
 			}
 		}
@@ -745,10 +851,13 @@ int mlt_service_detach( mlt_service self, mlt_filter filter )
 
 		if ( i < base->filter_count )
 		{
+			pthread_mutex_lock( &base->plan_mutex );
 			base->filters[ i ] = NULL;
 			for ( i ++ ; i < base->filter_count; i ++ )
 				base->filters[ i - 1 ] = base->filters[ i ];
 			base->filter_count --;
+			base->plan_serial ++;
+			pthread_mutex_unlock( &base->plan_mutex );
 			mlt_events_disconnect( MLT_FILTER_PROPERTIES( filter ), self );
 			mlt_filter_close( filter );
 			mlt_events_fire( properties, "service-changed", NULL );
@@ -798,6 +907,7 @@ int mlt_service_move_filter( mlt_service self, int from, int to )
 		{
 			mlt_filter filter = base->filters[from];
 			int i;
+			pthread_mutex_lock( &base->plan_mutex );
 			if ( from > to )
 			{
 				for ( i = from; i > to; i-- )
@@ -809,6 +919,8 @@ int mlt_service_move_filter( mlt_service self, int from, int to )
 					base->filters[i] = base->filters[i + 1];
 			}
 			base->filters[to] = filter;
+			base->plan_serial ++;
+			pthread_mutex_unlock( &base->plan_mutex );
 			mlt_events_fire( MLT_SERVICE_PROPERTIES(self), "service-changed", NULL );
 			error = 0;
 		}
@@ -883,12 +995,14 @@ void mlt_service_close( mlt_service self )
 			while( count -- )
 				mlt_service_detach( self, base->filters[ 0 ] );
 			free( base->filters );
+			free( base->plans );
 			for ( i = 0; i < base->count; i ++ )
 				if ( base->in[ i ] != NULL )
 					mlt_service_close( base->in[ i ] );
 			self->parent.close = NULL;
 			free( base->in );
 			pthread_mutex_destroy( &base->mutex );
+			pthread_mutex_destroy( &base->plan_mutex );
 			free( base );
 			mlt_properties_close( &self->parent );
 		}
@@ -959,7 +1073,7 @@ static mlt_cache get_cache( mlt_service self, const char *name )
 
 void mlt_service_cache_put( mlt_service self, const char *name, void* data, int size, mlt_destructor destructor )
 {
-	mlt_log( self, MLT_LOG_DEBUG, "%s: name %s object %p data %p\n", __FUNCTION__, name, self, data );
+	mlt_log_debug( self, "%s: name %s object %p data %p\n", __FUNCTION__, name, self, data );
 	mlt_cache cache = get_cache( self, name );
 
 	if ( cache )
@@ -971,13 +1085,14 @@ void mlt_service_cache_put( mlt_service self, const char *name, void* data, int
  * \public \memberof mlt_service_s
  * \param self a service
  * \param name a name for the object that is unique to the service class, but not to the instance
- * \return a cache item or NULL if an object is not found
+ * \return a cache item or NULL if an object is not found, which must be closed exactly once
  * \see mlt_cache_item_data
+ * \see mlt_cache_item_close
  */
 
 mlt_cache_item mlt_service_cache_get( mlt_service self, const char *name )
 {
-	mlt_log( self, MLT_LOG_DEBUG, "%s: name %s object %p\n", __FUNCTION__, name, self );
+	mlt_log_debug( self, "%s: name %s object %p\n", __FUNCTION__, name, self );
 	mlt_cache_item result = NULL;
 	mlt_cache cache = get_cache( self, name );
 
@@ -411,13 +411,8 @@ static int transition_get_frame( mlt_service service, mlt_frame_ptr frame, int i
 
 	mlt_properties properties = MLT_TRANSITION_PROPERTIES( self );
 
-	int accepts_blanks = mlt_properties_get_int( properties, "accepts_blanks" );
 	int a_track = mlt_properties_get_int( properties, "a_track" );
 	int b_track = mlt_properties_get_int( properties, "b_track" );
-	mlt_position in = mlt_properties_get_position( properties, "in" );
-	mlt_position out = mlt_properties_get_position( properties, "out" );
-	int always_active = mlt_properties_get_int( properties, "always_active" );
-	int type = mlt_properties_get_int( properties, "_transition_type" );
 	int reverse_order = 0;
 
 	// Ensure that we have the correct order
@@ -433,6 +428,12 @@ static int transition_get_frame( mlt_service service, mlt_frame_ptr frame, int i
 	// Only act on this operation once per multitrack iteration from the tractor
 	if ( !self->held )
 	{
+		// The rest of the transition properties are only needed once per iteration
+		int accepts_blanks = mlt_properties_get_int( properties, "accepts_blanks" );
+		mlt_position in = mlt_properties_get_position( properties, "in" );
+		mlt_position out = mlt_properties_get_position( properties, "out" );
+		int always_active = mlt_properties_get_int( properties, "always_active" );
+		int type = mlt_properties_get_int( properties, "_transition_type" );
 		int active = 0;
 		int i = 0;
 		int a_frame = a_track;
@@ -20,6 +20,7 @@
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
+#include <framework/mlt_slices.h>
 
 #include <string.h>
 #include <stdlib.h>
@@ -28,205 +29,169 @@
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 
-#ifdef USE_MMX
-#include "mmx.h"
-#else
-#define MAX_NEG_CROP 1024
-static uint8_t ff_cropTbl[256 + 2 * MAX_NEG_CROP] = {0,};
+#ifdef USE_SSE2
+#include <emmintrin.h>
 #endif
 
-#ifdef USE_MMX
-#define DEINT_INPLACE_LINE_LUM \
-                    movd_m2r(lum_m4[0],mm0);\
-                    movd_m2r(lum_m3[0],mm1);\
-                    movd_m2r(lum_m2[0],mm2);\
-                    movd_m2r(lum_m1[0],mm3);\
-                    movd_m2r(lum[0],mm4);\
-                    punpcklbw_r2r(mm7,mm0);\
-                    movd_r2m(mm2,lum_m4[0]);\
-                    punpcklbw_r2r(mm7,mm1);\
-                    punpcklbw_r2r(mm7,mm2);\
-                    punpcklbw_r2r(mm7,mm3);\
-                    punpcklbw_r2r(mm7,mm4);\
-                    paddw_r2r(mm3,mm1);\
-                    psllw_i2r(1,mm2);\
-                    paddw_r2r(mm4,mm0);\
-                    psllw_i2r(2,mm1);\
-                    paddw_r2r(mm6,mm2);\
-                    paddw_r2r(mm2,mm1);\
-                    psubusw_r2r(mm0,mm1);\
-                    psrlw_i2r(3,mm1);\
-                    packuswb_r2r(mm7,mm1);\
-                    movd_r2m(mm1,lum_m2[0]);
-
-#define DEINT_LINE_LUM \
-                    movd_m2r(lum_m4[0],mm0);\
-                    movd_m2r(lum_m3[0],mm1);\
-                    movd_m2r(lum_m2[0],mm2);\
-                    movd_m2r(lum_m1[0],mm3);\
-                    movd_m2r(lum[0],mm4);\
-                    punpcklbw_r2r(mm7,mm0);\
-                    punpcklbw_r2r(mm7,mm1);\
-                    punpcklbw_r2r(mm7,mm2);\
-                    punpcklbw_r2r(mm7,mm3);\
-                    punpcklbw_r2r(mm7,mm4);\
-                    paddw_r2r(mm3,mm1);\
-                    psllw_i2r(1,mm2);\
-                    paddw_r2r(mm4,mm0);\
-                    psllw_i2r(2,mm1);\
-                    paddw_r2r(mm6,mm2);\
-                    paddw_r2r(mm2,mm1);\
-                    psubusw_r2r(mm0,mm1);\
-                    psrlw_i2r(3,mm1);\
-                    packuswb_r2r(mm7,mm1);\
-                    movd_r2m(mm1,dst[0]);
-#endif
-
-/* filter parameters: [-1 4 2 4 -1] // 8 */
-static inline void deinterlace_line(uint8_t *dst, 
-			     const uint8_t *lum_m4, const uint8_t *lum_m3, 
-			     const uint8_t *lum_m2, const uint8_t *lum_m1, 
+/* filter parameters: [-1 4 2 4 -1] // 8
+ * Each output byte only depends on the bytes above and below it, so dst may
+ * be the same line as lum_m2.
+ */
+static inline void deinterlace_line(uint8_t *dst,
+			     const uint8_t *lum_m4, const uint8_t *lum_m3,
+			     const uint8_t *lum_m2, const uint8_t *lum_m1,
 			     const uint8_t *lum,
 			     int size)
 {
-#ifndef USE_MMX
-    uint8_t *cm = ff_cropTbl + MAX_NEG_CROP;
-    int sum;
-
-    for(;size > 0;size--) {
-        sum = -lum_m4[0];
-        sum += lum_m3[0] << 2;
-        sum += lum_m2[0] << 1;
-        sum += lum_m1[0] << 2;
-        sum += -lum[0];
-        dst[0] = cm[(sum + 4) >> 3];
-        lum_m4++;
-        lum_m3++;
-        lum_m2++;
-        lum_m1++;
-        lum++;
-        dst++;
-    }
-#else
-
-    {
-        mmx_t rounder;
-        rounder.uw[0]=4;
-        rounder.uw[1]=4;
-        rounder.uw[2]=4;
-        rounder.uw[3]=4;
-        pxor_r2r(mm7,mm7);
-        movq_m2r(rounder,mm6);
-    }
-    for (;size > 3; size-=4) {
-        DEINT_LINE_LUM
-        lum_m4+=4;
-        lum_m3+=4;
-        lum_m2+=4;
-        lum_m1+=4;
-        lum+=4;
-        dst+=4;
+    int i = 0;
+
+#ifdef USE_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i rounder = _mm_set1_epi16(4);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i m4 = _mm_loadu_si128((const __m128i*)(lum_m4 + i));
+        __m128i m3 = _mm_loadu_si128((const __m128i*)(lum_m3 + i));
+        __m128i m2 = _mm_loadu_si128((const __m128i*)(lum_m2 + i));
+        __m128i m1 = _mm_loadu_si128((const __m128i*)(lum_m1 + i));
+        __m128i m0 = _mm_loadu_si128((const __m128i*)(lum + i));
+        __m128i lo, hi;
+
+        lo = _mm_slli_epi16(_mm_add_epi16(_mm_unpacklo_epi8(m3, zero), _mm_unpacklo_epi8(m1, zero)), 2);
+        lo = _mm_add_epi16(lo, _mm_slli_epi16(_mm_unpacklo_epi8(m2, zero), 1));
+        lo = _mm_sub_epi16(_mm_add_epi16(lo, rounder), _mm_add_epi16(_mm_unpacklo_epi8(m4, zero), _mm_unpacklo_epi8(m0, zero)));
+        hi = _mm_slli_epi16(_mm_add_epi16(_mm_unpackhi_epi8(m3, zero), _mm_unpackhi_epi8(m1, zero)), 2);
+        hi = _mm_add_epi16(hi, _mm_slli_epi16(_mm_unpackhi_epi8(m2, zero), 1));
+        hi = _mm_sub_epi16(_mm_add_epi16(hi, rounder), _mm_add_epi16(_mm_unpackhi_epi8(m4, zero), _mm_unpackhi_epi8(m0, zero)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_srai_epi16(lo, 3), _mm_srai_epi16(hi, 3)));
     }
 #endif
+
+    for (; i < size; i++) {
+        int sum = -lum_m4[i];
+        sum += lum_m3[i] << 2;
+        sum += lum_m2[i] << 1;
+        sum += lum_m1[i] << 2;
+        sum += -lum[i];
+        dst[i] = CLAMP((sum + 4) >> 3, 0, 255);
+    }
+}
+
+/* deinterlacing : 2 temporal taps, 3 spatial taps linear filter. The
+   top field is copied as is, but the bottom field is deinterlaced
+   against the top field. The lines of the bottom field are split
+   between the slice threads. */
+typedef struct
+{
+    uint8_t *dst;
+    int dst_wrap;
+    const uint8_t *src;
+    int src_wrap;
+    int width;
+    int height;
+    uint8_t *edges;     // in place only: the bottom field lines either side of each slice
+} deinterlace_desc;
+
+static void field_slice(deinterlace_desc *desc, int idx, int jobs, int *first, int *last)
+{
+    int lines = desc->height / 2;
+    int size = (lines + jobs - 1) / jobs;
+
+    *first = 2 * MIN(idx * size, lines) + 1;
+    *last = 2 * MIN(idx * size + size, lines) + 1;
 }
-static inline void deinterlace_line_inplace(uint8_t *lum_m4, uint8_t *lum_m3, uint8_t *lum_m2, uint8_t *lum_m1, uint8_t *lum,
-                             int size)
+
+static const uint8_t *field_line(const uint8_t *src, int wrap, int height, int y)
 {
-#ifndef USE_MMX
-    uint8_t *cm = ff_cropTbl + MAX_NEG_CROP;
-    int sum;
-
-    for(;size > 0;size--) {
-        sum = -lum_m4[0];
-        sum += lum_m3[0] << 2;
-        sum += lum_m2[0] << 1;
-        lum_m4[0]=lum_m2[0];
-        sum += lum_m1[0] << 2;
-        sum += -lum[0];
-        lum_m2[0] = cm[(sum + 4) >> 3];
-        lum_m4++;
-        lum_m3++;
-        lum_m2++;
-        lum_m1++;
-        lum++;
-    }
-#else
-
-    {
-        mmx_t rounder;
-        rounder.uw[0]=4;
-        rounder.uw[1]=4;
-        rounder.uw[2]=4;
-        rounder.uw[3]=4;
-        pxor_r2r(mm7,mm7);
-        movq_m2r(rounder,mm6);
+    return src + CLAMP(y, 0, height - 1) * wrap;
+}
+
+static int deinterlace_bottom_field_slice(int id, int idx, int jobs, void *cookie)
+{
+    deinterlace_desc *desc = cookie;
+    int y, first, last;
+
+    field_slice(desc, idx, jobs, &first, &last);
+    for (y = first; y < last; y += 2) {
+        memcpy(desc->dst + (y - 1) * desc->dst_wrap, desc->src + (y - 1) * desc->src_wrap, desc->width);
+        deinterlace_line(desc->dst + y * desc->dst_wrap,
+                         field_line(desc->src, desc->src_wrap, desc->height, y - 2),
+                         field_line(desc->src, desc->src_wrap, desc->height, y - 1),
+                         field_line(desc->src, desc->src_wrap, desc->height, y),
+                         field_line(desc->src, desc->src_wrap, desc->height, y + 1),
+                         field_line(desc->src, desc->src_wrap, desc->height, y + 2),
+                         desc->width);
     }
-    for (;size > 3; size-=4) {
-        DEINT_INPLACE_LINE_LUM
-        lum_m4+=4;
-        lum_m3+=4;
-        lum_m2+=4;
-        lum_m1+=4;
-        lum+=4;
+    return 0;
+}
+
+static int deinterlace_bottom_field_inplace_slice(int id, int idx, int jobs, void *cookie)
+{
+    deinterlace_desc *desc = cookie;
+    int width = desc->width;
+    int y, first, last;
+    uint8_t *above = desc->edges + 2 * idx * width;
+    uint8_t *below = above + width;
+    uint8_t *buf = malloc(2 * width);
+    uint8_t *prev = buf;
+    uint8_t *next = buf + width;
+
+    field_slice(desc, idx, jobs, &first, &last);
+    if (first < last)
+        memcpy(prev, above, width);
+    for (y = first; y < last; y += 2) {
+        uint8_t *line = desc->dst + y * desc->dst_wrap;
+        const uint8_t *lum = y + 2 >= last && y + 2 < desc->height ? below :
+                             field_line(desc->dst, desc->dst_wrap, desc->height, y + 2);
+        uint8_t *t;
+
+        // Keep the original line for the one below
+        memcpy(next, line, width);
+        deinterlace_line(line, prev,
+                         field_line(desc->dst, desc->dst_wrap, desc->height, y - 1),
+                         next,
+                         field_line(desc->dst, desc->dst_wrap, desc->height, y + 1),
+                         y + 2 < desc->height ? lum : next,
+                         width);
+        t = prev;
+        prev = next;
+        next = t;
     }
-#endif
+    free(buf);
+    return 0;
 }
 
-/* deinterlacing : 2 temporal taps, 3 spatial taps linear filter. The
-   top field is copied as is, but the bottom field is deinterlaced
-   against the top field. */
-static inline void deinterlace_bottom_field(uint8_t *dst, int dst_wrap,
+static void deinterlace_bottom_field(uint8_t *dst, int dst_wrap,
                                     const uint8_t *src1, int src_wrap,
                                     int width, int height)
 {
-    const uint8_t *src_m2, *src_m1, *src_0, *src_p1, *src_p2;
-    int y;
-
-    src_m2 = src1;
-    src_m1 = src1;
-    src_0=&src_m1[src_wrap];
-    src_p1=&src_0[src_wrap];
-    src_p2=&src_p1[src_wrap];
-    for(y=0;y<(height-2);y+=2) {
-        memcpy(dst,src_m1,width);
-        dst += dst_wrap;
-        deinterlace_line(dst,src_m2,src_m1,src_0,src_p1,src_p2,width);
-        src_m2 = src_0;
-        src_m1 = src_p1;
-        src_0 = src_p2;
-        src_p1 += 2*src_wrap;
-        src_p2 += 2*src_wrap;
-        dst += dst_wrap;
-    }
-    memcpy(dst,src_m1,width);
-    dst += dst_wrap;
-    /* do last line */
-    deinterlace_line(dst,src_m2,src_m1,src_0,src_0,src_0,width);
+    deinterlace_desc desc = { dst, dst_wrap, src1, src_wrap, width, height, NULL };
+    int jobs = MIN(height / 2, mlt_slices_count_normal());
+
+    if (jobs > 0)
+        mlt_slices_run_normal(jobs, deinterlace_bottom_field_slice, &desc);
 }
 
-static inline void deinterlace_bottom_field_inplace(uint8_t *src1, int src_wrap,
+static void deinterlace_bottom_field_inplace(uint8_t *src1, int src_wrap,
 					     int width, int height)
 {
-    uint8_t *src_m1, *src_0, *src_p1, *src_p2;
-    int y;
-    uint8_t *buf;
-    buf = (uint8_t*)av_malloc(width);
-
-    src_m1 = src1;
-    memcpy(buf,src_m1,width);
-    src_0=&src_m1[src_wrap];
-    src_p1=&src_0[src_wrap];
-    src_p2=&src_p1[src_wrap];
-    for(y=0;y<(height-2);y+=2) {
-        deinterlace_line_inplace(buf,src_m1,src_0,src_p1,src_p2,width);
-        src_m1 = src_p1;
-        src_0 = src_p2;
-        src_p1 += 2*src_wrap;
-        src_p2 += 2*src_wrap;
+    deinterlace_desc desc = { src1, src_wrap, src1, src_wrap, width, height, NULL };
+    int jobs = MIN(height / 2, mlt_slices_count_normal());
+    int i;
+
+    if (jobs <= 0)
+        return;
+
+    // Save the lines that neighbouring slices overwrite before they are read
+    desc.edges = malloc(2 * jobs * width);
+    for (i = 0; i < jobs; i++) {
+        int first, last;
+        field_slice(&desc, i, jobs, &first, &last);
+        memcpy(desc.edges + 2 * i * width, field_line(src1, src_wrap, height, first - 2), width);
+        memcpy(desc.edges + (2 * i + 1) * width, field_line(src1, src_wrap, height, last), width);
     }
-    /* do last line */
-    deinterlace_line_inplace(buf,src_m1,src_0,src_0,src_0,width);
-    av_free(buf);
+    mlt_slices_run_normal(jobs, deinterlace_bottom_field_inplace_slice, &desc);
+    free(desc.edges);
 }
 
 
@@ -285,9 +250,6 @@ static int mlt_avpicture_deinterlace(uint8_t *dst_data[4], int dst_stride[4],
       }
 	}
 
-#ifdef USE_MMX
-    emms();
-#endif
     return 0;
 }
 
@@ -343,17 +305,6 @@ static mlt_frame deinterlace_process( mlt_filter filter, mlt_frame frame )
 
 mlt_filter filter_avdeinterlace_init( void *arg )
 {
-#ifndef USE_MMX
-	if ( ff_cropTbl[MAX_NEG_CROP + 1] == 0 )
-	{
-		int i;
-		for(i=0;i<256;i++) ff_cropTbl[i + MAX_NEG_CROP] = i;
-		for(i=0;i<MAX_NEG_CROP;i++) {
-			ff_cropTbl[i] = 0;
-			ff_cropTbl[i + MAX_NEG_CROP + 256] = 255;
-		}
-	}
-#endif
 	mlt_filter filter = mlt_filter_new( );
 	if ( filter != NULL )
 		filter->process = deinterlace_process;
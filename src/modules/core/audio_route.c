@@ -0,0 +1,466 @@
+/*
+ * audio_route.c -- channel routing shared by the audio channel filters
+ * Copyright (C) 2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "audio_route.h"
+
+#include <framework/mlt_deque.h>
+#include <framework/mlt_log.h>
+#include <framework/mlt_pool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef USE_SSE
+#include <xmmintrin.h>
+#endif
+
+/** The most filters fused into one pass.
+*/
+
+#define MAX_STAGES 16
+
+/** Samples converted to float at a time when mixing.
+*/
+
+#define BLOCK 256
+
+/** The routing filters queued on a frame with nothing between them.
+*/
+
+typedef struct
+{
+	int count;
+	mlt_filter filter[ MAX_STAGES ];
+	audio_route_build build[ MAX_STAGES ];
+} audio_route;
+
+/** Size a matrix and clear its gains, releasing any previous ones.
+ *
+ * Returns true on error.
+ */
+
+int audio_matrix_init( audio_matrix *matrix, int in, int out )
+{
+	free( matrix->gain );
+	matrix->in = in;
+	matrix->out = out;
+	matrix->gain = calloc( in * out, sizeof( *matrix->gain ) );
+	return matrix->gain == NULL;
+}
+
+int audio_matrix_identity( audio_matrix *matrix, int channels )
+{
+	int i;
+
+	if ( audio_matrix_init( matrix, channels, channels ) )
+		return 1;
+	for ( i = 0; i < channels; i ++ )
+		AUDIO_MATRIX_GAIN( matrix, i, i ) = 1.0;
+	return 0;
+}
+
+void audio_matrix_close( audio_matrix *matrix )
+{
+	free( matrix->gain );
+	matrix->gain = NULL;
+}
+
+/** Follow matrix a with b, leaving the product in a.
+ *
+ * Returns true on error, leaving a unchanged.
+ */
+
+static int matrix_then( audio_matrix *a, const audio_matrix *b )
+{
+	audio_matrix result = { 0, 0, NULL };
+	int o, k, i;
+
+	if ( audio_matrix_init( &result, a->in, b->out ) )
+		return 1;
+	for ( o = 0; o < b->out; o ++ )
+		for ( k = 0; k < b->in && k < a->out; k ++ )
+			if ( AUDIO_MATRIX_GAIN( b, o, k ) != 0.0f )
+				for ( i = 0; i < a->in; i ++ )
+					AUDIO_MATRIX_GAIN( &result, o, i ) += AUDIO_MATRIX_GAIN( b, o, k ) * AUDIO_MATRIX_GAIN( a, k, i );
+	audio_matrix_close( a );
+	*a = result;
+	return 0;
+}
+
+/** Find the input each output copies, or -1 for silence.
+ *
+ * Returns false when some output is a mix or a scaled copy.
+ */
+
+static int matrix_routes( const audio_matrix *m, int *source )
+{
+	int o, i;
+
+	for ( o = 0; o < m->out; o ++ )
+	{
+		source[ o ] = -1;
+		for ( i = 0; i < m->in; i ++ )
+		{
+			if ( AUDIO_MATRIX_GAIN( m, o, i ) == 0.0f )
+				continue;
+			if ( AUDIO_MATRIX_GAIN( m, o, i ) != 1.0f || source[ o ] != -1 )
+				return 0;
+			source[ o ] = i;
+		}
+	}
+	return 1;
+}
+
+static int is_planar( mlt_audio_format format )
+{
+	return format == mlt_audio_s32 || format == mlt_audio_float;
+}
+
+/** Copy whole channels, which is exact for every format.
+ *
+ * Interleaved audio may be routed in place when out <= in.
+ * Returns true on error.
+ */
+
+static int route_copy( uint8_t *dst, const uint8_t *src, const int *source, int in, int out, int samples, mlt_audio_format format )
+{
+	int size = mlt_audio_format_size( format, 1, 1 );
+	int silence = format == mlt_audio_u8 ? 128 : 0;
+	uint8_t *frame;
+	int s, o;
+
+	if ( is_planar( format ) )
+	{
+		for ( o = 0; o < out; o ++ )
+		{
+			if ( source[ o ] < 0 )
+				memset( dst + o * samples * size, silence, samples * size );
+			else
+				memcpy( dst + o * samples * size, src + source[ o ] * samples * size, samples * size );
+		}
+		return 0;
+	}
+
+	// Each sample is gathered aside first, as it may be routed in place
+	frame = malloc( out * size );
+	if ( frame == NULL )
+		return 1;
+	for ( s = 0; s < samples; s ++ )
+	{
+		const uint8_t *p = src + s * in * size;
+
+		for ( o = 0; o < out; o ++ )
+		{
+			if ( source[ o ] < 0 )
+				memset( frame + o * size, silence, size );
+			else if ( size == 2 )
+				memcpy( frame + o * 2, p + source[ o ] * 2, 2 );
+			else if ( size == 4 )
+				memcpy( frame + o * 4, p + source[ o ] * 4, 4 );
+			else
+				frame[ o ] = p[ source[ o ] ];
+		}
+		memcpy( dst + s * out * size, frame, out * size );
+	}
+	free( frame );
+	return 0;
+}
+
+/** Convert count samples from start into one float plane per channel.
+*/
+
+static void load_block( float *planes, const void *buffer, mlt_audio_format format, int channels, int samples, int start, int count )
+{
+	int c, j;
+
+	for ( c = 0; c < channels; c ++ )
+	{
+		float *plane = planes + c * BLOCK;
+		int offset = is_planar( format ) ? c * samples + start : start * channels + c;
+		int step = is_planar( format ) ? 1 : channels;
+
+		switch ( format )
+		{
+			case mlt_audio_u8:
+			{
+				const uint8_t *p = ( const uint8_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					plane[ j ] = ( int )*p - 128;
+				break;
+			}
+			case mlt_audio_s16:
+			{
+				const int16_t *p = ( const int16_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					plane[ j ] = *p;
+				break;
+			}
+			case mlt_audio_s32:
+			case mlt_audio_s32le:
+			{
+				const int32_t *p = ( const int32_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					plane[ j ] = *p;
+				break;
+			}
+			default:
+			{
+				const float *p = ( const float* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					plane[ j ] = *p;
+				break;
+			}
+		}
+		for ( ; j < BLOCK; j ++ )
+			plane[ j ] = 0.0f;
+	}
+}
+
+/** Convert the float planes back, clipping integer formats.
+*/
+
+static void store_block( const float *planes, void *buffer, mlt_audio_format format, int channels, int samples, int start, int count )
+{
+	int c, j;
+
+	for ( c = 0; c < channels; c ++ )
+	{
+		const float *plane = planes + c * BLOCK;
+		int offset = is_planar( format ) ? c * samples + start : start * channels + c;
+		int step = is_planar( format ) ? 1 : channels;
+
+		switch ( format )
+		{
+			case mlt_audio_u8:
+			{
+				uint8_t *p = ( uint8_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					*p = ( int )CLAMP( plane[ j ], -128.0f, 127.0f ) + 128;
+				break;
+			}
+			case mlt_audio_s16:
+			{
+				int16_t *p = ( int16_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					*p = CLAMP( plane[ j ], INT16_MIN, INT16_MAX );
+				break;
+			}
+			case mlt_audio_s32:
+			case mlt_audio_s32le:
+			{
+				int32_t *p = ( int32_t* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					*p = CLAMP( ( double )plane[ j ], INT32_MIN, INT32_MAX );
+				break;
+			}
+			default:
+			{
+				float *p = ( float* )buffer + offset;
+				for ( j = 0; j < count; j ++, p += step )
+					*p = plane[ j ];
+				break;
+			}
+		}
+	}
+}
+
+/** Accumulate gain times a block of src into dst.
+*/
+
+static void mix_block( float *dst, const float *src, float gain )
+{
+	int j = 0;
+
+#ifdef USE_SSE
+	__m128 g = _mm_set1_ps( gain );
+	for ( ; j < BLOCK; j += 4 )
+		_mm_storeu_ps( dst + j, _mm_add_ps( _mm_loadu_ps( dst + j ), _mm_mul_ps( g, _mm_loadu_ps( src + j ) ) ) );
+#endif
+	for ( ; j < BLOCK; j ++ )
+		dst[ j ] += gain * src[ j ];
+}
+
+/** Run a block at a time through the matrix.
+ *
+ * When there are no more outputs than inputs dst may be src: a block is
+ * converted out before anything is written, and the output of a block
+ * never reaches past the input of the same block.
+ */
+
+static int mix( void *dst, const void *src, const audio_matrix *m, mlt_audio_format format, int samples )
+{
+	float *in = malloc( ( m->in + m->out ) * BLOCK * sizeof( float ) );
+	float *out = in + m->in * BLOCK;
+	int start, o, i;
+
+	if ( in == NULL )
+		return 1;
+
+	for ( start = 0; start < samples; start += BLOCK )
+	{
+		int count = MIN( BLOCK, samples - start );
+
+		load_block( in, src, format, m->in, samples, start, count );
+		memset( out, 0, m->out * BLOCK * sizeof( float ) );
+		for ( o = 0; o < m->out; o ++ )
+			for ( i = 0; i < m->in; i ++ )
+				if ( AUDIO_MATRIX_GAIN( m, o, i ) != 0.0f )
+					mix_block( out + o * BLOCK, in + i * BLOCK, AUDIO_MATRIX_GAIN( m, o, i ) );
+		store_block( out, dst, format, m->out, samples, start, count );
+	}
+
+	free( in );
+	return 0;
+}
+
+static int matrix_apply( mlt_frame frame, const audio_matrix *m, void **buffer, mlt_audio_format format, int samples )
+{
+	int *source;
+	int routes;
+	int size = mlt_audio_format_size( format, samples, m->out );
+	uint8_t *dst = *buffer;
+	int error = 0;
+	int o;
+
+	switch ( format )
+	{
+		case mlt_audio_u8:
+		case mlt_audio_s16:
+		case mlt_audio_s32:
+		case mlt_audio_s32le:
+		case mlt_audio_float:
+		case mlt_audio_f32le:
+			break;
+		default:
+			mlt_log_error( NULL, "[audio_route] Invalid audio format %s\n", mlt_audio_format_name( format ) );
+			return 1;
+	}
+
+	source = malloc( m->out * sizeof( *source ) );
+	if ( source == NULL )
+		return 1;
+	routes = matrix_routes( m, source );
+
+	// Nothing to do for an identity
+	if ( routes && m->in == m->out )
+	{
+		for ( o = 0; o < m->out && source[ o ] == o; o ++ );
+		if ( o == m->out )
+		{
+			free( source );
+			return 0;
+		}
+	}
+
+	if ( m->out > m->in || ( routes && is_planar( format ) ) )
+	{
+		dst = mlt_pool_alloc( size );
+		if ( dst == NULL )
+		{
+			free( source );
+			return 1;
+		}
+	}
+
+	if ( routes )
+		error = route_copy( dst, *buffer, source, m->in, m->out, samples, format );
+	else
+		error = mix( dst, *buffer, m, format, samples );
+	free( source );
+
+	// Update the audio buffer now - destroys the old
+	if ( error )
+	{
+		if ( dst != *buffer )
+			mlt_pool_release( dst );
+	}
+	else if ( dst != *buffer )
+	{
+		mlt_frame_set_audio( frame, dst, format, size, mlt_pool_release );
+		*buffer = dst;
+	}
+	return error;
+}
+
+/** Get the audio and route it through every queued filter at once.
+*/
+
+static int route_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	audio_route *route = mlt_frame_pop_audio( frame );
+	int requested = *channels;
+	audio_matrix total = { 0, 0, NULL };
+	audio_matrix stage = { 0, 0, NULL };
+	int i;
+
+	// Get the producer's audio
+	int error = mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+	if ( error || *buffer == NULL || *channels < 1 )
+		return error;
+
+	// Multiply the matrices of all the filters and apply the product
+	if ( audio_matrix_identity( &total, *channels ) )
+		return error;
+	for ( i = 0; i < route->count; i ++ )
+	{
+		if ( route->build[ i ]( route->filter[ i ], &stage, total.out, requested ) == 0 )
+			matrix_then( &total, &stage );
+	}
+	if ( matrix_apply( frame, &total, buffer, *format, *samples ) == 0 )
+		*channels = total.out;
+	audio_matrix_close( &stage );
+	audio_matrix_close( &total );
+
+	return error;
+}
+
+/** Queue the routing of a filter on a frame.
+ *
+ * Filters calling this back to back, with no other audio processing pushed
+ * in between, share a single pass over the audio.
+ */
+
+void audio_route_push( mlt_frame frame, mlt_filter filter, audio_route_build build )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	audio_route *route = NULL;
+
+	if ( mlt_deque_peek_back( MLT_FRAME_AUDIO_STACK( frame ) ) == route_get_audio )
+		route = mlt_properties_get_data( properties, "_audio_route", NULL );
+
+	if ( route == NULL || route->count == MAX_STAGES )
+	{
+		int index = mlt_properties_get_int( properties, "_audio_routes" );
+		char name[ 32 ];
+
+		route = calloc( 1, sizeof( *route ) );
+		if ( route == NULL )
+			return;
+		snprintf( name, sizeof( name ), "_audio_route.%d", index );
+		mlt_properties_set_int( properties, "_audio_routes", index + 1 );
+		mlt_properties_set_data( properties, name, route, 0, free, NULL );
+		mlt_properties_set_data( properties, "_audio_route", route, 0, NULL, NULL );
+		mlt_frame_push_audio( frame, route );
+		mlt_frame_push_audio( frame, route_get_audio );
+	}
+
+	route->filter[ route->count ] = filter;
+	route->build[ route->count ++ ] = build;
+}
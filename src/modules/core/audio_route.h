@@ -0,0 +1,57 @@
+/*
+ * audio_route.h -- channel routing shared by the audio channel filters
+ * Copyright (C) 2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _AUDIO_ROUTE_H_
+#define _AUDIO_ROUTE_H_
+
+#include <framework/mlt_filter.h>
+#include <framework/mlt_frame.h>
+
+/** A gain matrix taking in channels to out channels.
+ *
+ * The gains are allocated by audio_matrix_init(); start from a zeroed
+ * matrix and release it with audio_matrix_close().
+ */
+
+typedef struct
+{
+	int in;
+	int out;
+	float *gain;
+} audio_matrix;
+
+/** The contribution of input channel i to output channel o.
+ */
+
+#define AUDIO_MATRIX_GAIN( matrix, o, i ) ( ( matrix )->gain[ ( o ) * ( matrix )->in + ( i ) ] )
+
+/** Build the matrix of one filter for the given number of input channels.
+ *
+ * requested is the number of channels asked of the filter. Return non-zero
+ * to leave the audio alone.
+ */
+
+typedef int ( *audio_route_build )( mlt_filter filter, audio_matrix *matrix, int channels, int requested );
+
+extern int audio_matrix_init( audio_matrix *matrix, int in, int out );
+extern int audio_matrix_identity( audio_matrix *matrix, int channels );
+extern void audio_matrix_close( audio_matrix *matrix );
+extern void audio_route_push( mlt_frame frame, mlt_filter filter, audio_route_build build );
+
+#endif
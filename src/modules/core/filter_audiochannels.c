@@ -17,223 +17,44 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "audio_route.h"
+
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
 
 #include <string.h>
 
-static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
-{
-	// Used to return number of channels in the source
-	int channels_avail = *channels;
+/** Give the consumer the number of channels it asked for.
+*/
 
-	// Get the producer's audio
-	int error = mlt_frame_get_audio( frame, buffer, format, frequency, &channels_avail, samples );
-	if ( error ) return error;
+static int build_matrix( mlt_filter filter, audio_matrix *matrix, int channels, int requested )
+{
+	int i;
 
-	if ( channels_avail < *channels )
-	{
-		int size = mlt_audio_format_size( *format, *samples, *channels );
-		int16_t *new_buffer = mlt_pool_alloc( size );
+	if ( requested < 1 || requested == channels || audio_matrix_init( matrix, channels, requested ) )
+		return 1;
 
-		// Duplicate the existing channels
-		if ( *format == mlt_audio_s16 )
-		{
-			int i, j, k = 0;
-			for ( i = 0; i < *samples; i++ )
-			{
-				for ( j = 0; j < *channels; j++ )
-				{
-					new_buffer[ ( i * *channels ) + j ] = ((int16_t*)(*buffer))[ ( i * channels_avail ) + k ];
-					k = ( k + 1 ) % channels_avail;
-				}
-			}
-		}
-		else if ( *format == mlt_audio_s32le || *format == mlt_audio_f32le )
-		{
-			int32_t *p = (int32_t*) new_buffer;
-			int i, j, k = 0;
-			for ( i = 0; i < *samples; i++ )
-			{
-				for ( j = 0; j < *channels; j++ )
-				{
-					p[ ( i * *channels ) + j ] = ((int32_t*)(*buffer))[ ( i * channels_avail ) + k ];
-					k = ( k + 1 ) % channels_avail;
-				}
-			}
-		}
-		else if ( *format == mlt_audio_u8 )
-		{
-			uint8_t *p = (uint8_t*) new_buffer;
-			int i, j, k = 0;
-			for ( i = 0; i < *samples; i++ )
-			{
-				for ( j = 0; j < *channels; j++ )
-				{
-					p[ ( i * *channels ) + j ] = ((uint8_t*)(*buffer))[ ( i * channels_avail ) + k ];
-					k = ( k + 1 ) % channels_avail;
-				}
-			}
-		}
-		else
-		{
-			// non-interleaved - s32 or float
-			int size_avail = mlt_audio_format_size( *format, *samples, channels_avail );
-			int32_t *p = (int32_t*) new_buffer;
-			int i = *channels / channels_avail;
-			while ( i-- )
-			{
-				memcpy( p, *buffer, size_avail );
-				p += size_avail / sizeof(*p);
-			}
-			i = *channels % channels_avail;
-			if ( i )
-			{
-				size_avail = mlt_audio_format_size( *format, *samples, i );
-				memcpy( p, *buffer, size_avail );
-			}
-		}
-		// Update the audio buffer now - destroys the old
-		mlt_frame_set_audio( frame, new_buffer, *format, size, mlt_pool_release );
-		*buffer = new_buffer;
-	}
-	else if ( channels_avail == 6 && *channels == 2 )
+	if ( channels == 6 && requested == 2 )
 	{
 		// Downmix 5.1 audio to stereo.
 		// Mix levels taken from ATSC A/52 assuming maximum center and surround
-		// mix levels.
-		#define MIX(front, center, surr) (front + (0.707 * center) + (0.5 * surr))
-
-		// Convert to a supported format if necessary
-		mlt_audio_format new_format = *format;
-		switch( *format )
-		{
-		default:
-			// Unknown. Try to convert to float anyway.
-			mlt_log_error( NULL, "[audiochannels] Unknown format %d\n", *format );
-		case mlt_audio_float:
-		case mlt_audio_f32le:
-			new_format = mlt_audio_float;
-			break;
-		case mlt_audio_s32le:
-		case mlt_audio_s32:
-			new_format = mlt_audio_s32;
-			break;
-		case mlt_audio_s16:
-		case mlt_audio_u8:
-			new_format = mlt_audio_s16;
-			break;
-		case mlt_audio_none:
-			new_format = mlt_audio_none;
-			break;
-		}
-		if ( *format != new_format && frame->convert_audio )
-			frame->convert_audio( frame, buffer, format, new_format );
-
-		// Perform the downmix. Operate on the buffer in place to avoid realloc.
-		if ( *format == mlt_audio_s16 )
-		{
-			int16_t* in = *buffer;
-			int16_t* out = *buffer;
-			int i;
-			for ( i = 0; i < *samples; i++ )
-			{
-				float fl = in[0];
-				float fr = in[1];
-				float c = in[2];
-				// in[3] is LFE
-				float sl = in[4];
-				float sr = in[5];
-				*out++ = CLAMP( MIX(fl, c, sl), INT16_MIN, INT16_MAX ); // Left
-				*out++ = CLAMP( MIX(fr, c, sr), INT16_MIN, INT16_MAX ); // Right
-				in +=6;
-			}
-		}
-		else if ( *format == mlt_audio_s32 )
-		{
-			int32_t* flin = *buffer;
-			int32_t* frin = *buffer + (*samples * sizeof(float));
-			int32_t* cin  = *buffer + (2 * *samples * sizeof(float));
-			int32_t* slin = *buffer + (4 * *samples * sizeof(float));
-			int32_t* srin = *buffer + (5 * *samples * sizeof(float));
-			int32_t* lout = *buffer;
-			int32_t* rout = *buffer + (*samples * sizeof(float));
-			int i;
-			for ( i = 0; i < *samples; i++ )
-			{
-				double fl = *flin++;
-				double fr = *frin++;
-				double c = *cin++;
-				double sl = *slin++;
-				double sr = *srin++;
-				*lout++ = CLAMP( MIX(fl, c, sl), INT32_MIN, INT32_MAX );
-				*rout++ = CLAMP( MIX(fr, c, sr), INT32_MIN, INT32_MAX );
-			}
-		}
-		else if ( *format == mlt_audio_float )
-		{
-			float* flin = *buffer;
-			float* frin = *buffer + (*samples * sizeof(float));
-			float* cin  = *buffer + (2 * *samples * sizeof(float));
-			float* slin = *buffer + (4 * *samples * sizeof(float));
-			float* srin = *buffer + (5 * *samples * sizeof(float));
-			float* lout = *buffer;
-			float* rout = *buffer + (*samples * sizeof(float));
-			int i;
-			for ( i = 0; i < *samples; i++ )
-			{
-				float fl = *flin++;
-				float fr = *frin++;
-				float c = *cin++;
-				float sl = *slin++;
-				float sr = *srin++;
-				*lout++ = MIX(fl, c, sl);
-				*rout++ = MIX(fr, c, sr);
-			}
-		}
-		else
-		{
-			mlt_log_error( NULL, "[audiochannels] Unable to mix format %d\n", *format );
-		}
+		// mix levels. Channel 3 is LFE.
+		AUDIO_MATRIX_GAIN( matrix, 0, 0 ) = 1.0;
+		AUDIO_MATRIX_GAIN( matrix, 0, 2 ) = 0.707;
+		AUDIO_MATRIX_GAIN( matrix, 0, 4 ) = 0.5;
+		AUDIO_MATRIX_GAIN( matrix, 1, 1 ) = 1.0;
+		AUDIO_MATRIX_GAIN( matrix, 1, 2 ) = 0.707;
+		AUDIO_MATRIX_GAIN( matrix, 1, 5 ) = 0.5;
 	}
-	else if ( channels_avail > *channels )
+	else
 	{
-		int size = mlt_audio_format_size( *format, *samples, *channels );
-		int16_t *new_buffer = mlt_pool_alloc( size );
-		int i, j;
-
-		// Drop all but the first *channels
-		if ( *format == mlt_audio_s16 )
-		{
-			for ( i = 0; i < *samples; i++ )
-				for ( j = 0; j < *channels; j++ )
-					new_buffer[ ( i * *channels ) + j ]	= ((int16_t*)(*buffer))[ ( i * channels_avail ) + j ];
-		}
-		else if ( *format == mlt_audio_s32le || *format == mlt_audio_f32le )
-		{
-			int32_t *p = (int32_t*) new_buffer;
-			for ( i = 0; i < *samples; i++ )
-				for ( j = 0; j < *channels; j++ )
-					p[ ( i * *channels ) + j ]	= ((int32_t*)(*buffer))[ ( i * channels_avail ) + j ];
-		}
-		else if ( *format == mlt_audio_u8 )
-		{
-			uint8_t *p = (uint8_t*) new_buffer;
-			for ( i = 0; i < *samples; i++ )
-				for ( j = 0; j < *channels; j++ )
-					p[ ( i * *channels ) + j ]	= ((uint8_t*)(*buffer))[ ( i * channels_avail ) + j ];
-		}
-		else
-		{
-			// non-interleaved - s32 or float
-			memcpy( new_buffer, *buffer, size );
-		}
-		// Update the audio buffer now - destroys the old
-		mlt_frame_set_audio( frame, new_buffer, *format, size, mlt_pool_release );
-		*buffer = new_buffer;
+		// Duplicate the existing channels, or drop all but the first requested
+		for ( i = 0; i < requested; i++ )
+			AUDIO_MATRIX_GAIN( matrix, i, i % channels ) = 1.0;
 	}
-	return error;
+
+	return 0;
 }
 
 /** Filter processing.
@@ -241,7 +62,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 
 static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 {
-	mlt_frame_push_audio( frame, filter_get_audio );
+	audio_route_push( frame, filter, build_matrix );
 	return frame;
 }
 
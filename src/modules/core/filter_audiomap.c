@@ -17,62 +17,39 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "audio_route.h"
+
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-#define MAX_CHANNELS 32
+/** Each output channel copies the input channel named by its property.
+*/
 
-static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+static int build_matrix( mlt_filter filter, audio_matrix *matrix, int channels, int requested )
 {
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
 	char prop_name[32], *prop_val;
-	int i, j, l, m[MAX_CHANNELS];
-
-	mlt_filter filter = mlt_frame_pop_audio(frame);
-
-	// Get the producer's audio
-	int error = mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
-	if ( error ) return error;
-
-	mlt_properties properties = MLT_FILTER_PROPERTIES(filter);
-
-	/* find samples length */
-	int len = mlt_audio_format_size( *format, 1, 1 );
-
-	/* pcm samples buffer */
-	uint8_t *pcm = *buffer;
+	int i, j;
 
-	/* build matrix */
-	for ( i = 0; i < MAX_CHANNELS; i++ )
+	if ( audio_matrix_init( matrix, channels, channels ) )
+		return 1;
+	for ( i = 0; i < channels; i++ )
 	{
-		m[i] = i;
+		j = i;
 
 		snprintf( prop_name, sizeof(prop_name), "%d", i );
 		if ( ( prop_val = mlt_properties_get( properties, prop_name ) ) )
 		{
 			j = atoi( prop_val );
-			if( j >= 0 && j < MAX_CHANNELS )
-				m[i] = j;
+			if( j < 0 || j >= channels )
+				j = i;
 		}
-	}
-
-	/* process samples */
-	for ( i = 0; i < *samples; i++ )
-	{
-		uint8_t tmp[MAX_CHANNELS * 4];
-
-		for ( j = 0; j < MAX_CHANNELS && j < *channels; j++ )
-			for(l = 0; l < len; l++)
-				tmp[j * len + l] = pcm[m[j] * len + l];
-
-		for ( j = 0; j < MAX_CHANNELS && j < *channels; j++ )
-			for ( l = 0; l < len; l++ )
-				pcm[j * len + l] = tmp[j * len + l];
-
-		pcm += len * (*channels);
+		AUDIO_MATRIX_GAIN( matrix, i, j ) = 1.0;
 	}
 
 	return 0;
@@ -83,8 +60,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 
 static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 {
-	mlt_frame_push_audio( frame, filter );
-	mlt_frame_push_audio( frame, filter_get_audio );
+	audio_route_push( frame, filter, build_matrix );
 	return frame;
 }
 
@@ -115,6 +115,65 @@ char* frame_to_timecode( int frames, double fps)
 	return res;
 }
 
+/** Assign a property of a nested filter, leaving it alone when it has not changed.
+ *
+ * Producers such as pango only lay out and render again when their
+ * properties change, so a feed item on screen for many frames is drawn once.
+ */
+
+static void set_if_changed( mlt_properties properties, const char *name, const char *value )
+{
+	char *current = mlt_properties_get( properties, name );
+	if ( current == NULL || strcmp( current, value ) )
+		mlt_properties_set( properties, name, value );
+}
+
+/** Drop the nested filters of feed items that are no longer on screen.
+ *
+ * Each feed item gets its own nested filter, keyed on its type, feeding
+ * filter and in/out points, so that items shown together do not overwrite
+ * each other's properties and each one keeps what it rendered. Items not
+ * seen for FEED_EXPIRY frames are released; frames still holding one keep
+ * their own reference.
+ */
+
+#define FEED_EXPIRY 25
+
+static void expire_feeds( mlt_filter filter )
+{
+	mlt_properties filter_properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_properties cache = mlt_properties_get_data( filter_properties, "_feed_cache", NULL );
+	int counter = mlt_properties_get_int( filter_properties, "_feed_counter" );
+	int count = mlt_properties_count( cache );
+	mlt_properties fresh = NULL;
+	int i;
+
+	for ( i = 0; i < count; i ++ )
+	{
+		mlt_filter requested = mlt_properties_get_data_at( cache, i, NULL );
+		if ( requested == NULL || counter - mlt_properties_get_int( MLT_FILTER_PROPERTIES( requested ), "_data_show.seen" ) > FEED_EXPIRY )
+		{
+			fresh = mlt_properties_new( );
+			break;
+		}
+	}
+
+	// Rebuild the cache with the items still in use rather than leave dead names behind
+	if ( fresh != NULL )
+	{
+		for ( i = 0; i < count; i ++ )
+		{
+			mlt_filter requested = mlt_properties_get_data_at( cache, i, NULL );
+			if ( requested != NULL && counter - mlt_properties_get_int( MLT_FILTER_PROPERTIES( requested ), "_data_show.seen" ) <= FEED_EXPIRY )
+			{
+				mlt_properties_inc_ref( MLT_FILTER_PROPERTIES( requested ) );
+				mlt_properties_set_data( fresh, mlt_properties_get_name( cache, i ), requested, 0, ( mlt_destructor )mlt_filter_close, NULL );
+			}
+		}
+		mlt_properties_set_data( filter_properties, "_feed_cache", fresh, 0, ( mlt_destructor )mlt_properties_close, NULL );
+	}
+}
+
 /** Process the frame for the requested type
 */
 
@@ -129,8 +188,17 @@ static int process_feed( mlt_properties feed, mlt_filter filter, mlt_frame frame
 	// Get the type requested by the feeding filter
 	char *type = mlt_properties_get( feed, "type" );
 
-	// Fetch the filter associated to this type
-	mlt_filter requested = mlt_properties_get_data( filter_properties, type, NULL );
+	// Fetch the filter associated to this feed item
+	mlt_properties cache = mlt_properties_get_data( filter_properties, "_feed_cache", NULL );
+	char item[ 256 ];
+	mlt_filter requested = NULL;
+
+	if ( type == NULL )
+		return error;
+
+	snprintf( item, sizeof( item ), "%s.%s.%d.%d", type, mlt_properties_get( feed, "id" ) ? mlt_properties_get( feed, "id" ) : "",
+		mlt_properties_get_int( feed, "in" ), mlt_properties_get_int( feed, "out" ) );
+	requested = mlt_properties_get_data( cache, item, NULL );
 
 	// If it doesn't exist, then create it now
 	if ( requested == NULL )
@@ -138,13 +206,15 @@ static int process_feed( mlt_properties feed, mlt_filter filter, mlt_frame frame
 		// Source filter from profile
 		requested = obtain_filter( filter, type );
 
-		// Store it on the properties for subsequent retrieval/destruction
-		mlt_properties_set_data( filter_properties, type, requested, 0, ( mlt_destructor )mlt_filter_close, NULL );
+		// Store it in the cache for subsequent retrieval/destruction
+		if ( requested != NULL )
+			mlt_properties_set_data( cache, item, requested, 0, ( mlt_destructor )mlt_filter_close, NULL );
 	}
 
 	// If we have one, then process it now...
 	if ( requested != NULL )
 	{
+		char reference[ 300 ];
 		int i = 0;
 		mlt_properties properties = MLT_FILTER_PROPERTIES( requested );
 		static const char *prefix = "properties.";
@@ -231,9 +301,9 @@ static int process_feed( mlt_properties feed, mlt_filter filter, mlt_frame frame
 								keywords = strtok( NULL, "#" );
 								ct++;
 							}
-							mlt_properties_set( properties, key, (char*) result );
+							set_if_changed( properties, key, result );
 						}
-						else mlt_properties_set( properties, key, value );
+						else set_if_changed( properties, key, value );
 					}
 				}
 			}
@@ -245,6 +315,12 @@ static int process_feed( mlt_properties feed, mlt_filter filter, mlt_frame frame
 		else
 			mlt_frame_set_position( frame, mlt_properties_get_int( feed, "position" ) );
 
+		// Mark the item as seen and keep it alive until this frame has rendered it
+		mlt_properties_set_int( properties, "_data_show.seen", mlt_properties_get_int( filter_properties, "_feed_counter" ) );
+		mlt_properties_inc_ref( properties );
+		snprintf( reference, sizeof( reference ), "data_show.%s", item );
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), reference, requested, 0, ( mlt_destructor )mlt_filter_close, NULL );
+
 		// Process the filter
 		mlt_filter_process( requested, frame );
 
@@ -306,12 +382,17 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
 
+	// Count the frames seen to age the feed items
+	mlt_properties_set_int( MLT_FILTER_PROPERTIES( filter ), "_feed_counter", mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "_feed_counter" ) + 1 );
+
 	// Track specific
 	process_queue( mlt_properties_get_data( frame_properties, "data_queue", NULL ), frame, filter );
 
 	// Global
 	process_queue( mlt_properties_get_data( frame_properties, "global_queue", NULL ), frame, filter );
 
+	expire_feeds( filter );
+
 	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
 	// Need to get the image
@@ -351,6 +432,9 @@ mlt_filter filter_data_show_init( mlt_profile profile, mlt_service_type type, co
 		// Assign the argument (default to titles)
 		mlt_properties_set( properties, "resource", arg == NULL ? NULL : arg );
 
+		// Nested filters of the feed items on screen
+		mlt_properties_set_data( properties, "_feed_cache", mlt_properties_new( ), 0, ( mlt_destructor )mlt_properties_close, NULL );
+
 		// Specify the processing method
 		filter->process = filter_process;
 	}
@@ -19,11 +19,241 @@
 
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/** Reverse the order of n pixels of src into dst.
+ *
+ * bpp is 1 for an alpha mask, 2 for yuv422 and 4 for rgba. yuv422 is
+ * reversed a pair at a time, swapping the two lumas and keeping each pair's
+ * chroma, so src must start on a pair and n must be even. The buffers must
+ * not overlap.
+ */
+
+static void reverse_copy( uint8_t *dst, const uint8_t *src, int n, int bpp )
+{
+	const uint8_t *end = src + n * bpp;
+	int i = 0;
+
+#ifdef USE_SSE2
+	if ( bpp == 1 )
+	{
+		for ( ; i + 16 <= n; i += 16 )
+		{
+			__m128i x = _mm_loadu_si128( ( const __m128i* )( end - i - 16 ) );
+			x = _mm_shuffle_epi32( x, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+			x = _mm_shufflehi_epi16( _mm_shufflelo_epi16( x, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+			x = _mm_or_si128( _mm_slli_epi16( x, 8 ), _mm_srli_epi16( x, 8 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i ), x );
+		}
+	}
+	else if ( bpp == 2 )
+	{
+		__m128i luma = _mm_set1_epi32( 0x00ff00ff );
+		for ( ; i + 8 <= n; i += 8 )
+		{
+			__m128i x = _mm_loadu_si128( ( const __m128i* )( end - ( i + 8 ) * 2 ) );
+			__m128i y;
+			x = _mm_shuffle_epi32( x, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+			y = _mm_and_si128( x, luma );
+			y = _mm_or_si128( _mm_slli_epi32( y, 16 ), _mm_srli_epi32( y, 16 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i * 2 ), _mm_or_si128( y, _mm_andnot_si128( luma, x ) ) );
+		}
+	}
+	else if ( bpp == 4 )
+	{
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			__m128i x = _mm_loadu_si128( ( const __m128i* )( end - ( i + 4 ) * 4 ) );
+			_mm_storeu_si128( ( __m128i* )( dst + i * 4 ), _mm_shuffle_epi32( x, _MM_SHUFFLE( 0, 1, 2, 3 ) ) );
+		}
+	}
+#endif
+
+	if ( bpp == 1 )
+	{
+		for ( ; i < n; i ++ )
+			dst[ i ] = end[ - i - 1 ];
+	}
+	else if ( bpp == 2 )
+	{
+		for ( ; i + 2 <= n; i += 2 )
+		{
+			const uint8_t *q = end - ( i + 2 ) * 2;
+			uint8_t *p = dst + i * 2;
+			p[ 0 ] = q[ 2 ];
+			p[ 1 ] = q[ 1 ];
+			p[ 2 ] = q[ 0 ];
+			p[ 3 ] = q[ 3 ];
+		}
+	}
+	else
+	{
+		for ( ; i < n; i ++ )
+			memcpy( dst + i * bpp, end - ( i + 1 ) * bpp, bpp );
+	}
+}
+
+/** Mirror one half of a row onto the other.
+ *
+ * Without reverse the left half is replaced with the right, otherwise the
+ * right with the left. When a yuv422 row has an odd number of pairs, the
+ * middle pair straddles the axis and only its outer luma is copied.
+ */
+
+static void mirror_row( uint8_t *row, int width, int bpp, int reverse )
+{
+	int half = width / 2;
+	int n = bpp == 2 ? half & ~1 : half;
+
+	if ( !reverse )
+		reverse_copy( row, row + ( width - n ) * bpp, n, bpp );
+	else
+		reverse_copy( row + ( width - n ) * bpp, row, n, bpp );
+
+	if ( bpp == 2 && n != half )
+	{
+		if ( !reverse )
+			row[ n * 2 ] = row[ n * 2 + 2 ];
+		else
+			row[ n * 2 + 2 ] = row[ n * 2 ];
+	}
+}
+
+/** Shared state of a sliced mirror operation.
+*/
+
+typedef struct mirror_desc_s mirror_desc;
+
+struct mirror_desc_s
+{
+	void ( *line )( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch );
+	uint8_t *image;
+	uint8_t *alpha;
+	int bpp;
+	int width;
+	int height;
+	int reverse;
+	int first;
+	int last;
+};
+
+#define ROW( desc, plane, bpp, y ) ( ( plane ) + ( y ) * ( desc )->width * ( bpp ) )
+
+static void horizontal_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	mirror_row( ROW( desc, plane, bpp, i ), desc->width, bpp, desc->reverse );
+}
+
+static void vertical_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	uint8_t *top = ROW( desc, plane, bpp, i );
+	uint8_t *bottom = ROW( desc, plane, bpp, desc->height - i - 1 );
+
+	if ( !desc->reverse )
+		memcpy( top, bottom, desc->width * bpp );
+	else
+		memcpy( bottom, top, desc->width * bpp );
+}
+
+static void flip_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	uint8_t *row = ROW( desc, plane, bpp, i );
+	int n = bpp == 2 ? desc->width & ~1 : desc->width;
+
+	reverse_copy( scratch, row, n, bpp );
+	memcpy( row, scratch, n * bpp );
+}
+
+static void flop_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	uint8_t *top = ROW( desc, plane, bpp, i );
+	uint8_t *bottom = ROW( desc, plane, bpp, desc->height - i - 1 );
+	int size = desc->width * bpp;
+
+	memcpy( scratch, top, size );
+	memcpy( top, bottom, size );
+	memcpy( bottom, scratch, size );
+}
+
+/** Reverse the start of one row into the end of another, or vice versa.
+ *
+ * The diagonals copy a run that shrinks with i between row i and its
+ * opposite. When both are the same row this is the horizontal mirror.
+ */
+
+static void diagonal_copy( mirror_desc *desc, uint8_t *plane, int bpp, int i, int end_in_i, int into_i )
+{
+	int opposite = desc->height - i - 1;
+	int n = ( ( desc->width * ( desc->height - i ) ) / desc->height ) / 2 * 2;
+	uint8_t *row = ROW( desc, plane, bpp, i );
+	uint8_t *other = ROW( desc, plane, bpp, opposite );
+	uint8_t *start = end_in_i ? other : row;
+	uint8_t *end = ( end_in_i ? row : other ) + ( desc->width - n ) * bpp;
+
+	if ( i == opposite && n > desc->width / 2 )
+		mirror_row( row, desc->width, bpp, !into_i == !end_in_i );
+	else if ( into_i == end_in_i )
+		reverse_copy( end, start, n, bpp );
+	else
+		reverse_copy( start, end, n, bpp );
+}
+
+static void diagonal_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	// The start of row i takes the end of its opposite, or the reverse
+	diagonal_copy( desc, plane, bpp, i, 0, !desc->reverse );
+}
+
+static void xdiagonal_line( mirror_desc *desc, uint8_t *plane, int bpp, int i, uint8_t *scratch )
+{
+	// The start of the opposite row takes the end of row i, or the reverse
+	diagonal_copy( desc, plane, bpp, i, 1, desc->reverse );
+}
+
+static int mirror_slice( int id, int idx, int jobs, void *cookie )
+{
+	mirror_desc *desc = cookie;
+	int count = desc->last - desc->first;
+	int size = ( count + jobs - 1 ) / jobs;
+	int start = desc->first + idx * size;
+	int end = MIN( start + size, desc->last );
+	uint8_t *scratch = NULL;
+	int i;
+
+	if ( desc->line == flip_line || desc->line == flop_line )
+	{
+		scratch = malloc( desc->width * desc->bpp );
+		if ( scratch == NULL )
+			return 1;
+	}
+
+	for ( i = start; i < end; i ++ )
+	{
+		desc->line( desc, desc->image, desc->bpp, i, scratch );
+		if ( desc->alpha != NULL )
+			desc->line( desc, desc->alpha, 1, i, scratch );
+	}
+
+	free( scratch );
+	return 0;
+}
+
+static void mirror_run( mirror_desc *desc, int first, int last )
+{
+	desc->first = first;
+	desc->last = last;
+	if ( last > first )
+		mlt_slices_run_normal( MIN( last - first, mlt_slices_count_normal() ), mirror_slice, desc );
+}
+
 /** Do it :-).
 */
 
@@ -41,252 +271,53 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	// Determine if reverse is required
 	int reverse = mlt_properties_get_int( properties, "reverse" );
 
-	// Get the image
-	*format = mlt_image_yuv422;
+	// Get the image, working directly on rgba when that is what was asked for
+	if ( *format != mlt_image_rgb24a )
+		*format = mlt_image_yuv422;
 	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
 
-	// Get the alpha
-	uint8_t *alpha = mlt_frame_get_alpha_mask( frame );
-
 	// If we have an image of the right colour space
-	if ( error == 0 )
+	if ( error == 0 && ( *format == mlt_image_yuv422 || *format == mlt_image_rgb24a ) )
 	{
-		// We'll KISS here
+		mirror_desc desc;
 		int hh = *height / 2;
 
+		desc.line = NULL;
+		desc.image = *image;
+		desc.bpp = *format == mlt_image_rgb24a ? 4 : 2;
+		desc.width = *width;
+		desc.height = *height;
+		desc.reverse = reverse;
+
+		// An rgba image carries its own alpha, an opaque mask needs no work
+		desc.alpha = *format == mlt_image_yuv422 ? mlt_frame_get_alpha( frame ) : NULL;
+
 		if ( !strcmp( mirror, "horizontal" ) )
 		{
-			uint8_t *p = NULL;
-			uint8_t *q = NULL;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			int i;
-			int uneven_w = ( *width % 2 ) * 2;
-			for ( i = 0; i < *height; i ++ )
-			{
-				p = ( uint8_t * )*image + i * *width * 2;
-				q = p + *width * 2;
-				a = alpha + i * *width;
-				b = a + *width - 1;
-				if ( !reverse )
-				{
-					while ( p < q )
-					{
-						*p ++ = *( q - 2 );
-						*p ++ = *( q - 3 - uneven_w );
-						*p ++ = *( q - 4 );
-						*p ++ = *( q - 1 - uneven_w );
-						q -= 4;
-						*a ++ = *b --;
-						*a ++ = *b --;
-					}
-				}
-				else
-				{
-					while ( p < q )
-					{
-						*( q - 2 ) = *p ++;
-						*( q - 3 - uneven_w ) = *p ++;
-						*( q - 4 ) = *p ++;
-						*( q - 1 - uneven_w ) = *p ++;
-						q -= 4;
-						*b -- = *a ++;
-						*b -- = *a ++;
-					}
-				}
-			}
+			desc.line = horizontal_line;
+			mirror_run( &desc, 0, *height );
 		}
 		else if ( !strcmp( mirror, "vertical" ) )
 		{
-			uint16_t *end = ( uint16_t *)*image + *width * *height;
-			uint16_t *p = NULL;
-			uint16_t *q = NULL;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			int i;
-			int j;
-			for ( i = 0; i < hh; i ++ )
-			{
-				p = ( uint16_t * )*image + i * *width;
-				q = end - ( i + 1 ) * *width;
-				j = *width;
-				a = alpha + i * *width;
-				b = alpha + ( *height - i - 1 ) * *width;
-				if ( !reverse )
-				{
-					while ( j -- )
-					{
-						*p ++ = *q ++;
-						*a ++ = *b ++;
-					}
-				}
-				else
-				{
-					while ( j -- )
-					{
-						*q ++ = *p ++;
-						*b ++ = *a ++;
-					}
-				}
-			}
-		}
-		else if ( !strcmp( mirror, "diagonal" ) )
-		{
-			uint8_t *end = ( uint8_t *)*image + *width * *height * 2;
-			uint8_t *p = NULL;
-			uint8_t *q = NULL;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			int i;
-			int j;
-			int uneven_w = ( *width % 2 ) * 2;
-			for ( i = 0; i < *height; i ++ )
-			{
-				p = ( uint8_t * )*image + i * *width * 2;
-				q = end - i * *width * 2;
-				j = ( ( *width * ( *height - i ) ) / *height ) / 2;
-				a = alpha + i * *width;
-				b = alpha + ( *height - i - 1 ) * *width;
-				if ( !reverse )
-				{
-					while ( j -- )
-					{
-						*p ++ = *( q - 2 );
-						*p ++ = *( q - 3 - uneven_w );
-						*p ++ = *( q - 4 );
-						*p ++ = *( q - 1 - uneven_w );
-						q -= 4;
-						*a ++ = *b --;
-						*a ++ = *b --;
-					}
-				}
-				else
-				{
-					while ( j -- )
-					{
-						*( q - 2 ) = *p ++;
-						*( q - 3 - uneven_w ) = *p ++;
-						*( q - 4 ) = *p ++;
-						*( q - 1 - uneven_w ) = *p ++;
-						q -= 4;
-						*b -- = *a ++;
-						*b -- = *a ++;
-					}
-				}
-			}
+			desc.line = vertical_line;
+			mirror_run( &desc, 0, hh );
 		}
-		else if ( !strcmp( mirror, "xdiagonal" ) )
+		else if ( !strcmp( mirror, "diagonal" ) || !strcmp( mirror, "xdiagonal" ) )
 		{
-			uint8_t *end = ( uint8_t *)*image + *width * *height * 2;
-			uint8_t *p = NULL;
-			uint8_t *q = NULL;
-			int i;
-			int j;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			int uneven_w = ( *width % 2 ) * 2;
-			for ( i = 0; i < *height; i ++ )
-			{
-				p = ( uint8_t * )*image + ( i + 1 ) * *width * 2;
-				q = end - ( i + 1 ) * *width * 2;
-				j = ( ( *width * ( *height - i ) ) / *height ) / 2;
-				a = alpha + ( i + 1 ) * *width - 1;
-				b = alpha + ( *height - i - 1 ) * *width;
-				if ( !reverse )
-				{
-					while ( j -- )
-					{
-						*q ++ = *( p - 2 );
-						*q ++ = *( p - 3 - uneven_w );
-						*q ++ = *( p - 4 );
-						*q ++ = *( p - 1 - uneven_w );
-						p -= 4;
-						*b ++ = *a --;
-						*b ++ = *a --;
-					}
-				}
-				else
-				{
-					while ( j -- )
-					{
-						*( p - 2 ) = *q ++;
-						*( p - 3 - uneven_w ) = *q ++;
-						*( p - 4 ) = *q ++;
-						*( p - 1 - uneven_w ) = *q ++;
-						p -= 4;
-						*a -- = *b ++;
-						*a -- = *b ++;
-					}
-				}
-			}
+			// The rows in the second half read what the first half wrote
+			desc.line = !strcmp( mirror, "diagonal" ) ? diagonal_line : xdiagonal_line;
+			mirror_run( &desc, 0, ( *height + 1 ) / 2 );
+			mirror_run( &desc, ( *height + 1 ) / 2, *height );
 		}
 		else if ( !strcmp( mirror, "flip" ) )
 		{
-			uint8_t t[ 4 ];
-			uint8_t *p = NULL;
-			uint8_t *q = NULL;
-			int i;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			uint8_t c;
-			int uneven_w = ( *width % 2 ) * 2;
-			for ( i = 0; i < *height; i ++ )
-			{
-				p = ( uint8_t * )*image + i * *width * 2;
-				q = p + *width * 2;
-				a = alpha + i * *width;
-				b = a + *width - 1;
-				while ( p < q )
-				{
-					t[ 0 ] = p[ 0 ];
-					t[ 1 ] = p[ 1 + uneven_w ];
-					t[ 2 ] = p[ 2 ];
-					t[ 3 ] = p[ 3 + uneven_w ];
-					*p ++ = *( q - 2 );
-					*p ++ = *( q - 3 - uneven_w );
-					*p ++ = *( q - 4 );
-					*p ++ = *( q - 1 - uneven_w );
-					*( -- q ) = t[ 3 ];
-					*( -- q ) = t[ 0 ];
-					*( -- q ) = t[ 1 ];
-					*( -- q ) = t[ 2 ];
-					c = *a;
-					*a ++ = *b;
-					*b -- = c;
-					c = *a;
-					*a ++ = *b;
-					*b -- = c;
-				}
-			}
+			desc.line = flip_line;
+			mirror_run( &desc, 0, *height );
 		}
 		else if ( !strcmp( mirror, "flop" ) )
 		{
-			uint16_t *end = ( uint16_t *)*image + *width * *height;
-			uint16_t *p = NULL;
-			uint16_t *q = NULL;
-			uint16_t t;
-			uint8_t *a = NULL;
-			uint8_t *b = NULL;
-			uint8_t c;
-			int i;
-			int j;
-			for ( i = 0; i < hh; i ++ )
-			{
-				p = ( uint16_t * )*image + i * *width;
-				q = end - ( i + 1 ) * *width;
-				a = alpha + i * *width;
-				b = alpha + ( *height - i - 1 ) * *width;
-				j = *width;
-				while ( j -- )
-				{
-					t = *p;
-					*p ++ = *q;
-					*q ++ = t;
-					c = *a;
-					*a ++ = *b;
-					*b ++ = c;
-				}
-			}
+			desc.line = flop_line;
+			mirror_run( &desc, 0, hh );
 		}
 	}
 
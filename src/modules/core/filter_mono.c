@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "audio_route.h"
+
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
@@ -24,118 +26,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-/** Get the audio.
+/** Every output channel is the sum of all the input channels.
 */
 
-static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+static int build_matrix( mlt_filter filter, audio_matrix *matrix, int channels, int requested )
 {
-	// Get the properties of the a frame
-	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
-	int channels_out = mlt_properties_get_int( properties, "mono.channels" );
-	int i, j, size;
-
-	// Get the producer's audio
-	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+	int channels_out = mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "channels" );
+	int i, j;
 
 	if ( channels_out == -1 )
-		channels_out = *channels;
-	size = mlt_audio_format_size( *format, *samples, channels_out );
+		channels_out = channels;
+	if ( channels_out < 1 || audio_matrix_init( matrix, channels, channels_out ) )
+		return 1;
 
-	switch ( *format )
-	{
-		case mlt_audio_u8:
-		{
-			uint8_t *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				uint8_t mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((uint8_t*) *buffer)[ ( i * *channels ) + j ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( i * channels_out ) + j ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		case mlt_audio_s16:
-		{
-			int16_t *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				int16_t mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((int16_t*) *buffer)[ ( i * *channels ) + j ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( i * channels_out ) + j ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		case mlt_audio_s32le:
-		{
-			int32_t *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				int32_t mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((int32_t*) *buffer)[ ( i * *channels ) + j ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( i * channels_out ) + j ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		case mlt_audio_f32le:
-		{
-			float *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				float mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((float*) *buffer)[ ( i * *channels ) + j ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( i * channels_out ) + j ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		case mlt_audio_s32:
-		{
-			int32_t *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				int32_t mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((int32_t*) *buffer)[ ( j * *channels ) + i ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( j * *samples ) + i ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		case mlt_audio_float:
-		{
-			float *new_buffer = mlt_pool_alloc( size );
-			for ( i = 0; i < *samples; i++ )
-			{
-				float mixdown = 0;
-				for ( j = 0; j < *channels; j++ )
-					mixdown += ((float*) *buffer)[ ( j * *channels ) + i ];
-				for ( j = 0; j < channels_out; j++ )
-					new_buffer[ ( j * *samples ) + i ] = mixdown;
-			}
-			*buffer = new_buffer;
-			break;
-		}
-		default:
-			mlt_log_error( NULL, "[filter mono] Invalid audio format\n" );
-			break;
-	}
-	if ( size > *samples * channels_out )
-	{
-		mlt_frame_set_audio( frame, *buffer, *format, size, mlt_pool_release );
-		*channels = channels_out;
-	}
+	for ( i = 0; i < channels_out; i++ )
+		for ( j = 0; j < channels; j++ )
+			AUDIO_MATRIX_GAIN( matrix, i, j ) = 1.0;
 
 	return 0;
 }
@@ -145,14 +51,8 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 
 static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 {
-	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
-	mlt_properties frame_props = MLT_FRAME_PROPERTIES( frame );
-
-	// Propogate the parameters
-	mlt_properties_set_int( frame_props, "mono.channels", mlt_properties_get_int( properties, "channels" ) );
-
-	// Override the get_audio method
-	mlt_frame_push_audio( frame, filter_get_audio );
+	// Route the audio
+	audio_route_push( frame, filter, build_matrix );
 
 	return frame;
 }
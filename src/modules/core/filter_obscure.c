@@ -20,9 +20,15 @@
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_profile.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
 
 /** Geometry struct.
 */
@@ -131,81 +137,167 @@ static void geometry_calculate( struct geometry_s *output, struct geometry_s *in
 	output->mask_h = lerp( in->mask_h + ( out->mask_h - in->mask_h ) * position, 1, -1 );
 }
 
-/** The averaging function...
+/** Per-region state shared by the slices.
 */
 
-static inline void obscure_average( uint8_t *start, int width, int height, int stride )
+typedef struct
 {
-	register int y;
-	register int x;
-	register int Y = ( *start + *( start + 2 ) ) / 2;
-	register int U = *( start + 1 );
-	register int V = *( start + 3 );
-	register uint8_t *p;
-	register int components = width >> 1;
-
-	y = height;
-	while( y -- )
+	uint8_t *image;
+	int width;
+	int x;
+	int y;
+	int w;
+	int h;
+	int mask_w;
+	int mask_h;
+} obscure_desc;
+
+/** Compute the summed-area table of one row of blocks.
+ *
+ * Block sums only ever read the table at block corners, so rather than the
+ * whole table each row of blocks keeps the difference between the table rows
+ * at its top and bottom edges: entry x holds the Y, U and V sums of the
+ * columns left of x. The image bytes are summed down the columns first,
+ * which is a plain vectorisable loop, and then along the row. Every pixel
+ * contributes the chroma of its pair so that blocks starting on an odd
+ * column still average the right samples.
+ */
+
+static void obscure_integrate( obscure_desc *d, uint32_t *columns, uint32_t *sums, int y0, int y1 )
+{
+	int left = d->x & ~1;
+	int bytes = ( d->x + d->w - left + 1 ) & ~1;
+	int x, y;
+
+	bytes *= 2;
+	memset( columns, 0, bytes * sizeof( uint32_t ) );
+	for ( y = y0; y < y1; y ++ )
 	{
-		p = start;
-		x = components;
-		while( x -- )
+		uint8_t *src = d->image + ( ( d->y + y ) * d->width + left ) * 2;
+		x = 0;
+#ifdef USE_SSE2
+		for ( ; x + 16 <= bytes; x += 16 )
 		{
-			Y = ( Y + *p ++ ) >> 1;
-			U = ( U + *p ++ ) >> 1;
-			Y = ( Y + *p ++ ) >> 1;
-			V = ( V + *p ++ ) >> 1;
+			__m128i zero = _mm_setzero_si128();
+			__m128i bytes16 = _mm_loadu_si128( ( const __m128i* )( src + x ) );
+			__m128i lo = _mm_unpacklo_epi8( bytes16, zero );
+			__m128i hi = _mm_unpackhi_epi8( bytes16, zero );
+			__m128i *sum = ( __m128i* )( columns + x );
+			_mm_storeu_si128( sum, _mm_add_epi32( _mm_loadu_si128( sum ), _mm_unpacklo_epi16( lo, zero ) ) );
+			_mm_storeu_si128( sum + 1, _mm_add_epi32( _mm_loadu_si128( sum + 1 ), _mm_unpackhi_epi16( lo, zero ) ) );
+			_mm_storeu_si128( sum + 2, _mm_add_epi32( _mm_loadu_si128( sum + 2 ), _mm_unpacklo_epi16( hi, zero ) ) );
+			_mm_storeu_si128( sum + 3, _mm_add_epi32( _mm_loadu_si128( sum + 3 ), _mm_unpackhi_epi16( hi, zero ) ) );
 		}
-		start += stride;
+#endif
+		for ( ; x < bytes; x ++ )
+			columns[ x ] += src[ x ];
 	}
 
-	start -= height * stride;
-	y = height;
-	while( y -- )
+	sums[ 0 ] = sums[ 1 ] = sums[ 2 ] = 0;
+	for ( x = d->x; x < d->x + d->w; x ++ )
 	{
-		p = start;
-		x = components;
-		while( x -- )
-		{
-			*p ++ = Y;
-			*p ++ = U;
-			*p ++ = Y;
-			*p ++ = V;
-		}
-		start += stride;
+		uint32_t *pair = columns + ( ( x & ~1 ) - left ) * 2;
+		sums[ 3 ] = sums[ 0 ] + columns[ ( x - left ) * 2 ];
+		sums[ 4 ] = sums[ 1 ] + pair[ 1 ];
+		sums[ 5 ] = sums[ 2 ] + pair[ 3 ];
+		sums += 3;
 	}
 }
 
-
-/** The obscurer rendering function...
+/** Replace each block of a range of block rows with its average.
 */
 
-static void obscure_render( uint8_t *image, int width, int height, struct geometry_s result )
+static int obscure_slice( int id, int idx, int jobs, void *cookie )
 {
-	int area_x = result.x;
-	int area_y = result.y;
-	int area_w = result.w;
-	int area_h = result.h;
+	obscure_desc *d = cookie;
+	int rows = ( d->h + d->mask_h - 1 ) / d->mask_h;
+	int size = ( rows + jobs - 1 ) / jobs;
+	int start = idx * size;
+	int end = MIN( start + size, rows );
+	uint32_t *columns = malloc( ( d->w + 2 ) * 2 * sizeof( uint32_t ) );
+	uint32_t *sums = malloc( ( d->w + 1 ) * 3 * sizeof( uint32_t ) );
+	int stride = d->width * 2;
+	uint32_t last_n = 0;
+	uint64_t scale = 0;
+	uint8_t *line, *p;
+	int row, x0, x, y;
+
+	for ( row = start; row < end && columns != NULL && sums != NULL; row ++ )
+	{
+		int y0 = row * d->mask_h;
+		int y1 = MIN( y0 + d->mask_h, d->h );
 
-	int mw = result.mask_w;
-	int mh = result.mask_h;
-	int w;
-	int h;
-	int aw;
-	int ah;
+		if ( y1 - y0 < 2 )
+			continue;
 
-	uint8_t *p = image + area_y * width * 2 + area_x * 2;
+		obscure_integrate( d, columns, sums, y0, y1 );
 
-	for ( w = 0; w < area_w; w += mw )
-	{
-		for ( h = 0; h < area_h; h += mh )
+		// Fill the top line of the row of blocks
+		line = d->image + ( ( d->y + y0 ) * d->width + d->x ) * 2;
+		p = line;
+		for ( x0 = 0; x0 < d->w; x0 += d->mask_w )
 		{
-			aw = w + mw > area_w ? mw - ( w + mw - area_w ) : mw;
-			ah = h + mh > area_h ? mh - ( h + mh - area_h ) : mh;
-			if ( aw > 1 && ah > 1 )
-				obscure_average( p + h * ( width << 1 ) + ( w << 1 ), aw, ah, width << 1 );
+			int x1 = MIN( x0 + d->mask_w, d->w );
+			uint32_t n = ( x1 - x0 ) * ( y1 - y0 );
+			uint8_t value[ 3 ];
+			int i;
+
+			// A sliver narrower than two pixels is left alone
+			if ( x1 - x0 < 2 )
+				break;
+
+			// Divide by multiplying with a 16.48 reciprocal, which is exact
+			// for means of 8 bit samples while n is below 2^20
+			if ( n != last_n )
+			{
+				last_n = n;
+				scale = n < ( 1 << 20 ) ? ( ( ( uint64_t )1 << 48 ) + n - 1 ) / n : 0;
+			}
+			for ( i = 0; i < 3; i ++ )
+			{
+				uint32_t sum = sums[ x1 * 3 + i ] - sums[ x0 * 3 + i ] + n / 2;
+				value[ i ] = scale ? ( sum * scale ) >> 48 : sum / n;
+			}
+
+			for ( x = d->x + x0; x < d->x + x1; x ++ )
+			{
+				*p ++ = value[ 0 ];
+				*p ++ = value[ 1 + ( x & 1 ) ];
+			}
 		}
+
+		// And copy it to the rest
+		for ( y = y0 + 1; y < y1; y ++ )
+			memcpy( line + ( y - y0 ) * stride, line, p - line );
 	}
+
+	free( columns );
+	free( sums );
+	return 0;
+}
+
+/** The obscurer rendering function...
+*/
+
+static void obscure_render( uint8_t *image, int width, int height, struct geometry_s result )
+{
+	obscure_desc desc;
+	int rows;
+
+	desc.image = image;
+	desc.width = width;
+	desc.x = result.x;
+	desc.y = result.y;
+	desc.w = result.w;
+	desc.h = result.h;
+	desc.mask_w = result.mask_w;
+	desc.mask_h = result.mask_h;
+
+	if ( desc.w < 2 || desc.h < 2 || desc.mask_w < 1 || desc.mask_h < 1 )
+		return;
+
+	rows = ( desc.h + desc.mask_h - 1 ) / desc.mask_h;
+	mlt_slices_run_normal( MIN( rows, mlt_slices_count_normal() ), obscure_slice, &desc );
 }
 
 /** Do it :-).
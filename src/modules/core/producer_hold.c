@@ -76,6 +76,45 @@ mlt_producer producer_hold_init( mlt_profile profile, mlt_service_type type, con
 	return self;
 }
 
+/** Get the held image rendered for the requested format and size.
+ *
+ * The copy is made once, kept on the real frame, and then shared read only by
+ * every output frame asking for the same format and size. The caller must
+ * lock the producer and release the returned reference with
+ * mlt_properties_close().
+ */
+
+static mlt_properties get_held_image( mlt_frame real_frame, mlt_image_format format, int width, int height )
+{
+	mlt_properties real_properties = MLT_FRAME_PROPERTIES( real_frame );
+	mlt_properties held;
+	char key[64];
+
+	snprintf( key, sizeof( key ), "_held.%d.%dx%d", format, width, height );
+	held = mlt_properties_get_data( real_properties, key, NULL );
+	if ( held == NULL )
+	{
+		uint8_t *image = NULL;
+
+		held = mlt_properties_new( );
+
+		if ( !mlt_frame_get_image( real_frame, &image, &format, &width, &height, 0 ) && image != NULL )
+		{
+			int size = mlt_image_format_size( format, width, height, NULL );
+			uint8_t *copy = mlt_pool_alloc( size );
+			memcpy( copy, image, size );
+			mlt_properties_set_data( held, "image", copy, size, mlt_pool_release, NULL );
+			mlt_properties_set_int( held, "format", format );
+			mlt_properties_set_int( held, "width", width );
+			mlt_properties_set_int( held, "height", height );
+		}
+		mlt_properties_set_data( real_properties, key, held, 0, ( mlt_destructor )mlt_properties_close, NULL );
+	}
+	mlt_properties_inc_ref( held );
+
+	return held;
+}
+
 static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_format *format, int *width, int *height, int writable )
 {
 	// Get the properties of the frame
@@ -83,45 +122,48 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 
 	// Obtain the real frame
 	mlt_frame real_frame = mlt_frame_pop_service( frame );
-
-	// Get the image from the real frame
+	mlt_properties real_properties = MLT_FRAME_PROPERTIES( real_frame );
+	mlt_service service = MLT_PRODUCER_SERVICE( mlt_frame_get_original_producer( frame ) );
+	mlt_properties held;
 	int size = 0;
-	*buffer = mlt_properties_get_data( MLT_FRAME_PROPERTIES( real_frame ), "image", &size );
-	*width = mlt_properties_get_int( MLT_FRAME_PROPERTIES( real_frame ), "width" );
-	*height = mlt_properties_get_int( MLT_FRAME_PROPERTIES( real_frame ), "height" );
+
+	mlt_service_lock( service );
 
 	// If this is the first time, get it from the producer
-	if ( *buffer == NULL )
+	if ( mlt_properties_get_data( real_properties, "image", NULL ) == NULL )
 	{
-		mlt_properties_pass( MLT_FRAME_PROPERTIES( real_frame ), properties, "" );
+		mlt_properties_pass( real_properties, properties, "" );
 
 		// We'll deinterlace on the downstream deinterlacer
-		mlt_properties_set_int( MLT_FRAME_PROPERTIES( real_frame ), "consumer_deinterlace", 1 );
+		mlt_properties_set_int( real_properties, "consumer_deinterlace", 1 );
 
 		// We want distorted to ensure we don't hit the resize filter twice
-		mlt_properties_set_int( MLT_FRAME_PROPERTIES( real_frame ), "distort", 1 );
-
-		// Get the image
-		mlt_frame_get_image( real_frame, buffer, format, width, height, writable );
-	
-		// Make sure we get the size
-		*buffer = mlt_properties_get_data( MLT_FRAME_PROPERTIES( real_frame ), "image", &size );
+		mlt_properties_set_int( real_properties, "distort", 1 );
 	}
 
-	mlt_properties_pass( properties, MLT_FRAME_PROPERTIES( real_frame ), "" );
+	held = get_held_image( real_frame, *format, *width, *height );
+	mlt_properties_pass( properties, real_properties, "" );
+
+	mlt_service_unlock( service );
+
+	*buffer = mlt_properties_get_data( held, "image", &size );
+	*format = mlt_properties_get_int( held, "format" );
+	*width = mlt_properties_get_int( held, "width" );
+	*height = mlt_properties_get_int( held, "height" );
 
-	// Set the values obtained on the frame
-	if ( *buffer != NULL )
+	// Only copy the image when the caller is going to write to it
+	if ( *buffer != NULL && writable )
 	{
 		uint8_t *image = mlt_pool_alloc( size );
 		memcpy( image, *buffer, size );
 		*buffer = image;
 		mlt_frame_set_image( frame, *buffer, size, mlt_pool_release );
+		mlt_properties_close( held );
 	}
 	else
 	{
-		// Pass the current image as is
 		mlt_frame_set_image( frame, *buffer, size, NULL );
+		mlt_properties_set_data( properties, "_held", held, 0, ( mlt_destructor )mlt_properties_close, NULL );
 	}
 
 	// Make sure that no further scaling is done
@@ -20,34 +20,136 @@
 #include <framework/mlt_producer.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_pool.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
 
 /** Random number generator
+ *
+ * This is counter based: the n-th number of a frame is a hash of n and a key
+ * derived from the frame number. Any range can be generated on its own, four
+ * numbers at a time.
 */
 
 typedef struct
 {
-	unsigned int x;
-	unsigned int y;
-} rand_seed;
+	uint32_t a;
+	uint32_t b;
+} rand_key;
+
+static inline uint32_t hash_rand( uint32_t x, const rand_key* key )
+{
+	x ^= key->a;
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x += key->b;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
 
-static void init_seed( rand_seed* seed, int init )
+static void init_key( rand_key* key, int init, uint32_t stream )
 {
-	// Use the initial value to initialize the seed to arbitrary values.
+	// Use the initial value to initialize the key to arbitrary values.
 	// This causes the algorithm to produce consistent results each time for the same frame number.
-	seed->x = 521288629 + init - ( init << 16 );
-	seed->y = 362436069 - init + ( init << 16 );
+	rand_key seed = { stream, 0x9e3779b9 };
+	key->a = hash_rand( init, &seed );
+	key->b = hash_rand( key->a, &seed );
+}
+
+#ifdef USE_SSE2
+static inline __m128i mul_epi32( __m128i a, __m128i b )
+{
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+		_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+/** The same as hash_rand() for four counters.
+*/
+
+static inline __m128i hash_rand4( __m128i x, const rand_key* key )
+{
+	x = _mm_xor_si128( x, _mm_set1_epi32( key->a ) );
+	x = _mm_xor_si128( x, _mm_srli_epi32( x, 16 ) );
+	x = mul_epi32( x, _mm_set1_epi32( 0x7feb352d ) );
+	x = _mm_add_epi32( x, _mm_set1_epi32( key->b ) );
+	x = _mm_xor_si128( x, _mm_srli_epi32( x, 15 ) );
+	x = mul_epi32( x, _mm_set1_epi32( 0x846ca68b ) );
+	x = _mm_xor_si128( x, _mm_srli_epi32( x, 16 ) );
+	return x;
+}
+#endif
+
+/** Fill count bytes with random numbers, four bytes per number.
+*/
+
+static void fill_rand( uint8_t* p, int count, const rand_key* key )
+{
+	int i = 0;
+#ifdef USE_SSE2
+	__m128i counter = _mm_set_epi32( 3, 2, 1, 0 );
+	for ( ; i + 16 <= count; i += 16 )
+	{
+		_mm_storeu_si128( ( __m128i* )( p + i ), hash_rand4( counter, key ) );
+		counter = _mm_add_epi32( counter, _mm_set1_epi32( 4 ) );
+	}
+#endif
+	for ( ; i < count; i += 4 )
+	{
+		uint32_t value = hash_rand( i / 4, key );
+		memcpy( p + i, &value, MIN( 4, count - i ) );
+	}
 }
 
-static inline unsigned int fast_rand( rand_seed* seed )
+/** State shared by the slices of an image.
+*/
+
+typedef struct
+{
+	uint8_t* image;
+	int count;
+	rand_key key;
+} noise_desc;
+
+static int noise_slice( int id, int idx, int jobs, void* cookie )
 {
-	static unsigned int a = 18000, b = 30903;
-	seed->x = a * ( seed->x & 65535 ) + ( seed->x >> 16 );
-	seed->y = b * ( seed->y & 65535 ) + ( seed->y >> 16 );
-	return ( ( seed->x << 16 ) + ( seed->y & 65535 ) );
+	noise_desc* desc = ( noise_desc* )cookie;
+	int size = ( ( desc->count + jobs - 1 ) / jobs + 15 ) & ~15;
+	int start = MIN( idx * size, desc->count );
+	int end = MIN( start + size, desc->count );
+	uint8_t* p = desc->image + start * 2;
+	int i = start;
+
+#ifdef USE_SSE2
+	__m128i counter = _mm_add_epi32( _mm_set1_epi32( start / 4 ), _mm_set_epi32( 3, 2, 1, 0 ) );
+	__m128i chroma = _mm_set1_epi8( ( char )128 );
+	__m128i black = _mm_set1_epi8( 16 );
+	__m128i white = _mm_set1_epi8( ( char )240 );
+	for ( ; i + 16 <= end; i += 16, p += 32 )
+	{
+		__m128i luma = hash_rand4( counter, &desc->key );
+		luma = _mm_max_epu8( _mm_min_epu8( luma, white ), black );
+		_mm_storeu_si128( ( __m128i* )p, _mm_unpacklo_epi8( luma, chroma ) );
+		_mm_storeu_si128( ( __m128i* )( p + 16 ), _mm_unpackhi_epi8( luma, chroma ) );
+		counter = _mm_add_epi32( counter, _mm_set1_epi32( 4 ) );
+	}
+#endif
+	for ( ; i < end; i++ )
+	{
+		uint32_t value = ( hash_rand( i / 4, &desc->key ) >> ( 8 * ( i % 4 ) ) ) & 0xff;
+		*p++ = value < 16 ? 16 : value > 240 ? 240 : value;
+		*p++ = 128;
+	}
+
+	return 0;
 }
 
 // Foward declarations
@@ -96,23 +198,12 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 	// Before we write to the image, make sure we have one
 	if ( *buffer != NULL )
 	{
-		// Calculate the end of the buffer
-		uint8_t *p = *buffer + *width * *height * 2;
-
-		// Value to hold a random number
-		uint32_t value;
-
-		// Initialize seed from the frame number.
-		rand_seed seed;
-		init_seed( &seed, mlt_frame_get_position( frame ) );
-
-		// Generate random noise
-		while ( p != *buffer )
-		{
-			value = fast_rand( &seed ) & 0xff;
-			*( -- p ) = 128;
-			*( -- p ) = value < 16 ? 16 : value > 240 ? 240 : value;
-		}
+		// Generate random noise, the luma from the random bytes in order
+		noise_desc desc;
+		desc.image = *buffer;
+		desc.count = *width * *height;
+		init_key( &desc.key, mlt_frame_get_position( frame ), 0 );
+		mlt_slices_run_normal( MIN( *height, mlt_slices_count_normal() ), noise_slice, &desc );
 	}
 
 	return 0;
@@ -137,13 +228,9 @@ static int producer_get_audio( mlt_frame frame, int16_t **buffer, mlt_audio_form
 	// Make sure we got one and fill it
 	if ( *buffer != NULL )
 	{
-		int16_t *p = *buffer + size / 2;
-		rand_seed seed;
-		init_seed( &seed, mlt_frame_get_position( frame ) );
-		while ( p != *buffer ) {
-			int16_t val = (int16_t)fast_rand( &seed );
-			*( -- p ) = val;
-		}
+		rand_key key;
+		init_key( &key, mlt_frame_get_position( frame ), 1 );
+		fill_rand( ( uint8_t* )*buffer, size, &key );
 	}
 
 	// Set the buffer for destruction
@@ -23,6 +23,143 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The oscillator is resynchronised from the exact phase this often
+#define TONE_BLOCK 256
+
+// Longest period (in samples) worth keeping for integer frequencies
+#define TONE_MAX_PERIOD 16384
+
+/** One period of a tone with an integer frequency.
+ *
+ * A tone of f Hz at rate r repeats every r / gcd( r, f ) samples, so the
+ * samples of any frame can be copied out of a single period.
+ */
+
+typedef struct
+{
+	double frequency;
+	double phase;
+	float level;
+	int rate;
+	int period;
+	int length;
+	float samples[];
+} tone_period;
+
+/** Generate count samples of level * sin( 2 pi ( cycles + n step ) ).
+ *
+ * The phase is accumulated by rotating a unit vector one step per sample,
+ * two samples at a time. Each block restarts from sin() and cos() so the
+ * rounding of the rotation never builds up.
+ */
+
+static void tone_generate( float *out, int count, double cycles, double step, float level )
+{
+	double omega = 2 * M_PI * step;
+	int block;
+
+	for ( block = 0; block < count; block += TONE_BLOCK )
+	{
+		int n = MIN( TONE_BLOCK, count - block );
+		double theta = 2 * M_PI * fmod( cycles + block * step, 1.0 );
+		int i = 0;
+#ifdef USE_SSE2
+		__m128d re = _mm_set_pd( cos( theta + omega ), cos( theta ) );
+		__m128d im = _mm_set_pd( sin( theta + omega ), sin( theta ) );
+		__m128d c = _mm_set1_pd( cos( 2 * omega ) );
+		__m128d s = _mm_set1_pd( sin( 2 * omega ) );
+		__m128 a = _mm_set1_ps( level );
+
+		for ( ; i + 2 <= n; i += 2 )
+		{
+			__m128d next = _mm_sub_pd( _mm_mul_pd( re, c ), _mm_mul_pd( im, s ) );
+			_mm_storel_pi( ( __m64* )( out + block + i ), _mm_mul_ps( _mm_cvtpd_ps( im ), a ) );
+			im = _mm_add_pd( _mm_mul_pd( re, s ), _mm_mul_pd( im, c ) );
+			re = next;
+		}
+		theta += i * omega;
+#endif
+		double re1 = cos( theta );
+		double im1 = sin( theta );
+		double c1 = cos( omega );
+		double s1 = sin( omega );
+
+		for ( ; i < n; i++ )
+		{
+			double next = re1 * c1 - im1 * s1;
+			out[ block + i ] = level * im1;
+			im1 = re1 * s1 + im1 * c1;
+			re1 = next;
+		}
+	}
+}
+
+/** Get the period of an integer frequency, or 0 if it is not worth caching.
+*/
+
+static int tone_period_length( double frequency, int rate )
+{
+	if ( frequency != floor( frequency ) || fabs( frequency ) > rate )
+		return 0;
+	int a = rate;
+	int b = abs( ( int )frequency );
+	while ( b )
+	{
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return rate / a <= TONE_MAX_PERIOD ? rate / a : 0;
+}
+
+/** Copy count samples starting at absolute sample first from the cached period.
+ *
+ * The period is rebuilt when the parameters change, so it is only used when
+ * it is not much longer than a frame. Returns non-zero if the frequency does
+ * not have a usable period.
+ */
+
+static int tone_copy_period( mlt_producer producer, float *out, int count, int64_t first, double frequency, double phase, float level, int rate )
+{
+	int period = tone_period_length( frequency, rate );
+	if ( !period || period > 4 * count )
+		return 1;
+
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( producer );
+	mlt_service_lock( MLT_PRODUCER_SERVICE( producer ) );
+	tone_period *cache = mlt_properties_get_data( properties, "_period", NULL );
+	if ( !cache || cache->frequency != frequency || cache->phase != phase || cache->level != level || cache->rate != rate )
+	{
+		// Short periods are repeated so that the copies are not tiny
+		int length = period * ( ( TONE_BLOCK + period - 1 ) / period );
+		cache = malloc( sizeof( tone_period ) + length * sizeof( float ) );
+		cache->frequency = frequency;
+		cache->phase = phase;
+		cache->level = level;
+		cache->rate = rate;
+		cache->period = period;
+		cache->length = length;
+		tone_generate( cache->samples, length, phase / 360.0, frequency / rate, level );
+		mlt_properties_set_data( properties, "_period", cache, 0, free, NULL );
+	}
+
+	int offset = ( ( first % period ) + period ) % period;
+	while ( count > 0 )
+	{
+		int n = MIN( count, cache->length - offset );
+		memcpy( out, cache->samples + offset, n * sizeof( float ) );
+		out += n;
+		count -= n;
+		offset = 0;
+	}
+	mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
+
+	return 0;
+}
 
 static int producer_get_audio( mlt_frame frame, int16_t** buffer, mlt_audio_format* format, int* frequency, int* channels, int* samples )
 {
@@ -42,29 +179,27 @@ static int producer_get_audio( mlt_frame frame, int16_t** buffer, mlt_audio_form
 	int size = *samples * *channels * sizeof( float );
 	*buffer = mlt_pool_alloc( size );
 
-	// Fill the buffer
-	int s = 0;
+	// Fill the first channel
 	int c = 0;
-	long double first_sample = mlt_sample_calculator_to_now( fps, *frequency, position );
+	float *output = ( float* )*buffer;
+	int64_t first_sample = mlt_sample_calculator_to_now( fps, *frequency, position );
 	float a = mlt_properties_anim_get_double( producer_properties, "level", position, length );
-	long double f = mlt_properties_anim_get_double( producer_properties, "frequency", position, length );
-	long double p = mlt_properties_anim_get_double( producer_properties, "phase", position, length );
-	p = (M_PI / 180) * p; // Convert from degrees to radians
+	double f = mlt_properties_anim_get_double( producer_properties, "frequency", position, length );
+	double p = mlt_properties_anim_get_double( producer_properties, "phase", position, length );
 	a = pow( 10, a / 20.0 ); // Convert from dB to amplitude
 
-	for( s = 0; s < *samples; s++ )
+	if ( tone_copy_period( producer, output, *samples, first_sample, f, p, a, *frequency ) )
 	{
-		long double t = (first_sample + s) / *frequency;
-
-		float value = a * sin( 2*M_PI*f*t + p );
-
-		for( c = 0; c < *channels; c++ )
-		{
-			float* sample_ptr = ((float*)*buffer) + (c * *samples) + s;
-			*sample_ptr = value;
-		}
+		// Only the fraction of a cycle matters for the starting phase
+		long double cycles = ( long double )f * first_sample / *frequency;
+		cycles = cycles - floorl( cycles ) + p / 360.0;
+		tone_generate( output, *samples, cycles, f / *frequency, a );
 	}
 
+	// The other channels are the same
+	for ( c = 1; c < *channels; c++ )
+		memcpy( output + c * *samples, output, *samples * sizeof( float ) );
+
 	// Set the buffer for destruction
 	mlt_frame_set_audio( frame, *buffer, *format, size, mlt_pool_release );
 
@@ -679,7 +679,14 @@ scale_luma ( uint16_t *dest_buf, int dest_width, int dest_height, const uint16_t
 	}
 }
 
-static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int width, int height )
+/** Get the luma map for the size of the b frame.
+ *
+ * A stock wipe is shared with other threads and may be replaced at a new size
+ * once the service is unlocked, so *held receives a reference on it that the
+ * caller must release with mlt_luma_map_release() after compositing.
+ */
+
+static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int width, int height, uint16_t **held )
 {
 	// The cached luma map information
 	int luma_width = mlt_properties_get_int( properties, "_luma.width" );
@@ -698,6 +705,33 @@ static uint16_t* get_luma( mlt_transition self, mlt_properties properties, int w
 		luma_height = height;
 	}
 
+	// Stock wipes are generated at the exact size instead of loaded and scaled
+	if ( resource && strchr( resource, '%' ) )
+	{
+		char *old_luma = mlt_properties_get( properties, "_luma" );
+		int old_invert = mlt_properties_get_int( properties, "_luma_invert" );
+
+		if ( luma_bitmap && luma_width == width && luma_height == height && invert == old_invert && old_luma && !strcmp( resource, old_luma ) )
+		{
+			*held = mlt_luma_map_acquire( resource, width, height, invert );
+			return luma_bitmap;
+		}
+
+		luma_bitmap = mlt_luma_map_acquire( resource, width, height, invert );
+		if ( luma_bitmap )
+		{
+			*held = mlt_luma_map_acquire( resource, width, height, invert );
+			mlt_properties_set_data( properties, "_luma.orig_bitmap", NULL, 0, NULL, NULL );
+			mlt_properties_set_int( properties, "_luma.width", width );
+			mlt_properties_set_int( properties, "_luma.height", height );
+			mlt_properties_set_data( properties, "_luma.bitmap", luma_bitmap, width * height * 2, ( mlt_destructor )mlt_luma_map_release, NULL );
+			mlt_properties_set( properties, "_luma", resource );
+			mlt_properties_set_int( properties, "_luma_invert", invert );
+			return luma_bitmap;
+		}
+		luma_bitmap = mlt_properties_get_data( properties, "_luma.bitmap", NULL );
+	}
+
 	if ( resource && resource[0] && strchr( resource, '%' ) )
 	{
 		// TODO: Clean up quick and dirty compressed/existence check
@@ -1324,7 +1358,8 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			
 			double luma_softness = mlt_properties_get_double( properties, "softness" );
 			mlt_service_lock( MLT_TRANSITION_SERVICE( self ) );
-			uint16_t *luma_bitmap = get_luma( self, properties, width_b, height_b );
+			uint16_t *held_luma = NULL;
+			uint16_t *luma_bitmap = get_luma( self, properties, width_b, height_b, &held_luma );
 			mlt_service_unlock( MLT_TRANSITION_SERVICE( self ) );
 			char *operator = mlt_properties_get( properties, "operator" );
 
@@ -1406,6 +1441,7 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 					composite_yuv( *image, *width, *height, image_b, width_b, height_b, alpha_b, alpha_a, result, field_id, luma_bitmap, luma_softness, line_fn, sliced );
 				mlt_log_timings_end( NULL, "composite_yuv" );
 			}
+			mlt_luma_map_release( held_luma );
 		}
 	}
 	else
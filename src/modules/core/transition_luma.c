@@ -332,6 +332,7 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 	int luma_height = mlt_properties_get_int( properties, "height" );
 	uint16_t *luma_bitmap = mlt_properties_get_data( properties, "bitmap", NULL );
 	char *current_resource = mlt_properties_get( properties, "_resource" );
+	int generated = mlt_properties_get_int( properties, "_generated" );
 	
 	// If the filename property changed, reload the map
 	char *resource = mlt_properties_get( properties, "resource" );
@@ -342,14 +343,19 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		luma_width = *width;
 		luma_height = *height;
 	}
-		
-	if ( resource && ( !current_resource || strcmp( resource, current_resource ) ) )
+
+	// Stock wipes are generated at the exact size, so regenerate when it changes
+	if ( resource && ( !current_resource || strcmp( resource, current_resource ) ||
+		 ( generated && ( luma_width != *width || luma_height != *height ) ) ) )
 	{
 		char temp[ 512 ];
 		char *extension = strrchr( resource, '.' );
 		char *orig_resource = resource;
+		uint16_t *generated_bitmap = strchr( resource, '%' ) ? mlt_luma_map_acquire( resource, *width, *height, 0 ) : NULL;
+
+		mlt_properties_set_int( properties, "_generated", generated_bitmap != NULL );
 
-		if ( strchr( resource, '%' ) )
+		if ( !generated_bitmap && strchr( resource, '%' ) )
 		{
 			FILE *test;
 			sprintf( temp, "%s/lumas/%s/%s", mlt_environment( "MLT_DATA" ), mlt_environment( "MLT_NORMALISATION" ), strchr( resource, '%' ) + 1 );
@@ -362,8 +368,20 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 			extension = strrchr( resource, '.' );
 		}
 
+		if ( generated_bitmap )
+		{
+			luma_bitmap = generated_bitmap;
+			luma_width = *width;
+			luma_height = *height;
+
+			// Set the transition properties
+			mlt_properties_set_int( properties, "width", luma_width );
+			mlt_properties_set_int( properties, "height", luma_height );
+			mlt_properties_set( properties, "_resource", orig_resource );
+			mlt_properties_set_data( properties, "bitmap", luma_bitmap, luma_width * luma_height * 2, ( mlt_destructor )mlt_luma_map_release, NULL );
+		}
 		// See if it is a PGM
-		if ( extension != NULL && strcmp( extension, ".pgm" ) == 0 )
+		else if ( extension != NULL && strcmp( extension, ".pgm" ) == 0 )
 		{
 			// Open PGM
 			FILE *f = mlt_fopen( resource, "rb" );
@@ -459,6 +477,12 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 	if ( mlt_properties_get( properties, "fixed" ) )
 		mix = mlt_properties_get_double( properties, "fixed" );
 
+	// A stock wipe may be replaced at a new size by another thread once
+	// unlocked, so hold a reference on it while compositing
+	uint16_t *held_bitmap = NULL;
+	if ( luma_bitmap && mlt_properties_get_int( properties, "_generated" ) )
+		luma_bitmap = held_bitmap = mlt_luma_map_acquire( mlt_properties_get( properties, "_resource" ), luma_width, luma_height, 0 );
+
 	mlt_service_unlock( MLT_TRANSITION_SERVICE( transition ) );
 
 	if ( luma_width > 0 && luma_height > 0 && luma_bitmap != NULL )
@@ -469,6 +493,7 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		// Composite the frames using a luma map
 		luma_composite( !invert ? a_frame : b_frame, !invert ? b_frame : a_frame, luma_width, luma_height, luma_bitmap, mix, frame_delta,
 			luma_softness, progressive ? -1 : top_field_first, width, height );
+		mlt_luma_map_release( held_bitmap );
 	}
 	else
 	{
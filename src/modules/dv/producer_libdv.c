@@ -31,11 +31,17 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
 #define FRAME_SIZE_525_60 	10 * 150 * 80
 #define FRAME_SIZE_625_50 	12 * 150 * 80
 
+/** Number of frames to ask the kernel to read ahead during sequential access
+*/
+
+#define READ_AHEAD_FRAMES 25
+
 /** To conserve resources, we maintain a stack of dv decoders.
 */
 
@@ -116,6 +122,279 @@ void dv_decoder_return( dv_decoder_t *this )
 	pthread_mutex_unlock( &decoder_lock );
 }
 
+static void dv_decoder_set_quality( dv_decoder_t *decoder, const char *quality )
+{
+	if ( quality != NULL )
+	{
+		if ( strncmp( quality, "fast", 4 ) == 0 )
+			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_DC );
+		else if ( strncmp( quality, "best", 4 ) == 0 )
+			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_AC_2 );
+		else
+			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_AC_1 );
+	}
+}
+
+/** Decode ahead: when the decode_ahead property is set, each frame handed out
+    by get_frame is queued for a shared pool of worker threads, so that several
+    frames decode while the consumer is still busy with earlier ones. The job
+    holds a reference on its frame until a worker has finished with it, and a
+    reference on the producer until the frame is closed.
+
+    At most DECODE_AHEAD_MAX jobs are queued; frames fetched beyond that decode
+    in get_image as usual. Workers skip frames that nobody else holds any more,
+    and a producer stops submitting once DECODE_AHEAD_MAX frames in a row were
+    closed without their image being asked for (dropped frames, or a consumer
+    that only wants audio). It then submits only every DECODE_AHEAD_MAX-th
+    frame, and resumes as soon as one of those has its image requested.
+*/
+
+#define DECODE_AHEAD_MAX 16
+
+enum
+{
+	JOB_QUEUED,
+	JOB_RUNNING,
+	JOB_CLAIMED,
+	JOB_DONE
+};
+
+typedef struct dv_job_s
+{
+	mlt_frame frame;
+	uint8_t *dv_data;
+	char *quality;
+	uint8_t *image;
+	int size;
+	int state;
+	int used;
+	mlt_producer producer;
+	int *unused;
+}
+*dv_job;
+
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static mlt_deque job_queue = NULL;
+static pthread_t job_threads[ DECODE_AHEAD_MAX ];
+static int job_workers = 0;
+static int job_stop = 0;
+
+static void dv_job_close( dv_job job )
+{
+	if ( job->used )
+		__atomic_store_n( job->unused, 0, __ATOMIC_RELAXED );
+	else
+		__sync_fetch_and_add( job->unused, 1 );
+	mlt_producer_close( job->producer );
+	mlt_pool_release( job->image );
+	free( job->quality );
+	free( job );
+}
+
+static void dv_job_decode( dv_job job )
+{
+	dv_decoder_t *decoder = dv_decoder_alloc( );
+	int pitches[3] = { 720 * 2, 0, 0 };
+	uint8_t *pixels[3] = { NULL, NULL, NULL };
+	int height = job->dv_data[ 3 ] & 0x80 ? 576 : 480;
+
+	dv_decoder_set_quality( decoder, job->quality );
+	dv_parse_header( decoder, job->dv_data );
+
+	job->size = 720 * ( height + 1 ) * 2;
+	job->image = mlt_pool_alloc( job->size );
+	pixels[ 0 ] = job->image;
+	dv_decode_full_frame( decoder, job->dv_data, e_dv_color_yuv, pixels, pitches );
+
+	dv_decoder_return( decoder );
+}
+
+static void *dv_worker( void *arg )
+{
+	pthread_mutex_lock( &job_lock );
+	while ( !job_stop )
+	{
+		dv_job job = mlt_deque_pop_front( job_queue );
+		mlt_frame frame;
+
+		if ( job == NULL )
+		{
+			pthread_cond_wait( &job_ready, &job_lock );
+			continue;
+		}
+
+		// Jobs claimed by get_image in the meantime only need their reference dropped,
+		// as do jobs whose frame was closed by everyone else
+		frame = job->frame;
+		if ( job->state == JOB_QUEUED && mlt_properties_ref_count( MLT_FRAME_PROPERTIES( frame ) ) <= 1 )
+			job->state = JOB_CLAIMED;
+		if ( job->state == JOB_QUEUED )
+		{
+			job->state = JOB_RUNNING;
+			pthread_mutex_unlock( &job_lock );
+			dv_job_decode( job );
+			pthread_mutex_lock( &job_lock );
+			job->state = JOB_DONE;
+			pthread_cond_broadcast( &job_done );
+		}
+		pthread_mutex_unlock( &job_lock );
+		mlt_frame_close( frame );
+		pthread_mutex_lock( &job_lock );
+	}
+	pthread_mutex_unlock( &job_lock );
+	return NULL;
+}
+
+static void dv_workers_stop( void *arg )
+{
+	dv_job job;
+	int i;
+
+	pthread_mutex_lock( &job_lock );
+	job_stop = 1;
+	pthread_cond_broadcast( &job_ready );
+	pthread_mutex_unlock( &job_lock );
+
+	for ( i = 0; i < job_workers; i ++ )
+		pthread_join( job_threads[ i ], NULL );
+	job_workers = 0;
+
+	while ( ( job = mlt_deque_pop_front( job_queue ) ) != NULL )
+		mlt_frame_close( job->frame );
+	mlt_deque_close( job_queue );
+	job_queue = NULL;
+}
+
+static void dv_job_submit( mlt_producer producer, int *unused, mlt_frame frame, uint8_t *dv_data, const char *quality, int workers )
+{
+	dv_job job;
+
+	// While images go unused, only every DECODE_AHEAD_MAX-th frame is submitted,
+	// to find out when they are wanted again
+	int count = __atomic_load_n( unused, __ATOMIC_RELAXED );
+	if ( count >= DECODE_AHEAD_MAX && count % DECODE_AHEAD_MAX )
+	{
+		__sync_fetch_and_add( unused, 1 );
+		return;
+	}
+
+	pthread_mutex_lock( &job_lock );
+	if ( job_queue == NULL )
+	{
+		job_queue = mlt_deque_init( );
+		job_stop = 0;
+		mlt_factory_register_for_clean_up( &job_workers, dv_workers_stop );
+	}
+	if ( mlt_deque_count( job_queue ) >= DECODE_AHEAD_MAX )
+	{
+		pthread_mutex_unlock( &job_lock );
+		return;
+	}
+	if ( workers > DECODE_AHEAD_MAX )
+		workers = DECODE_AHEAD_MAX;
+	while ( job_workers < workers && pthread_create( &job_threads[ job_workers ], NULL, dv_worker, NULL ) == 0 )
+		job_workers ++;
+
+	job = calloc( 1, sizeof( struct dv_job_s ) );
+	job->frame = frame;
+	job->dv_data = dv_data;
+	job->quality = quality ? strdup( quality ) : NULL;
+	job->state = JOB_QUEUED;
+	job->producer = producer;
+	job->unused = unused;
+	mlt_properties_inc_ref( MLT_PRODUCER_PROPERTIES( producer ) );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), "_dv_job", job, 0, ( mlt_destructor )dv_job_close, NULL );
+	mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( frame ) );
+
+	mlt_deque_push_back( job_queue, job );
+	pthread_cond_signal( &job_ready );
+	pthread_mutex_unlock( &job_lock );
+}
+
+/** Wait for a decode ahead job, or claim it if no worker has started on it yet.
+    Returns true when the decoded image is available.
+*/
+
+static int dv_job_wait( dv_job job )
+{
+	int result;
+
+	pthread_mutex_lock( &job_lock );
+	job->used = 1;
+	if ( job->state == JOB_QUEUED )
+		job->state = JOB_CLAIMED;
+	while ( job->state == JOB_RUNNING )
+		pthread_cond_wait( &job_done, &job_lock );
+	result = job->state == JOB_DONE && job->image != NULL;
+	pthread_mutex_unlock( &job_lock );
+
+	return result;
+}
+
+/** Take a decode ahead job off the workers' hands without using its result.
+*/
+
+static void dv_job_cancel( dv_job job )
+{
+	pthread_mutex_lock( &job_lock );
+	job->used = 1;
+	if ( job->state == JOB_QUEUED )
+		job->state = JOB_CLAIMED;
+	pthread_mutex_unlock( &job_lock );
+}
+
+
+/** A read only mapping of the file, shared by the producer and the frames
+    whose dv data points into it.
+*/
+
+typedef struct dv_mapping_s
+{
+	uint8_t *addr;
+	size_t length;
+	int refs;
+	pthread_mutex_t mutex;
+}
+*dv_mapping;
+
+static dv_mapping dv_mapping_open( int fd, uint64_t length )
+{
+	dv_mapping mapping = NULL;
+
+	if ( length > 0 && length <= ( size_t )-1 )
+	{
+		void *addr = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, 0 );
+		if ( addr != MAP_FAILED )
+		{
+			mapping = calloc( 1, sizeof( struct dv_mapping_s ) );
+			mapping->addr = addr;
+			mapping->length = length;
+			mapping->refs = 1;
+			pthread_mutex_init( &mapping->mutex, NULL );
+			madvise( addr, length, MADV_SEQUENTIAL );
+		}
+	}
+	return mapping;
+}
+
+static void dv_mapping_release( dv_mapping mapping )
+{
+	if ( mapping != NULL )
+	{
+		int refs;
+		pthread_mutex_lock( &mapping->mutex );
+		refs = -- mapping->refs;
+		pthread_mutex_unlock( &mapping->mutex );
+		if ( refs == 0 )
+		{
+			munmap( mapping->addr, mapping->length );
+			pthread_mutex_destroy( &mapping->mutex );
+			free( mapping );
+		}
+	}
+}
 
 typedef struct producer_libdv_s *producer_libdv;
 
@@ -128,6 +407,9 @@ struct producer_libdv_s
 	int frame_size;
 	long frames_in_file;
 	mlt_producer alternative;
+	dv_mapping mapping;
+	uint64_t last_position;
+	int unused_jobs;
 };
 
 static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int index );
@@ -178,6 +460,8 @@ mlt_producer producer_libdv_init( mlt_profile profile, mlt_service_type type, co
 			// Collect info
 			if ( this->fd == -1 || !producer_collect_info( this, profile ) )
 				destroy = 1;
+			else
+				this->mapping = dv_mapping_open( this->fd, this->file_size );
 		}
 
 		// If we couldn't open the file, then destroy it now
@@ -310,25 +594,33 @@ static int producer_get_image( mlt_frame this, uint8_t **buffer, mlt_image_forma
 	// Get the frames properties
 	mlt_properties properties = MLT_FRAME_PROPERTIES( this );
 
-	// Get a dv_decoder
-	dv_decoder_t *decoder = dv_decoder_alloc( );
-
 	// Get the dv data
 	uint8_t *dv_data = mlt_properties_get_data( properties, "dv_data", NULL );
 
-	// Get and set the quality request
+	// Get the quality request
 	char *quality = mlt_frame_pop_service( this );
 
-	if ( quality != NULL )
+	// Use the decode ahead result if there is one; the workers only produce yuv422
+	dv_job job = mlt_properties_get_data( properties, "_dv_job", NULL );
+	if ( job != NULL && *format == mlt_image_rgb24 )
 	{
-		if ( strncmp( quality, "fast", 4 ) == 0 )
-			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_DC );
-		else if ( strncmp( quality, "best", 4 ) == 0 )
-			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_AC_2 );
-		else
-			decoder->quality = ( DV_QUALITY_COLOR | DV_QUALITY_AC_1 );
+		dv_job_cancel( job );
+	}
+	else if ( job != NULL && dv_job_wait( job ) )
+	{
+		mlt_frame_set_image( this, job->image, job->size, mlt_pool_release );
+		*buffer = job->image;
+		*format = mlt_image_yuv422;
+		*width = 720;
+		*height = dv_data[ 3 ] & 0x80 ? 576 : 480;
+		job->image = NULL;
+		return 0;
 	}
 
+	// Get a dv_decoder
+	dv_decoder_t *decoder = dv_decoder_alloc( );
+	dv_decoder_set_quality( decoder, quality );
+
 	// Parse the header for meta info
 	dv_parse_header( decoder, dv_data );
 	
@@ -453,7 +745,41 @@ static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int i
 	// Obtain the current frame number
 	uint64_t position = mlt_producer_frame( producer );
 	
-	if ( this->alternative == NULL )
+	if ( this->alternative == NULL && this->mapping != NULL &&
+		 position * this->frame_size + this->frame_size <= this->mapping->length )
+	{
+		// Convert timecode to a file position (ensuring that we're on a frame boundary)
+		uint64_t offset = position * this->frame_size;
+		dv_mapping mapping = this->mapping;
+
+		// Create an empty frame
+		*frame = mlt_frame_init( MLT_PRODUCER_SERVICE( producer ) );
+
+		// Decode straight from the mapped file
+		data = mapping->addr + offset;
+		this->is_pal = data[ 3 ] & 0x80;
+
+		// Read ahead: the whole window after a seek, then one frame at a time
+		uint64_t first = position == this->last_position + 1 ? position + READ_AHEAD_FRAMES : position + 1;
+		uint64_t last = position + READ_AHEAD_FRAMES;
+		if ( last >= this->frames_in_file )
+			last = this->frames_in_file - 1;
+		if ( first <= last )
+		{
+			long page = sysconf( _SC_PAGESIZE );
+			uint64_t start = ( first * this->frame_size ) & ~( uint64_t )( page - 1 );
+			madvise( mapping->addr + start, ( last + 1 ) * this->frame_size - start, MADV_WILLNEED );
+		}
+		this->last_position = position;
+
+		// The frame keeps the mapping alive for as long as it uses the data
+		pthread_mutex_lock( &mapping->mutex );
+		mapping->refs ++;
+		pthread_mutex_unlock( &mapping->mutex );
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( *frame ), "_dv_mapping", mapping, 0, ( mlt_destructor )dv_mapping_release, NULL );
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( *frame ), "dv_data", data, this->frame_size, NULL, NULL );
+	}
+	else if ( this->alternative == NULL )
 	{
 		// Convert timecode to a file position (ensuring that we're on a frame boundary)
 		uint64_t offset = position * this->frame_size;
@@ -529,6 +855,11 @@ static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int i
 
 			// Push the get_image method on to the stack
 			mlt_frame_push_get_image( *frame, producer_get_image );
+
+			// Start decoding in the background if requested
+			int decode_ahead = mlt_properties_get_int( MLT_PRODUCER_PROPERTIES( producer ), "decode_ahead" );
+			if ( decode_ahead > 0 )
+				dv_job_submit( producer, &this->unused_jobs, *frame, data, mlt_properties_get( MLT_PRODUCER_PROPERTIES( producer ), "quality" ), decode_ahead );
 		}
 	
 		// Return the decoder
@@ -553,6 +884,7 @@ static void producer_close( mlt_producer parent )
 	// Close the file
 	if ( this->fd > 0 )
 		close( this->fd );
+	dv_mapping_release( this->mapping );
 
 	if ( this->alternative )
 		mlt_producer_close( this->alternative );
@@ -26,6 +26,9 @@
 #include <math.h>
 #include <glib.h>
 #include <stdio.h>
+#include <pthread.h>
+
+#include <framework/mlt_slices.h>
 
 #include "pixops.h"
 
@@ -58,6 +61,27 @@ typedef guchar *( *PixopsLineFunc ) ( int *weights, int n_x, int n_y,
 
 typedef void ( *PixopsPixelFunc ) ( guchar *dest, guint y1, guint cr, guint y2, guint cb );
 
+/* Filter weights for one geometry, shared between frames */
+typedef struct _PixopsFilterCache PixopsFilterCache;
+
+struct _PixopsFilterCache
+{
+	PixopsInterpType interp_type;
+	double scale_x;
+	double scale_y;
+	PixopsFilter filter;
+	int *filter_weights;	/* n_x * n_y weights per subpixel phase */
+	int *line_weights;	/* the same with the n_x weights of each row summed */
+	int refs;
+	guint64 last_used;
+};
+
+#define FILTER_CACHE_SIZE 4
+
+static PixopsFilterCache *filter_cache[ FILTER_CACHE_SIZE ];
+static guint64 filter_cache_clock = 0;
+static pthread_mutex_t filter_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /* mmx function declarations */
 #if defined(USE_MMX) && !defined(ARCH_X86_64)
@@ -342,131 +366,231 @@ make_filter_table ( PixopsFilter *filter )
 }
 
 
-static inline void
-pixops_process ( guchar *dest_buf,
-                 int render_x0,
-                 int render_y0,
-                 int render_x1,
-                 int render_y1,
-                 int dest_rowstride,
-                 int dest_channels,
-                 gboolean dest_has_alpha,
-                 const guchar *src_buf,
-                 int src_width,
-                 int src_height,
-                 int src_rowstride,
-                 int src_channels,
-                 gboolean src_has_alpha,
-                 double scale_x,
-                 double scale_y,
-                 int check_x,
-                 int check_y,
-                 int check_size,
-                 guint32 color1,
-                 guint32 color2,
-                 PixopsFilter *filter,
-                 PixopsLineFunc line_func )
+/* Sum the horizontal taps of every filter row.
+ *
+ * scale_line reads the same source sample for all n_x taps of a row, so
+ * the summed table gives identical results with n_x = 1.
+ */
+static inline int *
+make_line_table ( PixopsFilter *filter, int *filter_weights )
 {
+	int n_x = filter->x.n;
+	int n_y = filter->y.n;
+	int *weights = g_new ( int, SUBSAMPLE * SUBSAMPLE * n_y );
 	int i, j;
-	int x, y;			/* X and Y position in source (fixed_point) */
 
-	guchar **line_bufs = g_new ( guchar *, filter->y.n );
-	int *filter_weights = make_filter_table ( filter );
+	for ( i = 0; i < SUBSAMPLE * SUBSAMPLE * n_y; i++ )
+	{
+		weights[ i ] = 0;
+		for ( j = 0; j < n_x; j++ )
+			weights[ i ] += filter_weights[ i * n_x + j ];
+	}
 
-	int x_step = ( 1 << SCALE_SHIFT ) / scale_x; /* X step in source (fixed point) */
-	int y_step = ( 1 << SCALE_SHIFT ) / scale_y; /* Y step in source (fixed point) */
+	return weights;
+}
 
-	int scaled_x_offset = floor ( filter->x.offset * ( 1 << SCALE_SHIFT ) );
+struct pixops_slice_desc
+{
+	guchar *dest_buf;
+	int render_x0;
+	int render_y0;
+	int render_x1;
+	int render_y1;
+	int dest_rowstride;
+	int dest_channels;
+	const guchar *src_buf;
+	int src_width;
+	int src_height;
+	int src_rowstride;
+	int src_channels;
+	int check_x;
+	PixopsFilter *filter;
+	int *filter_weights;
+	int *line_weights;
+	int line_n_x;
+	PixopsLineFunc line_func;
+	int x_step;
+	int y_step;
+	int scaled_x_offset;
+	int run_end_index;
+};
 
-	/* Compute the index where we run off the end of the source buffer. The furthest
-	 * source pixel we access at index i is:
-	 *
-	 *  ((render_x0 + i) * x_step + scaled_x_offset) >> SCALE_SHIFT + filter->x.n - 1
-	 *
-	 * So, run_end_index is the smallest i for which this pixel is src_width, i.e, for which:
-	 *
-	 *  (i + render_x0) * x_step >= ((src_width - filter->x.n + 1) << SCALE_SHIFT) - scaled_x_offset
-	 *
-	 */
-#define MYDIV(a,b) ((a) > 0 ? (a) / (b) : ((a) - (b) + 1) / (b))    /* Division so that -1/5 = -1 */
+static int
+pixops_process_slice ( int id, int index, int jobs, void *cookie )
+{
+	struct pixops_slice_desc *d = cookie;
+	PixopsFilter *filter = d->filter;
+	int rows = d->render_y1 - d->render_y0;
+	int slice_height = ( rows + jobs - 1 ) / jobs;
+	int first = slice_height * index;
+	int last = MIN ( first + slice_height, rows );
+	int i, j;
+	int x, y;			/* X and Y position in source (fixed_point) */
 
-	int run_end_x = ( ( ( src_width - filter->x.n + 1 ) << SCALE_SHIFT ) - scaled_x_offset );
-	int run_end_index = MYDIV ( run_end_x + x_step - 1, x_step ) - render_x0;
-	run_end_index = MIN ( run_end_index, render_x1 - render_x0 );
+	guchar **line_bufs = g_new ( guchar *, filter->y.n );
 
-	y = render_y0 * y_step + floor ( filter->y.offset * ( 1 << SCALE_SHIFT ) );
-	for ( i = 0; i < ( render_y1 - render_y0 ); i++ )
+	y = ( d->render_y0 + first ) * d->y_step + floor ( filter->y.offset * ( 1 << SCALE_SHIFT ) );
+	for ( i = first; i < last; i++ )
 	{
 		int dest_x;
 		int y_start = y >> SCALE_SHIFT;
 		int x_start;
-		int *run_weights = filter_weights +
-		                   ( ( y >> ( SCALE_SHIFT - SUBSAMPLE_BITS ) ) & SUBSAMPLE_MASK ) *
-		                   filter->x.n * filter->y.n * SUBSAMPLE;
+		int y_phase = ( y >> ( SCALE_SHIFT - SUBSAMPLE_BITS ) ) & SUBSAMPLE_MASK;
+		int *run_weights = d->filter_weights + y_phase * filter->x.n * filter->y.n * SUBSAMPLE;
+		int *run_line_weights = d->line_weights + y_phase * d->line_n_x * filter->y.n * SUBSAMPLE;
 		guchar *new_outbuf;
 
-		guchar *outbuf = dest_buf + dest_rowstride * i;
-		guchar *outbuf_end = outbuf + dest_channels * ( render_x1 - render_x0 );
+		guchar *outbuf = d->dest_buf + d->dest_rowstride * i;
+		guchar *outbuf_end = outbuf + d->dest_channels * ( d->render_x1 - d->render_x0 );
 
 		for ( j = 0; j < filter->y.n; j++ )
 		{
 			if ( y_start < 0 )
-				line_bufs[ j ] = ( guchar * ) src_buf;
-			else if ( y_start < src_height )
-				line_bufs[ j ] = ( guchar * ) src_buf + src_rowstride * y_start;
+				line_bufs[ j ] = ( guchar * ) d->src_buf;
+			else if ( y_start < d->src_height )
+				line_bufs[ j ] = ( guchar * ) d->src_buf + d->src_rowstride * y_start;
 			else
-				line_bufs[ j ] = ( guchar * ) src_buf + src_rowstride * ( src_height - 1 );
+				line_bufs[ j ] = ( guchar * ) d->src_buf + d->src_rowstride * ( d->src_height - 1 );
 
 			y_start++;
 		}
 
-		dest_x = check_x;
-		x = render_x0 * x_step + scaled_x_offset;
+		dest_x = d->check_x;
+		x = d->render_x0 * d->x_step + d->scaled_x_offset;
 		x_start = x >> SCALE_SHIFT;
 
 		while ( x_start < 0 && outbuf < outbuf_end )
 		{
 			process_pixel ( run_weights + ( ( x >> ( SCALE_SHIFT - SUBSAMPLE_BITS ) ) & SUBSAMPLE_MASK ) * ( filter->x.n * filter->y.n ),
 			                filter->x.n, filter->y.n,
-			                outbuf, dest_x, dest_channels,
-			                line_bufs, src_channels,
-			                x >> SCALE_SHIFT, src_width );
+			                outbuf, dest_x, d->dest_channels,
+			                line_bufs, d->src_channels,
+			                x >> SCALE_SHIFT, d->src_width );
 
-			x += x_step;
+			x += d->x_step;
 			x_start = x >> SCALE_SHIFT;
 			dest_x++;
-			outbuf += dest_channels;
+			outbuf += d->dest_channels;
 		}
 
-		new_outbuf = ( *line_func ) ( run_weights, filter->x.n, filter->y.n,
-		                              outbuf, dest_x,
-		                              dest_buf + dest_rowstride * i + run_end_index * dest_channels,
-		                              line_bufs,
-		                              x, x_step, src_width );
+		new_outbuf = ( *d->line_func ) ( run_line_weights, d->line_n_x, filter->y.n,
+		                                 outbuf, dest_x,
+		                                 d->dest_buf + d->dest_rowstride * i + d->run_end_index * d->dest_channels,
+		                                 line_bufs,
+		                                 x, d->x_step, d->src_width );
 
-		dest_x += ( new_outbuf - outbuf ) / dest_channels;
+		dest_x += ( new_outbuf - outbuf ) / d->dest_channels;
 
-		x = ( dest_x - check_x + render_x0 ) * x_step + scaled_x_offset;
+		x = ( dest_x - d->check_x + d->render_x0 ) * d->x_step + d->scaled_x_offset;
 		outbuf = new_outbuf;
 
 		while ( outbuf < outbuf_end )
 		{
 			process_pixel ( run_weights + ( ( x >> ( SCALE_SHIFT - SUBSAMPLE_BITS ) ) & SUBSAMPLE_MASK ) * ( filter->x.n * filter->y.n ),
 			                filter->x.n, filter->y.n,
-			                outbuf, dest_x, dest_channels,
-			                line_bufs, src_channels,
-			                x >> SCALE_SHIFT, src_width );
+			                outbuf, dest_x, d->dest_channels,
+			                line_bufs, d->src_channels,
+			                x >> SCALE_SHIFT, d->src_width );
 
-			x += x_step;
+			x += d->x_step;
 			dest_x++;
-			outbuf += dest_channels;
+			outbuf += d->dest_channels;
 		}
 
-		y += y_step;
+		y += d->y_step;
 	}
 
 	g_free ( line_bufs );
-	g_free ( filter_weights );
+
+	return 0;
+}
+
+static inline void
+pixops_process ( guchar *dest_buf,
+                 int render_x0,
+                 int render_y0,
+                 int render_x1,
+                 int render_y1,
+                 int dest_rowstride,
+                 int dest_channels,
+                 gboolean dest_has_alpha,
+                 const guchar *src_buf,
+                 int src_width,
+                 int src_height,
+                 int src_rowstride,
+                 int src_channels,
+                 gboolean src_has_alpha,
+                 double scale_x,
+                 double scale_y,
+                 int check_x,
+                 int check_y,
+                 int check_size,
+                 guint32 color1,
+                 guint32 color2,
+                 PixopsFilterCache *cache,
+                 PixopsLineFunc line_func )
+{
+	PixopsFilter *filter = &cache->filter;
+	struct pixops_slice_desc desc;
+
+	int x_step = ( 1 << SCALE_SHIFT ) / scale_x; /* X step in source (fixed point) */
+	int y_step = ( 1 << SCALE_SHIFT ) / scale_y; /* Y step in source (fixed point) */
+
+	int scaled_x_offset = floor ( filter->x.offset * ( 1 << SCALE_SHIFT ) );
+
+	/* Compute the index where we run off the end of the source buffer. The furthest
+	 * source pixel we access at index i is:
+	 *
+	 *  ((render_x0 + i) * x_step + scaled_x_offset) >> SCALE_SHIFT + filter->x.n - 1
+	 *
+	 * So, run_end_index is the smallest i for which this pixel is src_width, i.e, for which:
+	 *
+	 *  (i + render_x0) * x_step >= ((src_width - filter->x.n + 1) << SCALE_SHIFT) - scaled_x_offset
+	 *
+	 */
+#define MYDIV(a,b) ((a) > 0 ? (a) / (b) : ((a) - (b) + 1) / (b))    /* Division so that -1/5 = -1 */
+
+	int run_end_x = ( ( ( src_width - filter->x.n + 1 ) << SCALE_SHIFT ) - scaled_x_offset );
+	int run_end_index = MYDIV ( run_end_x + x_step - 1, x_step ) - render_x0;
+	run_end_index = MIN ( run_end_index, render_x1 - render_x0 );
+
+	desc.dest_buf = dest_buf;
+	desc.render_x0 = render_x0;
+	desc.render_y0 = render_y0;
+	desc.render_x1 = render_x1;
+	desc.render_y1 = render_y1;
+	desc.dest_rowstride = dest_rowstride;
+	desc.dest_channels = dest_channels;
+	desc.src_buf = src_buf;
+	desc.src_width = src_width;
+	desc.src_height = src_height;
+	desc.src_rowstride = src_rowstride;
+	desc.src_channels = src_channels;
+	desc.check_x = check_x;
+	desc.filter = filter;
+	desc.filter_weights = cache->filter_weights;
+	desc.line_func = line_func;
+	desc.x_step = x_step;
+	desc.y_step = y_step;
+	desc.scaled_x_offset = scaled_x_offset;
+	desc.run_end_index = run_end_index;
+
+	if ( line_func == scale_line )
+	{
+		desc.line_weights = cache->line_weights;
+		desc.line_n_x = 1;
+	}
+	else
+	{
+		desc.line_weights = cache->filter_weights;
+		desc.line_n_x = filter->x.n;
+	}
+
+	/* Rows are independent, so split them across the slice threads */
+	if ( render_y1 - render_y0 > 1 )
+		mlt_slices_run_normal( MIN( render_y1 - render_y0, mlt_slices_count_normal() ), pixops_process_slice, &desc );
+	else
+		pixops_process_slice( 0, 0, 1, &desc );
 }
 
 
@@ -681,6 +805,112 @@ make_weights ( PixopsFilter *filter,
 }
 
 
+static void
+filter_cache_free ( PixopsFilterCache *cache )
+{
+	g_free ( cache->filter.x.weights );
+	g_free ( cache->filter.y.weights );
+	g_free ( cache->filter_weights );
+	g_free ( cache->line_weights );
+	g_free ( cache );
+}
+
+/* Find the slot for a new entry: an empty one, otherwise the least recently
+ * used entry that only the cache holds. Called with filter_cache_mutex held.
+ */
+static int
+filter_cache_slot ( void )
+{
+	int i, slot = -1;
+
+	for ( i = 0; i < FILTER_CACHE_SIZE; i++ )
+	{
+		PixopsFilterCache *entry = filter_cache[ i ];
+		if ( !entry )
+			return i;
+		if ( entry->refs == 1 && ( slot < 0 || entry->last_used < filter_cache[ slot ]->last_used ) )
+			slot = i;
+	}
+	return slot;
+}
+
+static PixopsFilterCache *
+filter_cache_find ( PixopsInterpType interp_type, double scale_x, double scale_y )
+{
+	int i;
+
+	for ( i = 0; i < FILTER_CACHE_SIZE; i++ )
+	{
+		PixopsFilterCache *entry = filter_cache[ i ];
+		if ( entry && entry->interp_type == interp_type &&
+		     entry->scale_x == scale_x && entry->scale_y == scale_y )
+			return entry;
+	}
+	return NULL;
+}
+
+/* Get the weight tables for a geometry, computing them when not cached.
+ * The result must be returned with filter_cache_release.
+ */
+static PixopsFilterCache *
+filter_cache_acquire ( PixopsInterpType interp_type, double scale_x, double scale_y )
+{
+	PixopsFilterCache *cache, *evicted = NULL;
+	int slot;
+
+	pthread_mutex_lock ( &filter_cache_mutex );
+	cache = filter_cache_find ( interp_type, scale_x, scale_y );
+	if ( cache )
+	{
+		cache->refs++;
+		cache->last_used = ++filter_cache_clock;
+		pthread_mutex_unlock ( &filter_cache_mutex );
+		return cache;
+	}
+	pthread_mutex_unlock ( &filter_cache_mutex );
+
+	cache = g_new0 ( PixopsFilterCache, 1 );
+	cache->interp_type = interp_type;
+	cache->scale_x = scale_x;
+	cache->scale_y = scale_y;
+	cache->refs = 1;
+	cache->filter.overall_alpha = 1.0;
+	make_weights ( &cache->filter, interp_type, scale_x, scale_y );
+	cache->filter_weights = make_filter_table ( &cache->filter );
+	cache->line_weights = make_line_table ( &cache->filter, cache->filter_weights );
+
+	/* Entries are idle when only the cache's own reference is left */
+	pthread_mutex_lock ( &filter_cache_mutex );
+	slot = filter_cache_find ( interp_type, scale_x, scale_y ) ? -1 : filter_cache_slot ( );
+	if ( slot >= 0 )
+	{
+		if ( filter_cache[ slot ] && --filter_cache[ slot ]->refs == 0 )
+			evicted = filter_cache[ slot ];
+		cache->refs++;
+		cache->last_used = ++filter_cache_clock;
+		filter_cache[ slot ] = cache;
+	}
+	pthread_mutex_unlock ( &filter_cache_mutex );
+
+	if ( evicted )
+		filter_cache_free ( evicted );
+
+	return cache;
+}
+
+static void
+filter_cache_release ( PixopsFilterCache *cache )
+{
+	int refs;
+
+	pthread_mutex_lock ( &filter_cache_mutex );
+	refs = --cache->refs;
+	pthread_mutex_unlock ( &filter_cache_mutex );
+
+	if ( refs == 0 )
+		filter_cache_free ( cache );
+}
+
 void
 yuv422_scale ( guchar *dest_buf,
                int render_x0,
@@ -700,7 +930,7 @@ yuv422_scale ( guchar *dest_buf,
                double scale_y,
                PixopsInterpType interp_type )
 {
-	PixopsFilter filter = { { 0, 0, 0}, { 0, 0, 0 }, 0 };
+	PixopsFilterCache *cache;
 	PixopsLineFunc line_func;
 
 #if defined(USE_MMX) && !defined(ARCH_X86_64)
@@ -723,10 +953,9 @@ yuv422_scale ( guchar *dest_buf,
 		return;
 	}
 
-	filter.overall_alpha = 1.0;
-	make_weights ( &filter, interp_type, scale_x, scale_y );
+	cache = filter_cache_acquire ( interp_type, scale_x, scale_y );
 
-	if ( filter.x.n == 2 && filter.y.n == 2 )
+	if ( cache->filter.x.n == 2 && cache->filter.y.n == 2 )
 	{
 #if defined(USE_MMX) && !defined(ARCH_X86_64)
 		if ( found_mmx )
@@ -746,9 +975,8 @@ yuv422_scale ( guchar *dest_buf,
 	                 dest_rowstride, dest_channels, dest_has_alpha,
 	                 src_buf, src_width, src_height, src_rowstride, src_channels,
 	                 src_has_alpha, scale_x, scale_y, 0, 0, 0, 0, 0,
-	                 &filter, line_func );
+	                 cache, line_func );
 
-	g_free ( filter.x.weights );
-	g_free ( filter.y.weights );
+	filter_cache_release ( cache );
 }
 
@@ -180,10 +180,17 @@ static int ladspa_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 				plugin->wet_dry_values[c] = value;
 		}
 
-		// Configure the buffers
-		LADSPA_Data **input_buffers  = mlt_pool_alloc( sizeof( LADSPA_Data* ) * jackrack->channels );
-		LADSPA_Data **output_buffers = mlt_pool_alloc( sizeof( LADSPA_Data* ) * jackrack->channels );
-		
+		// Configure the buffers, reusing the pointer arrays between frames
+		int buffers_size = 0;
+		LADSPA_Data **input_buffers = mlt_properties_get_data( filter_properties, "_buffers", &buffers_size );
+		if ( !input_buffers || buffers_size < 2 * jackrack->channels )
+		{
+			buffers_size = 2 * jackrack->channels;
+			input_buffers = mlt_pool_alloc( sizeof( LADSPA_Data* ) * buffers_size );
+			mlt_properties_set_data( filter_properties, "_buffers", input_buffers, buffers_size, mlt_pool_release, NULL );
+		}
+		LADSPA_Data **output_buffers = input_buffers + jackrack->channels;
+
 		// Some plugins crash with too many frames (samples).
 		// So, feed the plugin with N samples per loop iteration.
 		int samples_offset = 0;
@@ -198,9 +205,6 @@ static int ladspa_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 			samples_offset += MAX_SAMPLE_COUNT;
 		}
 
-		mlt_pool_release( input_buffers );
-		mlt_pool_release( output_buffers );
-
 		// read the status port values
 		for ( i = 0; i < plugin->desc->status_port_count; i++ )
 		{
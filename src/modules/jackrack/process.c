@@ -37,6 +37,7 @@
 #include "plugin.h"
 #include "jack_rack.h"
 #include "framework/mlt_log.h"
+#include "framework/mlt_slices.h"
 
 #ifndef _
 #define _(x) x
@@ -48,6 +49,7 @@ extern pthread_mutex_t g_activate_mutex;
 #define MSEC_PER_SEC         1000
 #define TIME_RUN_SKIP_COUNT  5
 #define MAX_BUFFER_SIZE      4096
+#define SLICE_MIN_FRAMES     256
 
 jack_nframes_t sample_rate;
 jack_nframes_t buffer_size;
@@ -209,6 +211,124 @@ connect_chain (process_info_t * procinfo, jack_nframes_t frames)
     plugin_connect_input_ports (first_enabled, procinfo->jack_input_buffers);
 }
 
+static void
+apply_wet_dry (plugin_t * plugin, unsigned long channel, jack_nframes_t frames)
+{
+  LADSPA_Data wet, dry;
+  unsigned long i;
+
+  if (!plugin->wet_dry_enabled)
+    return;
+
+  wet = plugin->wet_dry_values[channel];
+  dry = 1.0 - wet;
+  for (i = 0; i < frames; i++)
+    plugin->audio_output_memory[channel][i] = plugin->audio_output_memory[channel][i] * wet
+                                            + plugin->audio_input_memory[channel][i] * dry;
+}
+
+/** run one plugin copy and apply wet/dry to the rack channels it owns */
+static void
+run_copy (process_info_t * procinfo, plugin_t * plugin, gint copy, jack_nframes_t frames)
+{
+  unsigned long channel = copy * plugin->desc->channels;
+  unsigned long end = MIN (channel + plugin->desc->channels, procinfo->channels);
+
+  plugin->descriptor->run (plugin->holders[copy].instance, frames);
+  for (; channel < end; channel++)
+    apply_wet_dry (plugin, channel, frames);
+}
+
+/** run the chain from first to last over the rack channels [begin, end),
+    which must not split any plugin copy */
+static void
+run_chain_channels (process_info_t * procinfo, plugin_t * first, plugin_t * last,
+                    unsigned long begin, unsigned long end, jack_nframes_t frames)
+{
+  plugin_t * plugin;
+  unsigned long channel;
+  gint copy;
+
+  for (plugin = first; plugin; plugin = plugin->next)
+    {
+      if (plugin->enabled)
+        {
+          unsigned long width = plugin->desc->channels;
+
+          for (copy = begin / width; copy < plugin->copies && copy * width < end; copy++)
+            run_copy (procinfo, plugin, copy, frames);
+          /* channels left over when copies do not cover the rack */
+          for (channel = MAX (begin, plugin->copies * width); channel < end; channel++)
+            apply_wet_dry (plugin, channel, frames);
+
+          if (plugin == last)
+            break;
+        }
+      else
+        {
+          /* copy the data through */
+          for (channel = begin; channel < end; channel++)
+            memcpy (plugin->audio_output_memory[channel],
+                    plugin->prev->audio_output_memory[channel],
+                    sizeof(LADSPA_Data) * frames);
+        }
+    }
+}
+
+/** the smallest run of rack channels that no enabled plugin copy straddles,
+    or 0 if the chain must not be split */
+static unsigned long
+chain_group_size (plugin_t * first, plugin_t * last)
+{
+  plugin_t * plugin;
+  unsigned long size = 1;
+
+  for (plugin = first; plugin; plugin = plugin->next)
+    {
+      if (plugin->enabled)
+        {
+          unsigned long a = size, b = plugin->desc->channels;
+
+          /* output aux ports of all copies share one buffer */
+          if (plugin->desc->aux_channels > 0 && !plugin->desc->aux_are_input)
+            return 0;
+          while (b)
+            {
+              unsigned long t = a % b;
+              a = b;
+              b = t;
+            }
+          size = size / a * plugin->desc->channels;
+          if (plugin == last)
+            break;
+        }
+    }
+  return size;
+}
+
+struct run_chain_ctx
+{
+  process_info_t * procinfo;
+  plugin_t * first;
+  plugin_t * last;
+  unsigned long group;
+  unsigned long groups;
+  jack_nframes_t frames;
+};
+
+static int
+run_chain_slice (int id, int index, int count, void * cookie)
+{
+  struct run_chain_ctx * ctx = cookie;
+  unsigned long group;
+
+  for (group = index; group < ctx->groups; group += count)
+    run_chain_channels (ctx->procinfo, ctx->first, ctx->last, group * ctx->group,
+                        MIN ((group + 1) * ctx->group, ctx->procinfo->channels), ctx->frames);
+
+  return 0;
+}
+
 void
 process_chain (process_info_t * procinfo, jack_nframes_t frames)
 {
@@ -216,6 +336,7 @@ process_chain (process_info_t * procinfo, jack_nframes_t frames)
   plugin_t * last_enabled = NULL;
   plugin_t * plugin;
   unsigned long channel;
+  unsigned long group, groups;
   unsigned long i;
 
   if (procinfo->jack_client)
@@ -256,38 +377,22 @@ process_chain (process_info_t * procinfo, jack_nframes_t frames)
   /* all past here is guaranteed to have at least 1 enabled plugin */
 
   last_enabled = get_last_enabled_plugin (procinfo);
-  
-  for (plugin = first_enabled;
-       plugin;
-       plugin = plugin->next)
+
+  /* groups of channels that no plugin copy straddles are independent
+     through the whole chain, so outside the JACK RT thread each slice
+     takes some groups from the first plugin to the last */
+  group = chain_group_size (first_enabled, last_enabled);
+  groups = group ? (procinfo->channels + group - 1) / group : 1;
+  if (!procinfo->jack_client && groups > 1 && frames >= SLICE_MIN_FRAMES && mlt_slices_count_normal () > 1)
     {
-      if (plugin->enabled)
-        {
-          for (i = 0; i < plugin->copies; i++)
-            plugin->descriptor->run (plugin->holders[i].instance, frames);
-          
-          if (plugin->wet_dry_enabled)
-            for (channel = 0; channel < procinfo->channels; channel++)
-              for (i = 0; i < frames; i++)
-                {
-                  plugin->audio_output_memory[channel][i] *= plugin->wet_dry_values[channel];
-                  plugin->audio_output_memory[channel][i] += plugin->audio_input_memory[channel][i] * (1.0 - plugin->wet_dry_values[channel]);
-                }
-          
-          if (plugin == last_enabled)
-            break;
-        }
-      else
-        {
-    
-          /* copy the data through */
-          for (i = 0; i < procinfo->channels; i++)
-            memcpy (plugin->audio_output_memory[i],
-                    plugin->prev->audio_output_memory[i],
-                    sizeof(LADSPA_Data) * frames);
-        }
+      struct run_chain_ctx ctx = { procinfo, first_enabled, last_enabled, group, groups, frames };
+      mlt_slices_run_normal (MIN (groups, mlt_slices_count_normal ()), run_chain_slice, &ctx);
     }
-  
+  else
+    {
+      run_chain_channels (procinfo, first_enabled, last_enabled, 0, procinfo->channels, frames);
+    }
+
   /* copy the last enabled data to the jack ports */
   for (i = 0; i < procinfo->channels; i++)
     memcpy (procinfo->jack_output_buffers[i],
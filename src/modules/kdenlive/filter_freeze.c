@@ -27,6 +27,65 @@
 #include <stdio.h>
 #include <string.h>
 
+/** Get the frozen image rendered for the requested format and size.
+ *
+ * Each rendering is copied once, kept on the freeze frame, and then shared
+ * read only between the frames that ask for the same format and size. Release the returned reference with
+ * mlt_properties_close().
+ */
+
+static mlt_properties get_held_image( mlt_filter filter, mlt_frame freeze_frame, mlt_image_format format, int width, int height )
+{
+	mlt_properties freeze_properties = MLT_FRAME_PROPERTIES( freeze_frame );
+	mlt_properties held;
+	uint8_t *buffer = NULL;
+	char key[64];
+	int error;
+
+	snprintf( key, sizeof( key ), "_held.%d.%dx%d", format, width, height );
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	held = mlt_properties_get_data( freeze_properties, key, NULL );
+	if ( held )
+	{
+		mlt_properties_inc_ref( held );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+		return held;
+	}
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	// Render without the lock, the freeze frame may come back through this filter
+	held = mlt_properties_new();
+
+	error = mlt_frame_get_image( freeze_frame, &buffer, &format, &width, &height, 0 );
+	mlt_properties_set_int( held, "error", error );
+	if ( buffer )
+	{
+		int size = mlt_image_format_size( format, width, height, NULL );
+		uint8_t *image_copy = mlt_pool_alloc( size );
+		uint8_t *alpha_buffer = mlt_frame_get_alpha( freeze_frame );
+
+		memcpy( image_copy, buffer, size );
+		mlt_properties_set_data( held, "image", image_copy, size, mlt_pool_release, NULL );
+		if ( alpha_buffer )
+		{
+			int alphasize = width * height;
+			uint8_t *alpha_copy = mlt_pool_alloc( alphasize );
+			memcpy( alpha_copy, alpha_buffer, alphasize );
+			mlt_properties_set_data( held, "alpha", alpha_copy, alphasize, mlt_pool_release, NULL );
+		}
+	}
+	mlt_properties_set_int( held, "format", format );
+	mlt_properties_set_int( held, "width", width );
+	mlt_properties_set_int( held, "height", height );
+
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	mlt_properties_inc_ref( held );
+	mlt_properties_set_data( freeze_properties, key, held, 0, ( mlt_destructor )mlt_properties_close, NULL );
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	return held;
+}
+
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
 {
 	// Get the image
@@ -70,26 +129,43 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			mlt_properties_set_data( properties, "freeze_frame", freeze_frame, 0, ( mlt_destructor )mlt_frame_close, NULL );
 			mlt_properties_set_position( properties, "_frame", pos );
 		}
+		mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( freeze_frame ) );
 		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
 		// Get frozen image
-		uint8_t *buffer = NULL;
-		int error = mlt_frame_get_image( freeze_frame, &buffer, format, width, height, 1 );
-
-		// Copy it to current frame
-		int size = mlt_image_format_size( *format, *width, *height, NULL );
-		uint8_t *image_copy = mlt_pool_alloc( size );
-		memcpy( image_copy, buffer, size );
-		*image = image_copy;
-		mlt_frame_set_image( frame, *image, size, mlt_pool_release );
-
-		uint8_t *alpha_buffer = mlt_frame_get_alpha( freeze_frame );
-		if ( alpha_buffer )
+		mlt_properties held = get_held_image( filter, freeze_frame, *format, *width, *height );
+		mlt_frame_close( freeze_frame );
+
+		int size = 0;
+		int alphasize = 0;
+		uint8_t *alpha = mlt_properties_get_data( held, "alpha", &alphasize );
+		int error = mlt_properties_get_int( held, "error" );
+		*image = mlt_properties_get_data( held, "image", &size );
+		*format = mlt_properties_get_int( held, "format" );
+		*width = mlt_properties_get_int( held, "width" );
+		*height = mlt_properties_get_int( held, "height" );
+
+		// Only copy the frozen image when the caller is going to write to it
+		if ( writable && *image )
 		{
-			int alphasize = *width * *height;
-			uint8_t *alpha_copy = mlt_pool_alloc( alphasize );
-			memcpy( alpha_copy, alpha_buffer, alphasize );
-			mlt_frame_set_alpha( frame, alpha_copy, alphasize, mlt_pool_release );
+			uint8_t *image_copy = mlt_pool_alloc( size );
+			memcpy( image_copy, *image, size );
+			*image = image_copy;
+			mlt_frame_set_image( frame, *image, size, mlt_pool_release );
+			if ( alpha )
+			{
+				uint8_t *alpha_copy = mlt_pool_alloc( alphasize );
+				memcpy( alpha_copy, alpha, alphasize );
+				mlt_frame_set_alpha( frame, alpha_copy, alphasize, mlt_pool_release );
+			}
+			mlt_properties_close( held );
+		}
+		else
+		{
+			mlt_frame_set_image( frame, *image, size, NULL );
+			if ( alpha )
+				mlt_frame_set_alpha( frame, alpha, alphasize, NULL );
+			mlt_properties_set_data( props, "_held", held, 0, ( mlt_destructor )mlt_properties_close, NULL );
 		}
 		return error;
 	}
@@ -220,6 +220,16 @@ bool FileHandler::Done()
 	return done;
 }
 
+
+/** Locate a frame's data within the file.
+
+    Handlers that cannot address frames directly in the file return -1.
+*/
+int FileHandler::GetFrameInfo( off_t &offset, int &size, int frameNum )
+{
+	return -1;
+}
+
 #if 0
 bool FileHandler::WriteFrame( const Frame& frame )
 {
@@ -417,6 +427,15 @@ bool RawHandler::Open( const char *s )
 
 }
 
+int RawHandler::GetFrameInfo( off_t &offset, int &size, int frameNum )
+{
+	if ( frameNum < 0 )
+		return -1;
+	size = 480 * numBlocks;
+	offset = ( ( off_t ) frameNum * ( off_t ) size );
+	return 0;
+}
+
 int RawHandler::GetFrame( uint8_t *data, int frameNum )
 {
 	assert( fd != -1 );
@@ -618,6 +637,11 @@ bool AVIHandler::Open( const char *s )
 
 }
 
+int AVIHandler::GetFrameInfo( off_t &offset, int &size, int frameNum )
+{
+	return avi->GetDVFrameInfo( offset, size, frameNum );
+}
+
 int AVIHandler::GetFrame( uint8_t *data, int frameNum )
 {
 	int result = avi->GetDVFrame( data, frameNum );
@@ -101,6 +101,7 @@ public:
 
 	virtual bool Open( const char *s ) = 0;
 	virtual int GetFrame( uint8_t *data, int frameNum ) = 0;
+	virtual int GetFrameInfo( off_t &offset, int &size, int frameNum );
 	int GetFramesWritten() const
 	{
 		return framesWritten;
@@ -137,6 +138,7 @@ public:
 	int GetTotalFrames();
 	bool Open( const char *s );
 	int GetFrame( uint8_t *data, int frameNum );
+	int GetFrameInfo( off_t &offset, int &size, int frameNum );
 private:
 	int numBlocks;
 };
@@ -157,6 +159,7 @@ public:
 	int GetTotalFrames();
 	bool Open( const char *s );
 	int GetFrame( uint8_t *data, int frameNum );
+	int GetFrameInfo( off_t &offset, int &size, int frameNum );
 	bool GetOpenDML() const;
 	void SetOpenDML( bool );
 	int GetFormat() const
@@ -19,6 +19,11 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "kino_wrapper.h"
 #include "filehandler.h"
@@ -28,20 +33,107 @@ extern "C"
 
 #include <framework/mlt_pool.h>
 
+/* Number of frames to ask the kernel to read ahead during sequential access */
+#define READ_AHEAD_FRAMES 25
+
+/* A read only mapping of the file, shared by the wrapper and the frames
+   whose dv data points into it */
+struct kino_mapping_s
+{
+	uint8_t *addr;
+	size_t length;
+	int refs;
+	pthread_mutex_t mutex;
+};
+
 struct kino_wrapper_s
 {
 	FileHandler *handler;
 	int is_pal;
+	kino_mapping mapping;
+	off_t *offsets;
+	int *sizes;
+	int count;
+	int last_index;
 };
 
 kino_wrapper kino_wrapper_init( )
 {
-	kino_wrapper self = ( kino_wrapper )malloc( sizeof( kino_wrapper_s ) );
-	if ( self != NULL )
-		self->handler = NULL;
+	kino_wrapper self = ( kino_wrapper )calloc( 1, sizeof( kino_wrapper_s ) );
 	return self;
 }
 
+static kino_mapping kino_mapping_open( const char *src )
+{
+	kino_mapping mapping = NULL;
+	struct stat info;
+	int fd = open( src, O_RDONLY );
+
+	if ( fd != -1 && fstat( fd, &info ) == 0 && info.st_size > 0 && ( uint64_t )info.st_size <= ( size_t )-1 )
+	{
+		void *addr = mmap( NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		if ( addr != MAP_FAILED )
+		{
+			mapping = ( kino_mapping )calloc( 1, sizeof( kino_mapping_s ) );
+			mapping->addr = ( uint8_t * )addr;
+			mapping->length = info.st_size;
+			mapping->refs = 1;
+			pthread_mutex_init( &mapping->mutex, NULL );
+			madvise( addr, info.st_size, MADV_SEQUENTIAL );
+		}
+	}
+	if ( fd != -1 )
+		close( fd );
+
+	return mapping;
+}
+
+void kino_mapping_release( kino_mapping mapping )
+{
+	if ( mapping != NULL )
+	{
+		pthread_mutex_lock( &mapping->mutex );
+		int refs = --mapping->refs;
+		pthread_mutex_unlock( &mapping->mutex );
+		if ( refs == 0 )
+		{
+			munmap( mapping->addr, mapping->length );
+			pthread_mutex_destroy( &mapping->mutex );
+			free( mapping );
+		}
+	}
+}
+
+/** Map the file and build the frame offset index.
+
+    When the handler cannot locate frames in the file, frames are read
+    through the handler as before.
+*/
+static void kino_wrapper_index( kino_wrapper self, const char *src )
+{
+	int count = self->handler->GetTotalFrames( );
+	off_t offset;
+	int size;
+	int i;
+
+	if ( count <= 0 || self->handler->GetFrameInfo( offset, size, 0 ) != 0 )
+		return;
+
+	self->mapping = kino_mapping_open( src );
+	if ( self->mapping == NULL )
+		return;
+
+	self->offsets = ( off_t * )malloc( count * sizeof( off_t ) );
+	self->sizes = ( int * )malloc( count * sizeof( int ) );
+	for ( i = 0; i < count; i++ )
+	{
+		if ( self->handler->GetFrameInfo( self->offsets[ i ], self->sizes[ i ], i ) != 0 )
+			self->sizes[ i ] = -1;
+	}
+	self->count = count;
+	self->last_index = -1;
+}
+
 int kino_wrapper_open( kino_wrapper self, char *src )
 {
 	if ( self != NULL )
@@ -71,6 +163,9 @@ int kino_wrapper_open( kino_wrapper self, char *src )
 				self = NULL;
 			mlt_pool_release( data );
 		}
+
+		if ( self != NULL && self->handler != NULL )
+			kino_wrapper_index( self, src );
 	}
 
 	return kino_wrapper_is_open( self );
@@ -96,10 +191,62 @@ int kino_wrapper_get_frame( kino_wrapper self, uint8_t *data, int index )
 	return self != NULL && self->handler != NULL ? !self->handler->GetFrame( data, index ) : 0;
 }
 
+/** Get a pointer to a frame's data in the mapped file.
+
+    On success, the caller owns a reference to the mapping which must be
+    released with kino_mapping_release when the data is no longer needed.
+    NULL is returned when the frame is not available from the mapping.
+*/
+uint8_t *kino_wrapper_map_frame( kino_wrapper self, int index, kino_mapping *mapping )
+{
+	if ( self == NULL || self->mapping == NULL || index < 0 || index >= self->count )
+		return NULL;
+
+	off_t offset = self->offsets[ index ];
+	int size = self->sizes[ index ];
+	kino_mapping map = self->mapping;
+
+	if ( size < 120000 || offset < 0 || ( uint64_t )offset + size > map->length )
+		return NULL;
+
+	uint8_t *data = map->addr + offset;
+
+	// The decoder reads a whole PAL or NTSC frame
+	if ( size < ( ( data[3] & 0x80 ) ? 144000 : 120000 ) )
+		return NULL;
+
+	// Read ahead: the whole window after a seek, then one frame at a time
+	int first = index == self->last_index + 1 ? index + READ_AHEAD_FRAMES : index + 1;
+	int last = index + READ_AHEAD_FRAMES;
+	if ( last >= self->count )
+		last = self->count - 1;
+	if ( first <= last && self->sizes[ first ] > 0 && self->sizes[ last ] > 0 )
+	{
+		long page = sysconf( _SC_PAGESIZE );
+		off_t start = self->offsets[ first ] & ~( off_t )( page - 1 );
+		off_t end = self->offsets[ last ] + self->sizes[ last ];
+		if ( start >= 0 && end > start && ( uint64_t )end <= map->length )
+			madvise( map->addr + start, end - start, MADV_WILLNEED );
+	}
+	self->last_index = index;
+
+	pthread_mutex_lock( &map->mutex );
+	map->refs ++;
+	pthread_mutex_unlock( &map->mutex );
+	*mapping = map;
+
+	return data;
+}
+
 void kino_wrapper_close( kino_wrapper self )
 {
 	if ( self )
+	{
 		delete self->handler;
+		kino_mapping_release( self->mapping );
+		free( self->offsets );
+		free( self->sizes );
+	}
 	free( self );
 }
 
@@ -28,6 +28,7 @@ extern "C"
 #endif
 
 typedef struct kino_wrapper_s *kino_wrapper;
+typedef struct kino_mapping_s *kino_mapping;
 
 extern kino_wrapper kino_wrapper_init( );
 extern int kino_wrapper_open( kino_wrapper, char * );
@@ -35,6 +36,8 @@ extern int kino_wrapper_is_open( kino_wrapper );
 extern int kino_wrapper_is_pal( kino_wrapper );
 extern int kino_wrapper_get_frame_count( kino_wrapper );
 extern int kino_wrapper_get_frame( kino_wrapper, uint8_t *, int );
+extern uint8_t *kino_wrapper_map_frame( kino_wrapper, int, kino_mapping * );
+extern void kino_mapping_release( kino_mapping );
 extern void kino_wrapper_close( kino_wrapper );
 
 #ifdef __cplusplus
@@ -84,7 +84,8 @@ mlt_producer producer_kino_init( mlt_profile profile, mlt_service_type type, con
 static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int index )
 {
 	producer_kino this = producer->child;
-	uint8_t *data = mlt_pool_alloc( FRAME_SIZE_625_50 );
+	kino_mapping mapping = NULL;
+	uint8_t *data = NULL;
 	
 	// Obtain the current frame number
 	uint64_t position = mlt_producer_frame( producer );
@@ -92,8 +93,29 @@ static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int i
 	// Create an empty frame
 	*frame = mlt_frame_init( MLT_PRODUCER_SERVICE( producer ) );
 
-	// Seek and fetch
-	if ( kino_wrapper_get_frame( this->wrapper, data, position ) )
+	// Use the frame in place from the mapped file when possible
+	data = kino_wrapper_map_frame( this->wrapper, position, &mapping );
+	if ( data != NULL )
+	{
+		// The frame keeps the mapping alive for as long as it uses the data
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( *frame ), "_kino_mapping", mapping, 0, ( mlt_destructor )kino_mapping_release, NULL );
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( *frame ), "dv_data", data, ( data[ 3 ] & 0x80 ) ? FRAME_SIZE_625_50 : FRAME_SIZE_525_60, NULL, NULL );
+	}
+	else
+	{
+		data = mlt_pool_alloc( FRAME_SIZE_625_50 );
+		if ( kino_wrapper_get_frame( this->wrapper, data, position ) )
+		{
+			mlt_properties_set_data( MLT_FRAME_PROPERTIES( *frame ), "dv_data", data, FRAME_SIZE_625_50, ( mlt_destructor )mlt_pool_release, NULL );
+		}
+		else
+		{
+			mlt_pool_release( data );
+			data = NULL;
+		}
+	}
+
+	if ( data != NULL )
 	{
 		// Get the frames properties
 		mlt_properties properties = MLT_FRAME_PROPERTIES( *frame );
@@ -101,18 +123,11 @@ static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int i
 		// Determine if we're PAL or NTSC
 		int is_pal = kino_wrapper_is_pal( this->wrapper );
 
-		// Pass the dv data
-		mlt_properties_set_data( properties, "dv_data", data, FRAME_SIZE_625_50, ( mlt_destructor )mlt_pool_release, NULL );
-
 		// Update other info on the frame
 		mlt_properties_set_int( properties, "width", 720 );
 		mlt_properties_set_int( properties, "height", is_pal ? 576 : 480 );
 		mlt_properties_set_int( properties, "top_field_first", is_pal ? 0 : ( data[ 5 ] & 0x07 ) == 0 ? 0 : 1 );
 	}
-	else
-	{
-		mlt_pool_release( data );
-	}
 
 	// Update timecode on the frame we're creating
 	mlt_frame_set_position( *frame, mlt_producer_position( producer ) );
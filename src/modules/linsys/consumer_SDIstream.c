@@ -71,6 +71,8 @@
  * 	'dev_video'
  * 	'dev_audio'
  * 	'blanking'
+ * 'dev_video' may also be a regular file or named pipe, which receives the
+ * generated frames, e.g. to test or benchmark without SDI hardware.
  * Only to monitor the SDI output a beta version of jpeg-writer is implemented.
  * 	'jpeg_files' a number for output interval
  * 	'save_jpegs' path for image
@@ -362,10 +364,10 @@ static void *consumer_thread(void *arg) {
 	int fd = -1;
 	if (this->device_file_video)
 		fd = stat(this->device_file_video, &st);
-	if (fd == -1) {
+	if (fd == -1 && (!this->device_file_video || !strncmp(this->device_file_video, "/dev/", 5))) {
 		free(this->device_file_video);
 		this->device_file_video = strdup("/dev/sdivideotx0");
-	} else {
+	} else if (fd != -1) {
 		close(fd);
 	}
 	if (this->device_file_audio) {
@@ -419,10 +421,11 @@ static void *consumer_thread(void *arg) {
 	this->audio_format.sample_rate = 48000;
 	this->pix_fmt = mlt_image_yuv422;
 
-	if (this->device_file_video && this->device_file_audio &&
+	if (this->device_file_video &&
 		!sdi_init(this->device_file_video, this->device_file_audio, this->blanking, mlt_service_profile((mlt_service) consumer), &this->audio_format)) {
 		mlt_log_fatal( MLT_CONSUMER_SERVICE(consumer), "failed to initialize\n" );
 		mlt_events_fire( MLT_CONSUMER_PROPERTIES(consumer), "consumer-fatal-error", NULL );
+		terminated = 1;
 	}
 
 	uint8_t *video_buffer = NULL;
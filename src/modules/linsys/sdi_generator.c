@@ -235,7 +235,7 @@ static int sdi_init(char *device_video, char *device_audio, uint8_t blanking, ml
 	// Check if the format supports own blanking (note: model 193 supports currently only active video at the video device file)
 	if (info.blanking && info.fmt != &FMT_576i50) {
 		printf("SDI consumer doesn't support blanking(HANC) for the configured SD board and SDI format. Try argument: blanking=false\n");
-		return EXIT_FAILURE;
+		return 0;
 	}
 
 	// if we write our own HANC we need an AES channel status bit array
@@ -394,10 +394,10 @@ static int sdi_init(char *device_video, char *device_audio, uint8_t blanking, ml
 		}
 
 		// open file handle for SDI(video) output
-		if ((fh_sdi_video = open(device_file_video, O_WRONLY)) == -1) {
+		if ((fh_sdi_video = open_output(device_file_video)) == -1) {
 			perror(NULL);
 			printf("\ncould not open video output destination: %s\n", device_file_video);
-			return EXIT_FAILURE;
+			return 0;
 		}
 		printf("SDI consumer uses video device file: %s\n", device_file_video);
 
@@ -442,10 +442,10 @@ static int sdi_init(char *device_video, char *device_audio, uint8_t blanking, ml
 			}
 
 			// open file handle for audio output
-			if ((fh_sdi_audio = open(device_file_audio, O_WRONLY)) == -1) {
+			if ((fh_sdi_audio = open_output(device_file_audio)) == -1) {
 				perror(NULL);
 				printf("\nCould not open audio output destination: %s\n", device_file_audio);
-				return EXIT_FAILURE;
+				return 0;
 			}
 			printf("SDI consumer uses audio device file: %s\n", device_file_audio);
 		}
@@ -654,11 +654,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 					elements = info.fmt->active_samples_per_line;
 				}
 				info.xyz = &FIELD_1_ACTIVE;
-				for (info.ln = 21; info.ln <= 560; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-					active_video_line += 2;
-				}
+				p = create_active_lines(p, 21, 560, active_video_line, 2, vBuffer);
+				active_video_line += 2 * (560 - 21 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_1_VERT_BLANKING;
 					for (info.ln = 561; info.ln <= 563; info.ln++) {
@@ -675,11 +672,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 				active_video_line = 2;
 
 				info.xyz = &FIELD_2_ACTIVE;
-				for (info.ln = 584; info.ln <= 1123; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-					active_video_line += 2;
-				}
+				p = create_active_lines(p, 584, 1123, active_video_line, 2, vBuffer);
+				active_video_line += 2 * (1123 - 584 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_2_VERT_BLANKING;
 					for (info.ln = 1124; info.ln <= 1125; info.ln++) {
@@ -705,11 +699,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 					}
 				}
 				info.xyz = &FIELD_1_ACTIVE;
-				for (info.ln = 23; info.ln <= 310; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-					active_video_line += 2;
-				}
+				p = create_active_lines(p, 23, 310, active_video_line, 2, vBuffer);
+				active_video_line += 2 * (310 - 23 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_1_VERT_BLANKING;
 					for (info.ln = 311; info.ln <= 312; info.ln++) {
@@ -727,11 +718,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 				active_video_line = 2;
 
 				info.xyz = &FIELD_2_ACTIVE;
-				for (info.ln = 336; info.ln <= 623; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-					active_video_line += 2;
-				}
+				p = create_active_lines(p, 336, 623, active_video_line, 2, vBuffer);
+				active_video_line += 2 * (623 - 336 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_2_VERT_BLANKING;
 					for (info.ln = 624; info.ln <= 625; info.ln++) {
@@ -786,18 +774,12 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 						p = pack(p, line_buffer, elements);
 					}
 					// 240 lines
-					for (info.ln = 20; info.ln <= 259; info.ln++) {
-						create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-						p = pack(p, line_buffer, elements);
-						active_video_line += 2;
-					}
+					p = create_active_lines(p, 20, 259, active_video_line, 2, vBuffer);
+					active_video_line += 2 * (259 - 20 + 1);
 				} else {
 					// 243 lines
-					for (info.ln = 17; info.ln <= 259; info.ln++) {
-						create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-						p = pack(p, line_buffer, elements);
-						active_video_line += 2;
-					}
+					p = create_active_lines(p, 17, 259, active_video_line, 2, vBuffer);
+					active_video_line += 2 * (259 - 17 + 1);
 				}
 				if (info.blanking) {
 					// 2 lines vertical data
@@ -831,18 +813,12 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 						p = pack(p, line_buffer, elements);
 					}
 					// 240 lines
-					for (info.ln = 282; info.ln <= 521; info.ln++) {
-						create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-						p = pack(p, line_buffer, elements);
-						active_video_line += 2;
-					}
+					p = create_active_lines(p, 282, 521, active_video_line, 2, vBuffer);
+					active_video_line += 2 * (521 - 282 + 1);
 				} else {
 					// 243 lines
-					for (info.ln = 279; info.ln <= 521; info.ln++) {
-						create_HD_SDI_Line(line_buffer, &info, active_video_line, ACTIVE_VIDEO, vBuffer);
-						p = pack(p, line_buffer, elements);
-						active_video_line += 2;
-					}
+					p = create_active_lines(p, 279, 521, active_video_line, 2, vBuffer);
+					active_video_line += 2 * (521 - 279 + 1);
 				}
 				// 4 lines vertical data
 				if (info.blanking) {
@@ -874,10 +850,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 					elements = info.fmt->active_samples_per_line;
 				}
 				info.xyz = &FIELD_1_ACTIVE;
-				for (info.ln = 42; info.ln <= 1121; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line++, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-				}
+				p = create_active_lines(p, 42, 1121, active_video_line, 1, vBuffer);
+				active_video_line += 1 * (1121 - 42 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_1_VERT_BLANKING;
 					for (info.ln = 1122; info.ln <= 1125; info.ln++) {
@@ -897,10 +871,8 @@ static int sdi_playout(uint8_t *vBuffer, int16_t aBuffer[MAX_AUDIO_STREAMS][MAX_
 					elements = info.fmt->active_samples_per_line;
 				}
 				info.xyz = &FIELD_1_ACTIVE;
-				for (info.ln = 26; info.ln <= 745; info.ln++) {
-					create_HD_SDI_Line(line_buffer, &info, active_video_line++, ACTIVE_VIDEO, vBuffer);
-					p = pack(p, line_buffer, elements);
-				}
+				p = create_active_lines(p, 26, 745, active_video_line, 1, vBuffer);
+				active_video_line += 1 * (745 - 26 + 1);
 				if (info.blanking) {
 					info.xyz = &FIELD_1_VERT_BLANKING;
 					for (info.ln = 746; info.ln <= 750; info.ln++) {
@@ -1351,37 +1323,8 @@ static inline int create_HD_SDI_Line(uint16_t *buf, const struct line_info *info
 
 	{
 
-		while (p < (buf + samples)) {
-
-			*p = video_buffer[start_of_current_line + (p - buf) + 1] << 2; // Cb
-			p++;
-			//check values, this needs a lot of resources
-			//			if (*(p - 1) < 0x040)
-			//				*(p - 1) = 0x040;
-			//			if (*(p - 1) > 0x3c0)
-			//				*(p - 1) = 0x3c0;
-			//
-			*p = video_buffer[start_of_current_line + (p - buf) - 1] << 2; // Y1
-			p++;
-			//			if (*(p - 1) < 0x040)
-			//				*(p - 1) = 0x040;
-			//			if (*(p - 1) > 0x3ac)
-			//				*(p - 1) = 0x3ac;
-			//
-			*p = video_buffer[start_of_current_line + (p - buf) + 1] << 2; // Cr
-			p++;
-			//			if (*(p - 1) < 0x040)
-			//				*(p - 1) = 0x040;
-			//			if (*(p - 1) > 0x3c0)
-			//				*(p - 1) = 0x3c0;
-			//
-			*p = video_buffer[start_of_current_line + (p - buf) - 1] << 2; // Y2
-			p++;
-			//			if (*(p - 1) < 0x040)
-			//				*(p - 1) = 0x040;
-			//			if (*(p - 1) > 0x3ac)
-			//				*(p - 1) = 0x3ac;
-		}
+		// Cb Y1 Cr Y2 words from Y1 Cb Y2 Cr bytes
+		yuyv_to_sdi_words(p, video_buffer + start_of_current_line + (p - buf), buf + samples - p);
 	}
 		break;
 	}
@@ -1574,6 +1517,17 @@ static uint16_t checker(uint16_t *DID_pointer) {
  * @param ch: channel od AES subframe (value:0,1,2,3)
  * @param *audio_samplex: pointer to the audio buffer
  **/
+/**
+ * parity - odd parity of a 16-bit word (1 when the number of set bits is odd)
+ **/
+static inline int8_t parity(uint16_t x) {
+	x ^= x >> 8;
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+	return x & 1;
+}
+
 static int pack_AES_subframe(uint16_t *p, int8_t c, int8_t z, int8_t ch, int16_t *audio_samplex) {
 
 	/**
@@ -1604,11 +1558,7 @@ static int pack_AES_subframe(uint16_t *p, int8_t c, int8_t z, int8_t ch, int16_t
 	*p++ = buffer;
 
 	// count ones
-	int i = 0;
-	for (i = 0; i < 9; i++) {
-		if (buffer & 1 << i)
-			parity_counter++;
-	}
+	parity_counter ^= parity(buffer & 0x1ff);
 
 	//#########################################################
 	//### WORD X+1 ############################################
@@ -1623,11 +1573,7 @@ static int pack_AES_subframe(uint16_t *p, int8_t c, int8_t z, int8_t ch, int16_t
 	*p++ = buffer;
 
 	// count ones (zähle Einsen)
-	i = 0;
-	for (i = 0; i < 9; i++) {
-		if (buffer & 1 << i)
-			parity_counter++;
-	}
+	parity_counter ^= parity(buffer & 0x1ff);
 
 	//#########################################################
 	//### WORD X+2 ############################################
@@ -1643,10 +1589,7 @@ static int pack_AES_subframe(uint16_t *p, int8_t c, int8_t z, int8_t ch, int16_t
 	buffer += c << 7; // C (AES audio channel status bit)
 
 	// count ones (zähle Einsen)
-	for (i = 0; i < 8; i++) {
-		if (buffer & 1 << i)
-			parity_counter++;
-	}
+	parity_counter ^= parity(buffer & 0xff);
 
 	//	if (!parity_counter%2) //else leave the 0
 	//		buffer+= 1 << 8; // P (AES even parity bit)
@@ -1804,6 +1747,15 @@ pack8(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
 	uint16_t *inp = inbuf;
 	uint8_t *outp = outbuf;
 
+#if defined(USE_SSE2)
+	while (inp + 16 <= inbuf + count) {
+		__m128i a = _mm_srli_epi16(_mm_loadu_si128((__m128i *) inp), 2);
+		__m128i b = _mm_srli_epi16(_mm_loadu_si128((__m128i *) (inp + 8)), 2);
+		_mm_storeu_si128((__m128i *) outp, _mm_packus_epi16(a, b));
+		inp += 16;
+		outp += 16;
+	}
+#endif
 	while (inp < (inbuf + count)) {
 		*outp++ = *inp++ >> 2;
 	}
@@ -1816,6 +1768,8 @@ pack8(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
  * @inbuf: pointer to the input buffer
  * @count: number of elements in the buffer
  *
+ * Four 10-bit words are combined into one 40-bit group and stored as five bytes.
+ *
  * Returns a pointer to the next output location.
  **/
 static inline uint8_t * pack10(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
@@ -1824,14 +1778,15 @@ static inline uint8_t * pack10(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
 	uint8_t *outp = outbuf;
 
 	while (inp < (inbuf + count)) {
-		*outp++ = *inp & 0xff;
-		*outp = *inp++ >> 8;
-		*outp++ += (*inp << 2) & 0xfc;
-		*outp = *inp++ >> 6;
-		*outp++ += (*inp << 4) & 0xf0;
-		*outp = *inp++ >> 4;
-		*outp++ += (*inp << 6) & 0xc0;
-		*outp++ = *inp++ >> 2;
+		uint64_t group = (uint64_t) (inp[0] & 0x3ff) | (uint64_t) (inp[1] & 0x3ff) << 10
+				| (uint64_t) (inp[2] & 0x3ff) << 20 | (uint64_t) (inp[3] & 0x3ff) << 30;
+		outp[0] = group;
+		outp[1] = group >> 8;
+		outp[2] = group >> 16;
+		outp[3] = group >> 24;
+		outp[4] = group >> 32;
+		inp += 4;
+		outp += 5;
 	}
 
 	return outp;
@@ -1842,6 +1797,8 @@ static inline uint8_t * pack10(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
  * @inbuf: pointer to the input buffer
  * @count: number of elements in the buffer
  *
+ * Three 10-bit words are stored in each little-endian 32-bit word.
+ *
  * Returns a pointer to the next output location.
  **/
 static inline uint8_t * pack_v210(uint8_t *outbuf, uint16_t *inbuf, size_t count) {
@@ -1851,16 +1808,120 @@ static inline uint8_t * pack_v210(uint8_t *outbuf, uint16_t *inbuf, size_t count
 
 	count = (count / 96) * 96 + ((count % 96) ? 96 : 0);
 	while (inp < (inbuf + count)) {
-		*outp++ = *inp & 0xff;
-		*outp = *inp++ >> 8;
-		*outp++ += (*inp << 2) & 0xfc;
-		*outp = *inp++ >> 6;
-		*outp++ += (*inp << 4) & 0xf0;
-		*outp++ = *inp++ >> 4;
+		uint32_t word = (uint32_t) (inp[0] & 0x3ff) | (uint32_t) (inp[1] & 0x3ff) << 10 | (uint32_t) (inp[2] & 0x3ff) << 20;
+		outp[0] = word;
+		outp[1] = word >> 8;
+		outp[2] = word >> 16;
+		outp[3] = word >> 24;
+		inp += 3;
+		outp += 4;
 	}
 	return outp;
 }
 
+/**
+ * packed_size - number of bytes the current pack function writes for a line
+ * @count: number of elements in the line
+ **/
+static size_t packed_size(size_t count) {
+	if (pack == pack10)
+		return count / 4 * 5;
+	if (pack == pack_v210)
+		return ((count / 96) * 96 + ((count % 96) ? 96 : 0)) / 3 * 4;
+	return count;
+}
+
+/**
+ * yuyv_to_sdi_words - convert packed yuv422 bytes to 10-bit SDI words
+ * @outbuf: Cb Y1 Cr Y2 ordered 10-bit words
+ * @inbuf: Y1 Cb Y2 Cr ordered 8-bit samples
+ * @count: number of words to write
+ **/
+static inline void yuyv_to_sdi_words(uint16_t *outbuf, const uint8_t *inbuf, size_t count) {
+	size_t i = 0;
+
+#if defined(USE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i in = _mm_loadu_si128((const __m128i *) (inbuf + i));
+		__m128i lo = _mm_unpacklo_epi8(in, zero);
+		__m128i hi = _mm_unpackhi_epi8(in, zero);
+		// swap luma and chroma within each pair
+		lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xb1), 0xb1);
+		hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xb1), 0xb1);
+		_mm_storeu_si128((__m128i *) (outbuf + i), _mm_slli_epi16(lo, 2));
+		_mm_storeu_si128((__m128i *) (outbuf + i + 8), _mm_slli_epi16(hi, 2));
+	}
+#endif
+	for (; i + 1 < count; i += 2) {
+		outbuf[i] = inbuf[i + 1] << 2;
+		outbuf[i + 1] = inbuf[i] << 2;
+	}
+}
+
+struct active_lines_desc {
+	struct line_info info;
+	uint8_t *p;
+	unsigned int first_ln;
+	unsigned int lines;
+	uint16_t first_active_video_line;
+	int active_video_step;
+	uint8_t *video_buffer;
+	size_t line_size;
+};
+
+static int create_active_lines_proc(int id, int idx, int jobs, void *cookie) {
+	struct active_lines_desc *desc = cookie;
+	struct line_info line_info = desc->info;
+	// pack_v210 reads whole groups of 96 samples, so the tail past the line must be zero
+	uint16_t buf[(MAX_SAMPLES_PER_LINE + 95) / 96 * 96];
+	unsigned int lines = (desc->lines + jobs - 1) / jobs;
+	unsigned int start = lines * idx;
+	unsigned int end = MIN(start + lines, desc->lines);
+	unsigned int i;
+
+	memset(buf, 0, sizeof(buf));
+	for (i = start; i < end; i++) {
+		line_info.ln = desc->first_ln + i;
+		create_HD_SDI_Line(buf, &line_info, desc->first_active_video_line + i * desc->active_video_step, ACTIVE_VIDEO,
+				desc->video_buffer);
+		pack(desc->p + i * desc->line_size, buf, elements);
+	}
+	return 0;
+}
+
+/**
+ * create_active_lines - generate and pack a run of active video lines
+ * @p: output location of the first line
+ * @first_ln, @last_ln: SDI line numbers of the run
+ * @first_active_video_line: source image line of the first SDI line
+ * @active_video_step: 2 for a field of an interlaced frame, 1 otherwise
+ * @video_buffer: yuv422 image
+ *
+ * Every line only depends on its source line, so the run is split across the
+ * shared slice threads.
+ *
+ * Returns a pointer to the next output location.
+ **/
+static uint8_t *create_active_lines(uint8_t *p, unsigned int first_ln, unsigned int last_ln, uint16_t first_active_video_line,
+		int active_video_step, uint8_t *video_buffer) {
+	struct active_lines_desc desc = {
+		.info = info,
+		.p = p,
+		.first_ln = first_ln,
+		.lines = last_ln - first_ln + 1,
+		.first_active_video_line = first_active_video_line,
+		.active_video_step = active_video_step,
+		.video_buffer = video_buffer,
+		.line_size = packed_size(elements),
+	};
+
+	mlt_slices_run_normal(0, create_active_lines_proc, &desc);
+	info.ln = last_ln + 1;
+
+	return p + desc.lines * desc.line_size;
+}
+
 // Clean up
 static int sdimaster_close() {
 
@@ -2399,6 +2460,21 @@ static ssize_t util_write(const char *name, const char *buf, size_t count) {
 	return ret;
 }
 
+/**
+ * open_output - open a device file, regular file or pipe for writing
+ * @path: output path
+ *
+ * Regular files are created or truncated so that a frame dump can be made
+ * without SDI hardware.
+ **/
+static int open_output(const char *path) {
+	struct stat st;
+
+	if (stat(path, &st) == -1 || S_ISREG(st.st_mode))
+		return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	return open(path, O_WRONLY);
+}
+
 static char * itoa(uint64_t i) {
 
 	if (i == 0)
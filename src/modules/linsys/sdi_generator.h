@@ -4,6 +4,7 @@
 
 #include <framework/mlt_frame.h>
 #include <framework/mlt_profile.h>
+#include <framework/mlt_slices.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -20,6 +21,10 @@
 #include <signal.h>
 #include <math.h>
 
+#if defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+
 #ifndef SDI_GENERATOR_H_
 #define SDI_GENERATOR_H_
 
@@ -313,7 +318,12 @@ static uint8_t getDBN(int my_DBN);
 static inline uint8_t *pack8(uint8_t *outbuf, uint16_t *inbuf, size_t count); // alias 'pack_uyvy()'
 static inline uint8_t *pack10(uint8_t *outbuf, uint16_t *inbuf, size_t count);
 static inline uint8_t *pack_v210(uint8_t *outbuf, uint16_t *inbuf, size_t count);
+static inline void yuyv_to_sdi_words(uint16_t *outbuf, const uint8_t *inbuf, size_t count);
 
 static int pack_AES_subframe(uint16_t *p, int8_t c, int8_t z, int8_t ch, int16_t *audio_sample);
 
+static uint8_t *create_active_lines(uint8_t *p, unsigned int first_ln, unsigned int last_ln, uint16_t first_active_video_line,
+		int active_video_step, uint8_t *video_buffer);
+static int open_output(const char *path);
+
 #endif /* SDI_GENERATOR_H_ */
@@ -26,124 +26,337 @@
 #include <string.h>
 #include <sys/time.h>
 #include <assert.h>
-#define SHIFT 8
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
 #define ABS(a) ((a) >= 0 ? (a) : (-(a)))
 
-// This is used to constrains pixel operations between two blocks to be within the image boundry
-inline static int constrain(	int *x, int *y, int *w,	int *h,			
-				const int dx, const int dy,
-				const int left, const int right,
-				const int top, const int bottom)
+/** The luma difference above which the two warped samples are treated as an occlusion. */
+#define OCCLUSION_SHIFT 5
+#define OCCLUSION_THRESHOLD ( 1 << OCCLUSION_SHIFT )
+
+typedef struct
 {
-	uint32_t penalty = 1 << SHIFT;			// Retain a few extra bits of precision
-	int x2 = *x + dx;
-	int y2 = *y + dy;
-	int w_remains = *w;
-	int h_remains = *h;
-
-	// Origin of macroblock moves left of image boundy
-	if( *x < left || x2 < left ) {
-		w_remains = *w - left + ((*x < x2) ?  *x : x2);
-		*x += *w - w_remains;
+	uint8_t *first_image;
+	uint8_t *second_image;
+	uint8_t *output;
+	int width, height;
+	int mb_w, mb_h;
+	int top_mb, bottom_mb, left_mb, right_mb;
+	int scale;		// position between the frames in 1/256
+	motion_vector *vectors;
+} interpolate_desc;
+
+/** Interpolate between four samples with 8 bit fractions.
+ *
+ * The horizontal result is kept to 15 bits so that the SSE2 code can do the
+ * vertical step with signed 16 bit multiplies and give the same values.
+ */
+
+static inline int bilinear( int p00, int p01, int p10, int p11, int fx, int fy )
+{
+	int top = ( p00 * ( 256 - fx ) + p01 * fx + 1 ) >> 1;
+	int bottom = ( p10 * ( 256 - fx ) + p11 * fx + 1 ) >> 1;
+	return ( top * ( 256 - fy ) + bottom * fy + 16384 ) >> 15;
+}
+
+/** Bilinearly sample a row of yuv422 pixels from an image.
+ *
+ * The offsets are in 1/256 pixel, the pixels outside the image repeat the edge.
+ */
+
+static void sample_row( const uint8_t *image, int width, int height, int x, int y, int count, int ox, int oy, uint8_t *out )
+{
+	int pairs = width / 2;
+	int sy = y * 256 + oy;
+	int fy = sy & 255;
+	int y0 = CLAMP( sy >> 8, 0, height - 1 );
+	int y1 = CLAMP( ( sy >> 8 ) + 1, 0, height - 1 );
+	const uint8_t *row0 = image + y0 * width * 2;
+	const uint8_t *row1 = image + y1 * width * 2;
+	int fx = ox & 255;
+	int dx = ox >> 8;
+	int cx = ( ox >> 1 ) & 255;
+	int cdx = ( ox >> 1 ) >> 8;
+	int i;
+
+	for ( i = 0; i < count; i ++, out += 2 )
+	{
+		int x0 = CLAMP( x + i + dx, 0, width - 1 ) * 2;
+		int x1 = CLAMP( x + i + dx + 1, 0, width - 1 ) * 2;
+		int k0 = CLAMP( ( x + i ) / 2 + cdx, 0, pairs - 1 ) * 4 + 1 + ( ( x + i ) & 1 ) * 2;
+		int k1 = CLAMP( ( x + i ) / 2 + cdx + 1, 0, pairs - 1 ) * 4 + 1 + ( ( x + i ) & 1 ) * 2;
+		out[ 0 ] = bilinear( row0[ x0 ], row0[ x1 ], row1[ x0 ], row1[ x1 ], fx, fy );
+		out[ 1 ] = bilinear( row0[ k0 ], row0[ k1 ], row1[ k0 ], row1[ k1 ], cx, fy );
+	}
+}
+
+/** Blend the samples taken from the two images into an output row. */
+
+static inline void blend_row( const uint8_t *first, const uint8_t *second, uint8_t *out, int count, int a )
+{
+	int near = a < 128 ? 0 : 256;
+	int k = 0;
+
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i full = _mm_set1_epi16( 256 );
+	__m128i scale = _mm_set1_epi16( a );
+	__m128i toward = _mm_set1_epi16( near - a );
+	__m128i threshold = _mm_set1_epi16( OCCLUSION_THRESHOLD );
+	__m128i round = _mm_set1_epi16( 128 );
+
+	for ( ; k + 16 <= count * 2; k += 16 )
+	{
+		__m128i f8 = _mm_loadu_si128( (const __m128i*)( first + k ) );
+		__m128i s8 = _mm_loadu_si128( (const __m128i*)( second + k ) );
+		__m128i result[ 2 ];
+		int half;
+
+		for ( half = 0; half < 2; half ++ )
+		{
+			__m128i f = half ? _mm_unpackhi_epi8( f8, zero ) : _mm_unpacklo_epi8( f8, zero );
+			__m128i s = half ? _mm_unpackhi_epi8( s8, zero ) : _mm_unpacklo_epi8( s8, zero );
+			__m128i diff = _mm_or_si128( _mm_subs_epu16( f, s ), _mm_subs_epu16( s, f ) );
+			__m128i ramp = _mm_min_epi16( _mm_subs_epu16( diff, threshold ), threshold );
+			__m128i weight = _mm_add_epi16( scale, _mm_srai_epi16( _mm_mullo_epi16( toward, ramp ), OCCLUSION_SHIFT ) );
+
+			// The chroma of each pixel follows the weight of its luma
+			weight = _mm_shufflelo_epi16( weight, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+			weight = _mm_shufflehi_epi16( weight, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+			result[ half ] = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( f, _mm_sub_epi16( full, weight ) ),
+				_mm_mullo_epi16( s, weight ) ), round ), 8 );
+		}
+		_mm_storeu_si128( (__m128i*)( out + k ), _mm_packus_epi16( result[ 0 ], result[ 1 ] ) );
+	}
+#endif
+
+	for ( ; k < count * 2; k += 2 )
+	{
+		int f = first[ k ];
+		int s = second[ k ];
+		int ramp = MIN( MAX( ABS( f - s ) - OCCLUSION_THRESHOLD, 0 ), OCCLUSION_THRESHOLD );
+		int weight = a + ( ( near - a ) * ramp >> OCCLUSION_SHIFT );
+
+		out[ k ] = ( f * ( 256 - weight ) + s * weight + 128 ) >> 8;
+		out[ k + 1 ] = ( first[ k + 1 ] * ( 256 - weight ) + second[ k + 1 ] * weight + 128 ) >> 8;
 	}
-	// Portion of macroblock moves right of image boundry
-	else if( *x + *w > right || x2 + *w > right )
-		w_remains = right - ((*x > x2) ? *x : x2);
-
-	// Origin of macroblock moves above image boundy
-	if( *y < top || y2 < top ) {
-		h_remains = *h - top + ((*y < y2) ? *y : y2);
-		*y += *h - h_remains;
+}
+
+/** Sample a row of pixels that is known to lie inside the image.
+ *
+ * In yuv422 the luma of a pixel is shifted by two bytes per pixel and its
+ * chroma by four bytes per pair, so with the fractions fixed for the block
+ * this is a plain bilinear filter over the bytes of the row.
+ */
+
+static inline void sample_row_inside( const uint8_t *row0, const uint8_t *row1, int count, int ox, int fy, uint8_t *out )
+{
+	int fx = ox & 255;
+	int cx = ( ox >> 1 ) & 255;
+	const uint8_t *l0 = row0 + ( ox >> 8 ) * 2;
+	const uint8_t *l1 = row1 + ( ox >> 8 ) * 2;
+	const uint8_t *c0 = row0 + ( ox >> 9 ) * 4;
+	const uint8_t *c1 = row1 + ( ox >> 9 ) * 4;
+	int k = 0;
+
+#ifdef USE_SSE2
+	// Even bytes are luma and odd bytes chroma, each with their own taps and fractions
+	__m128i zero = _mm_setzero_si128();
+	__m128i luma = _mm_set1_epi16( 0x00ff );
+	__m128i near = _mm_set_epi16( 256 - cx, 256 - fx, 256 - cx, 256 - fx, 256 - cx, 256 - fx, 256 - cx, 256 - fx );
+	__m128i far = _mm_set_epi16( cx, fx, cx, fx, cx, fx, cx, fx );
+	__m128i vertical = _mm_set_epi16( fy, 256 - fy, fy, 256 - fy, fy, 256 - fy, fy, 256 - fy );
+	__m128i one = _mm_set1_epi16( 1 );
+	__m128i round = _mm_set1_epi32( 16384 );
+
+	for ( ; k + 16 <= count * 2; k += 16 )
+	{
+		__m128i rows[ 2 ][ 2 ];
+		__m128i result[ 2 ];
+		int row, half;
+
+		for ( row = 0; row < 2; row ++ )
+		{
+			const uint8_t *l = row ? l1 : l0;
+			const uint8_t *c = row ? c1 : c0;
+			__m128i a = _mm_or_si128( _mm_and_si128( luma, _mm_loadu_si128( (const __m128i*)( l + k ) ) ),
+				_mm_andnot_si128( luma, _mm_loadu_si128( (const __m128i*)( c + k ) ) ) );
+			__m128i b = _mm_or_si128( _mm_and_si128( luma, _mm_loadu_si128( (const __m128i*)( l + k + 2 ) ) ),
+				_mm_andnot_si128( luma, _mm_loadu_si128( (const __m128i*)( c + k + 4 ) ) ) );
+			for ( half = 0; half < 2; half ++ )
+			{
+				__m128i a16 = half ? _mm_unpackhi_epi8( a, zero ) : _mm_unpacklo_epi8( a, zero );
+				__m128i b16 = half ? _mm_unpackhi_epi8( b, zero ) : _mm_unpacklo_epi8( b, zero );
+				__m128i sum = _mm_add_epi16( _mm_mullo_epi16( a16, near ), _mm_mullo_epi16( b16, far ) );
+				rows[ row ][ half ] = _mm_srli_epi16( _mm_add_epi16( sum, one ), 1 );
+			}
+		}
+		for ( half = 0; half < 2; half ++ )
+		{
+			__m128i lo = _mm_madd_epi16( _mm_unpacklo_epi16( rows[ 0 ][ half ], rows[ 1 ][ half ] ), vertical );
+			__m128i hi = _mm_madd_epi16( _mm_unpackhi_epi16( rows[ 0 ][ half ], rows[ 1 ][ half ] ), vertical );
+			lo = _mm_srai_epi32( _mm_add_epi32( lo, round ), 15 );
+			hi = _mm_srai_epi32( _mm_add_epi32( hi, round ), 15 );
+			result[ half ] = _mm_packs_epi32( lo, hi );
+		}
+		_mm_storeu_si128( (__m128i*)( out + k ), _mm_packus_epi16( result[ 0 ], result[ 1 ] ) );
 	}
-	// Portion of macroblock moves bellow image boundry
-	else if( *y + *h > bottom || y2 + *h > bottom )
-		h_remains = bottom - ((*y > y2) ?  *y : y2);
+#endif
 
-	if( w_remains == *w && h_remains == *h ) return penalty; 
-	if( w_remains <= 0 || h_remains <= 0) return 0;	// Block is clipped out of existance
-	penalty = (*w * *h * penalty)
-		/ ( w_remains * h_remains);		// Recipricol of the fraction of the block that remains
+	for ( ; k < count * 2; k += 2 )
+	{
+		out[ k ] = bilinear( l0[ k ], l0[ k + 2 ], l1[ k ], l1[ k + 2 ], fx, fy );
+		out[ k + 1 ] = bilinear( c0[ k + 1 ], c0[ k + 5 ], c1[ k + 1 ], c1[ k + 5 ], cx, fy );
+	}
+}
 
-	*w = w_remains;					// Update the width and height
-	*h = h_remains;
+/** Check that sampling the block at an offset stays inside the image. */
 
-	return penalty;
+static inline int block_inside( int x, int count, int width, int ox )
+{
+	return x + ( ox >> 8 ) >= 0 && x + count + ( ox >> 8 ) < width &&
+		x / 2 + ( ox >> 9 ) >= 0 && ( x + count - 1 ) / 2 + ( ox >> 9 ) + 1 < width / 2;
+}
+
+/** Interpolate one macroblock of the output image.
+ *
+ * Each output pixel takes the vector of the block it falls in and samples the
+ * first image forwards and the second image backwards along it. Where the two
+ * samples disagree the block is occluded in one of the frames, so the result
+ * leans towards the nearer frame instead of ghosting.
+ */
+
+static void interpolate_block( interpolate_desc *desc, int i, int j, uint8_t *first_row, uint8_t *second_row )
+{
+	int width = desc->width;
+	int height = desc->height;
+	int x = i * desc->mb_w;
+	int y = j * desc->mb_h;
+	int w = MIN( desc->mb_w, width - x );
+	int h = MIN( desc->mb_h, height - y );
+	int mv_width = width / desc->mb_w;
+	int mv_height = height / desc->mb_h;
+	int vi = MIN( i, mv_width - 1 );
+	int vj = MIN( j, mv_height - 1 );
+	int a = desc->scale;
+	int dx = 0, dy = 0;
+	int fox, foy, sox, soy;
+	int inside;
+	int ty;
+
+	if ( desc->vectors && vi >= desc->left_mb && vi <= desc->right_mb && vj >= desc->top_mb && vj <= desc->bottom_mb )
+	{
+		motion_vector *here = desc->vectors + vj * mv_width + vi;
+		dx = here->dx;
+		dy = here->dy;
+	}
+
+	// Offsets in 1/256 pixel into the first and second images
+	fox = a * dx;
+	foy = a * dy;
+	sox = ( a - 256 ) * dx;
+	soy = ( a - 256 ) * dy;
+	inside = block_inside( x, w, width, fox ) && block_inside( x, w, width, sox );
+
+	for ( ty = y; ty < y + h; ty ++ )
+	{
+		uint8_t *r = desc->output + ( ty * width + x ) * 2;
+
+		if ( inside )
+		{
+			int fy = ty * 256 + foy;
+			int sy = ty * 256 + soy;
+			int stride = width * 2;
+			const uint8_t *first = desc->first_image + x * 2;
+			const uint8_t *second = desc->second_image + x * 2;
+
+			sample_row_inside( first + CLAMP( fy >> 8, 0, height - 1 ) * stride, first + CLAMP( ( fy >> 8 ) + 1, 0, height - 1 ) * stride,
+				w, fox, fy & 255, first_row );
+			sample_row_inside( second + CLAMP( sy >> 8, 0, height - 1 ) * stride, second + CLAMP( ( sy >> 8 ) + 1, 0, height - 1 ) * stride,
+				w, sox, sy & 255, second_row );
+		}
+		else
+		{
+			sample_row( desc->first_image, width, height, x, ty, w, fox, foy, first_row );
+			sample_row( desc->second_image, width, height, x, ty, w, sox, soy, second_row );
+		}
+		blend_row( first_row, second_row, r, w, a );
+	}
+}
+
+static int interpolate_slice( int id, int idx, int jobs, void *cookie )
+{
+	interpolate_desc *desc = cookie;
+	int rows = ( desc->height + desc->mb_h - 1 ) / desc->mb_h;
+	int columns = ( desc->width + desc->mb_w - 1 ) / desc->mb_w;
+	int size = ( rows + jobs - 1 ) / jobs;
+	int start = idx * size;
+	int end = MIN( start + size, rows );
+	uint8_t *first_row = malloc( desc->mb_w * 2 );
+	uint8_t *second_row = malloc( desc->mb_w * 2 );
+	int i, j;
+
+	for ( j = start; j < end; j ++ )
+		for ( i = 0; i < columns; i ++ )
+			interpolate_block( desc, i, j, first_row, second_row );
+
+	free( first_row );
+	free( second_row );
+	return 0;
 }
 
 static void motion_interpolate( uint8_t *first_image, uint8_t *second_image, uint8_t *output,
 				int top_mb, int bottom_mb, int left_mb, int right_mb,
 				int mb_w, int mb_h,
 				int width, int height,
-				int xstride, int ystride,
 				double scale,
 				motion_vector *vectors )
 {
 	assert ( scale >= 0.0 && scale <= 1.0 ); 
 
-	int i, j;
-	int x,y,w,h;
-	int dx, dy;
-	int scaled_dx, scaled_dy;
-	int tx,ty;
-	uint8_t *f,*s,*r;
-	motion_vector *here;
-	int mv_width = width / mb_w;
-
-	for( j = top_mb; j <= bottom_mb; j++ ){  
-	 for( i = left_mb; i <= right_mb; i++ ){
-
-		here = vectors + j*mv_width + i; 
-		scaled_dx = (1.0 - scale) * (double)here->dx;
-		scaled_dy = (1.0 - scale) * (double)here->dy;
-		dx = here->dx;
-		dy = here->dy;
-		w = mb_w; h = mb_h;
-		x = i * w; y = j * h;
+	interpolate_desc desc = {
+		first_image, second_image, output,
+		width, height,
+		mb_w, mb_h,
+		top_mb, bottom_mb, left_mb, right_mb,
+		lrint( scale * 256.0 ),
+		vectors
+	};
+	int rows = ( height + mb_h - 1 ) / mb_h;
+
+	if ( mb_w > 0 && mb_h > 0 && width >= 2 && height > 0 )
+		mlt_slices_run_normal( MIN( rows, mlt_slices_count_normal() ), interpolate_slice, &desc );
+}
 
-		// Denoise function caused some blocks to be completely clipped, ignore them	
-		if (constrain( &x, &y, &w, &h, dx, dy, 0, width, 0, height) == 0 )
-			continue;
+/** Make sure the frame has an image and a private copy of its motion vectors.
+ *
+ * The vectors set by motion_est belong to the filter and are overwritten by
+ * the next frame it sees, so they are copied once per source frame.
+ */
 
-		for( ty = y; ty < y + h ; ty++ ){
-		 for( tx = x; tx < x + w ; tx++ ){
+static int slowmotion_fetch_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	int error = 0;
 
-			f = first_image  + (tx + dx     )*xstride + (ty + dy     )*ystride;
-			s = second_image + (tx          )*xstride + (ty	   )*ystride;
-			r = output + (tx+scaled_dx)*xstride + (ty+scaled_dy)*ystride;
-/*
-			if( ABS(f[0] - s[0]) > 3 * here->msad / (mb_w * mb_h * 2) )
+	*image = mlt_properties_get_data( properties, "image", NULL );
+	if ( *image == NULL )
+	{
+		error = mlt_frame_get_image( frame, image, format, width, height, 0 );
+		if ( error == 0 )
+		{
+			int size = 0;
+			motion_vector *vectors = mlt_properties_get_data( properties, "motion_est.vectors", &size );
+			if ( vectors && size > 0 )
 			{
-				r[0] = f[0];
-				r[1] = f[1];
+				motion_vector *copy = mlt_pool_alloc( size );
+				memcpy( copy, vectors, size );
+				mlt_properties_set_data( properties, "slowmotion.vectors", copy, size, mlt_pool_release, NULL );
 			}
-
-			else
-			{
-
-*/
-				r[0] = ( 1.0 - scale ) * (double)f[0] + scale * (double)s[0];
-
-				if( dx % 2 == 0 )
-				{
-					if( scaled_dx % 2 == 0 )
-						r[1] =  ( 1.0 - scale ) * (double)f[1] + scale * (double) s[1];
-					else
-						*(r-1) =  ( 1.0 - scale ) * (double)f[1] + scale * (double) s[1];
-				}
-				else
-				{
-					if( scaled_dx %2 == 0 )
-						// FIXME: may exceed boundies
-						r[1] =  ( 1.0 - scale ) * ( (double)(*(f-1) + (double)f[3]) / 2.0 ) + scale * (double) s[1];
-					else
-						// FIXME: may exceed boundies
-						*(r-1) =  ( 1.0 - scale ) * ( (double)(*(f-1) + (double)f[3]) / 2.0 ) + scale * (double) s[1];
-				}
-//			 }
-		 }
 		}
-	 }
 	}
+	return error;
 }
 
 // Image stack(able) method
@@ -159,50 +372,34 @@ static int slowmotion_get_image( mlt_frame this, uint8_t **image, mlt_image_form
 
 	// Frame properties objects
 	mlt_properties frame_properties = MLT_FRAME_PROPERTIES( this );
-	mlt_properties first_frame_properties = MLT_FRAME_PROPERTIES( first_frame );
 	mlt_properties second_frame_properties = MLT_FRAME_PROPERTIES( second_frame );
 
-	// image stride
 	*format = mlt_image_yuv422;
-	int size = *width * *height * 2;
-	int xstride = 2;
-	int ystride = 2 * *width;
-
-	uint8_t *output = mlt_properties_get_data( producer_properties, "output_buffer", 0 );
-	if( output == NULL )
-	{
-		output = mlt_pool_alloc( size );
-
-		// Let someone else clean up
-		mlt_properties_set_data( producer_properties, "output_buffer", output, size, mlt_pool_release, NULL ); 
-	}
 
-	uint8_t *first_image = mlt_properties_get_data( first_frame_properties, "image", NULL );
-	uint8_t *second_image = mlt_properties_get_data( second_frame_properties, "image", NULL );
+	uint8_t *output = NULL;
+	uint8_t *first_image = NULL;
+	uint8_t *second_image = NULL;
 
 	// which frames are buffered?
 
 	int error = 0;
 
-	if( first_image == NULL )
-	{
-		error = mlt_frame_get_image( first_frame, &first_image, format, width, height, writable );
-
-		if( error != 0 ) {
-			fprintf(stderr, "first_image == NULL get image died\n");
-			return error;
-		}
+	// The source frames are shared by all the frames interpolated between them
+	mlt_service_lock( MLT_PRODUCER_SERVICE( producer ) );
+	error = slowmotion_fetch_image( first_frame, &first_image, format, width, height );
+	if ( error == 0 )
+		error = slowmotion_fetch_image( second_frame, &second_image, format, width, height );
+	mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
+
+	if ( error != 0 ) {
+		fprintf(stderr, "slowmotion get image died\n");
+		mlt_frame_close( first_frame );
+		mlt_frame_close( second_frame );
+		return error;
 	}
 
-	if( second_image == NULL )
-	{
-		error = mlt_frame_get_image( second_frame, &second_image, format, width, height, writable );
-
-		if( error != 0 ) {
-			fprintf(stderr, "second_image == NULL get image died\n");
-			return error;
-		}
-	}
+	int size = *width * *height * 2;
+	output = mlt_pool_alloc( size );
 
 	// These need to passed onto the frame for other
 	mlt_properties_pass_list( frame_properties, second_frame_properties,
@@ -210,10 +407,12 @@ static int slowmotion_get_image( mlt_frame this, uint8_t **image, mlt_image_form
 			motion_est.top_mb, motion_est.bottom_mb, \
 			motion_est.macroblock_width, motion_est.macroblock_height" );
 
-	// Pass the pointer to the vectors without serializing
+	// Pass the pointer to the vectors without serializing, the frame holds the second frame
 	mlt_properties_set_data( frame_properties, "motion_est.vectors", 
-				mlt_properties_get_data( second_frame_properties, "motion_est.vectors", NULL ), 
+				mlt_properties_get_data( second_frame_properties, "slowmotion.vectors", NULL ), 
 				0, NULL, NULL );
+	mlt_properties_inc_ref( second_frame_properties );
+	mlt_properties_set_data( frame_properties, "_slowmotion.second_frame", second_frame, 0, ( mlt_destructor )mlt_frame_close, NULL );
 
 
 	// Start with a base image
@@ -235,9 +434,8 @@ static int slowmotion_get_image( mlt_frame this, uint8_t **image, mlt_image_form
 			mlt_properties_get_int( second_frame_properties, "motion_est.macroblock_width" ),
 			mlt_properties_get_int( second_frame_properties, "motion_est.macroblock_height" ),
 			*width, *height,
-			xstride, ystride,	
 			scale,
-			mlt_properties_get_data( second_frame_properties, "motion_est.vectors", NULL )
+			mlt_properties_get_data( second_frame_properties, "slowmotion.vectors", NULL )
 		);
 
 		if( mlt_properties_get_int( producer_properties, "debug" ) == 1 ) {
@@ -261,7 +459,7 @@ static int slowmotion_get_image( mlt_frame this, uint8_t **image, mlt_image_form
 	}
 
 	*image = output;
-	mlt_frame_set_image( this, output, size, NULL );
+	mlt_frame_set_image( this, output, size, mlt_pool_release );
 
 	// Make sure that no further scaling is done
 	mlt_properties_set( frame_properties, "rescale.interps", "none" );
@@ -308,6 +506,15 @@ static int slowmotion_get_frame( mlt_producer this, mlt_frame_ptr frame, int ind
 			mlt_frame_close( first_frame );
 			first_position = -1;
 			first_frame = NULL;
+
+			// Moving on to the next pair, the second frame is already decoded and estimated
+			if( need_first == second_position )
+			{
+				first_frame = second_frame;
+				first_position = second_position;
+				second_frame = NULL;
+				second_position = -1;
+			}
 		}
 
 		if( need_second != second_position)
@@ -63,37 +63,56 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 
 	int num_channels = *channels;
 	int num_samples = *samples > 200 ? 200 : *samples;
-	int num_oversample = 0;
 	int c, s;
 	char key[ 50 ];
 	int16_t *pcm = (int16_t*) *buffer;
 
-	for ( c = 0; c < *channels; c++ )
+	// Reuse the levels if another filter already measured these samples.
+	// Only the leading samples are measured, so only they are fingerprinted.
+	int size = mlt_audio_format_size( *format, num_samples, num_channels );
+	int levels_size = 0;
+	double *levels = mlt_frame_get_analysis( frame, "audio_level", *buffer, size, &levels_size );
+
+	if ( !levels || levels_size != num_channels * sizeof( *levels ) )
 	{
-		double val = 0;
-		double level = 0.0;
+		int num_oversample = 0;
+
+		levels = mlt_pool_alloc( num_channels * sizeof( *levels ) );
 
-		for ( s = 0; s < num_samples; s++ )
+		for ( c = 0; c < num_channels; c++ )
 		{
-			double sample = fabs( pcm[c + s * num_channels] / 128.0 );
-			val += sample;
-			if ( sample == 128 )
-				num_oversample++;
-			else
-				num_oversample = 0;
-			// 10 samples @max => show max signal
-			if ( num_oversample > 10 )
+			double val = 0;
+			double level = 0.0;
+
+			for ( s = 0; s < num_samples; s++ )
 			{
-				level = 1.0;
-				break;
+				double sample = fabs( pcm[c + s * num_channels] / 128.0 );
+				val += sample;
+				if ( sample == 128 )
+					num_oversample++;
+				else
+					num_oversample = 0;
+				// 10 samples @max => show max signal
+				if ( num_oversample > 10 )
+				{
+					level = 1.0;
+					break;
+				}
+				// if 3 samples over max => 1 peak over 0 db (0 dB = 40.0)
+				if ( num_oversample > 3 )
+					level = 41.0/42.0;
 			}
-			// if 3 samples over max => 1 peak over 0 db (0 dB = 40.0)
-			if ( num_oversample > 3 )
-				level = 41.0/42.0;
+			// max amplitude = 40/42, 3to10  oversamples=41, more then 10 oversamples=42
+			if ( level == 0.0 && num_samples > 0 )
+				level = val / num_samples * 40.0/42.0 / 127.0;
+			levels[ c ] = level;
 		}
-		// max amplitude = 40/42, 3to10  oversamples=41, more then 10 oversamples=42
-		if ( level == 0.0 && num_samples > 0 )
-			level = val / num_samples * 40.0/42.0 / 127.0;
+		mlt_frame_set_analysis( frame, "audio_level", *buffer, size, levels, num_channels * sizeof( *levels ), mlt_pool_release );
+	}
+
+	for ( c = 0; c < num_channels; c++ )
+	{
+		double level = levels[ c ];
 		if ( iec_scale )
 			level = IEC_Scale( AMPTODBFS( level ) );
 		sprintf( key, "meta.media.audio_level.%d", c );
@@ -32,12 +32,6 @@
 /* The following normalise functions come from the normalize utility:
    Copyright (C) 1999--2002 Chris Vaill */
 
-#define samp_width 16
-
-#ifndef ROUND
-# define ROUND(x) floor((x) + 0.5)
-#endif
-
 #define DBFSTOAMP(x) pow(10,(x)/20.0)
 
 /** Return nonzero if the two strings are equal, ignoring case, up to
@@ -102,36 +96,28 @@ static inline double get_smoothed_data( double *buf, int count )
 }
 
 /** Get the max power level (using RMS) and peak level of the audio segment.
- */
-double signal_max_power( int16_t *buffer, int channels, int samples, int16_t *peak )
-{
-	// Determine numeric limits
-	int bytes_per_samp = (samp_width - 1) / 8 + 1;
-	int16_t max = (1 << (bytes_per_samp * 8 - 1)) - 1;
-	int16_t min = -max - 1;
 
+    The buffer holds interleaved float samples in the range -1.0 -- 1.0.
+*/
+static double signal_max_power( float *buffer, int channels, int samples, float *peak )
+{
 	double *sums = (double *) calloc( channels, sizeof(double) );
-	int c, i;
-	int16_t sample;
 	double pow, maxpow = 0;
+	float max_sample = 0;
+	int c, i;
 
-	/* initialize peaks to effectively -inf and +inf */
-	int16_t max_sample = min;
-	int16_t min_sample = max;
-  
 	for ( i = 0; i < samples; i++ )
 	{
 		for ( c = 0; c < channels; c++ )
 		{
-			sample = *buffer++;
-			sums[ c ] += (double) sample * (double) sample;
-			
+			float sample = buffer[ c ];
+			sums[ c ] += sample * sample;
+
 			/* track peak */
-			if ( sample > max_sample )
-				max_sample = sample;
-			else if ( sample < min_sample )
-				min_sample = sample;
+			if ( fabsf( sample ) > max_sample )
+				max_sample = fabsf( sample );
 		}
+		buffer += channels;
 	}
 	for ( c = 0; c < channels; c++ )
 	{
@@ -139,20 +125,46 @@ double signal_max_power( int16_t *buffer, int channels, int samples, int16_t *pe
 		if ( pow > maxpow )
 			maxpow = pow;
 	}
-			
+
 	free( sums );
-	
-	/* scale the pow value to be in the range 0.0 -- 1.0 */
-	maxpow /= ( (double) min * (double) min);
 
-	if ( -min_sample > max_sample )
-		*peak = min_sample / (double) min;
-	else
-		*peak = max_sample / (double) max;
+	*peak = max_sample;
 
 	return sqrt( maxpow );
 }
 
+/** Apply a gain ramp to interleaved float samples.
+
+    The limiter only changes samples beyond its level, so it is run as a
+    second pass over the few samples that need it.
+*/
+static void apply_gain( float *p, int channels, int samples, float gain, float gain_step, int limit, double limiter_level )
+{
+	int i, j;
+
+	for ( i = 0; i < samples; i++ )
+	{
+		float g = gain + gain_step * i;
+		for ( j = 0; j < channels; j++ )
+			p[ i * channels + j ] *= g;
+	}
+
+	if ( limit && ( gain > 1.0f || gain + gain_step * samples > 1.0f ) )
+	{
+		for ( i = 0; i < samples; i++ )
+		{
+			if ( gain + gain_step * i <= 1.0f )
+				continue;
+			for ( j = 0; j < channels; j++ )
+			{
+				/* use limiter function instead of clipping */
+				if ( fabsf( p[ i * channels + j ] ) > limiter_level )
+					p[ i * channels + j ] = limiter( p[ i * channels + j ], limiter_level );
+			}
+		}
+	}
+}
+
 /* ------ End normalize functions --------------------------------------- */
 
 /** Get the audio.
@@ -175,9 +187,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	double limiter_level = 0.5; /* -6 dBFS */
 	int normalise =  mlt_properties_get_int( instance_props, "normalise" );
 	double amplitude =  mlt_properties_get_double( instance_props, "amplitude" );
-	int i, j;
-	double sample;
-	int16_t peak;
+	float peak;
 
 	// Use animated value for gain if "level" property is set 
 	char* level_property = mlt_properties_get( filter_props, "level" );
@@ -193,7 +203,7 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 		limiter_level = mlt_properties_get_double( instance_props, "limiter" );
 	
 	// Get the producer's audio
-	*format = normalise? mlt_audio_s16 : mlt_audio_f32le;
+	*format = mlt_audio_f32le;
 	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
 
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
@@ -249,35 +259,9 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	// Ramp from the previous gain to the current
 	gain = previous_gain;
 
-	// Apply the gain
-	if ( normalise )
-	{
-		int16_t *p = *buffer;
-		// Determine numeric limits
-		int bytes_per_samp = (samp_width - 1) / 8 + 1;
-		int samplemax = (1 << (bytes_per_samp * 8 - 1)) - 1;
-
-		for ( i = 0; i < *samples; i++, gain += gain_step ) {
-			for ( j = 0; j < *channels; j++ ) {
-				sample = *p * gain;
-				*p = ROUND( sample );
-				if ( gain > 1.0 && normalise ) {
-					/* use limiter function instead of clipping */
-					*p = ROUND( samplemax * limiter( sample / (double) samplemax, limiter_level ) );
-				}
-				p++;
-			}
-		}
-	}
-	else
-	{
-		float *p = *buffer;
-		for ( i = 0; i < *samples; i++, gain += gain_step ) {
-			for ( j = 0; j < *channels; j++, p++ ) {
-				p[0] *= gain;
-			}
-		}
-	}
+	// Apply the gain, limiting the normalised signal instead of clipping it
+	apply_gain( *buffer, *channels, *samples, gain, gain_step, normalise, limiter_level );
+
 	return 0;
 }
 
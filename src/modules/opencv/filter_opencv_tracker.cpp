@@ -22,10 +22,23 @@
 #include <opencv2/core/version.hpp>
 
 
+typedef struct
+{
+	int frame;
+	mlt_rect rect;
+} tracker_result;
+
 typedef struct
 {
 	cv::Ptr<cv::Tracker> tracker;
 	cv::Rect2d boundingBox;
+	cv::Rect window;
+	double scale;
+	uint8_t *scaled_image;
+	int scaled_size;
+	tracker_result *results;
+	int result_count;
+	int result_alloc;
 	char * algo;
 	mlt_rect startRect;
 	bool initialized;
@@ -58,7 +71,7 @@ static void property_changed( mlt_service owner, mlt_filter filter, char *name )
 			pdata->initialized = false;
 			pdata->producer_length = 0;
 			pdata->playback = false;
-			mlt_properties_set( filter_properties, "_results", NULL );
+			pdata->result_count = 0;
 		}
 	}
 	if ( !pdata->initialized )
@@ -101,6 +114,185 @@ static void apply( mlt_filter filter, private_data* data, int width, int height,
 }
 
 
+/** Map a rect from frame coordinates to the coordinates of the analysis image.
+*/
+
+static cv::Rect2d to_analysis( const cv::Rect2d &rect, const private_data* data )
+{
+	return cv::Rect2d( ( rect.x - data->window.x ) * data->scale, ( rect.y - data->window.y ) * data->scale,
+		rect.width * data->scale, rect.height * data->scale );
+}
+
+/** Map a rect from the coordinates of the analysis image back to frame coordinates.
+*/
+
+static cv::Rect2d from_analysis( const cv::Rect2d &rect, const private_data* data )
+{
+	return cv::Rect2d( rect.x / data->scale + data->window.x, rect.y / data->scale + data->window.y,
+		rect.width / data->scale, rect.height / data->scale );
+}
+
+static double analysis_scale( mlt_properties properties )
+{
+	double scale = mlt_properties_get_double( properties, "analysis_scale" );
+	if ( scale <= 0.0 || scale > 1.0 )
+		scale = 1.0;
+	return scale;
+}
+
+/** Choose the area of the frame given to the tracker.
+ *
+ * With search_window set this is that many times the box, centered on it;
+ * otherwise it is the whole frame. Windows under twice the box would leave
+ * no room for the box to move, so they are widened to that.
+*/
+
+static cv::Rect search_window( mlt_properties properties, const cv::Rect2d &box, const cv::Mat &cvFrame )
+{
+	cv::Rect frame_rect( 0, 0, cvFrame.cols, cvFrame.rows );
+	double factor = mlt_properties_get_double( properties, "search_window" );
+	if ( factor <= 0.0 )
+		return frame_rect;
+	factor = MAX( factor, 2.0 );
+	double w = MAX( box.width, 1.0 ) * factor;
+	double h = MAX( box.height, 1.0 ) * factor;
+	cv::Rect window( cvFloor( box.x + box.width / 2 - w / 2 ), cvFloor( box.y + box.height / 2 - h / 2 ), cvCeil( w ), cvCeil( h ) );
+	window &= frame_rect;
+	return window.area() > 0 ? window : frame_rect;
+}
+
+/** Check that the box is still clear of the edges of the search window.
+ *
+ * The margin is a quarter of the box on each side, unless the window
+ * already reaches the edge of the frame there.
+*/
+
+static bool window_holds( const private_data* data, const cv::Rect2d &box, const cv::Mat &cvFrame )
+{
+	double mx = box.width / 4;
+	double my = box.height / 4;
+	const cv::Rect &w = data->window;
+	return ( w.x == 0 || box.x - mx >= w.x )
+		&& ( w.y == 0 || box.y - my >= w.y )
+		&& ( w.x + w.width == cvFrame.cols || box.x + box.width + mx <= w.x + w.width )
+		&& ( w.y + w.height == cvFrame.rows || box.y + box.height + my <= w.y + w.height );
+}
+
+/** Build the image handed to the tracker.
+ *
+ * The search window is cropped out of the frame and downscaled by
+ * analysis_scale. The tracker works in the coordinates of this image;
+ * use to_analysis() and from_analysis() to convert.
+*/
+
+static cv::Mat analysis_image( cv::Mat cvFrame, private_data* data )
+{
+	cv::Mat cropped = cvFrame( data->window );
+	if ( data->scale == 1.0 )
+		return cropped;
+
+	cv::Size size( MAX( 1, cvRound( cropped.cols * data->scale ) ), MAX( 1, cvRound( cropped.rows * data->scale ) ) );
+	int needed = size.width * size.height * 3;
+	if ( needed > data->scaled_size )
+	{
+		free( data->scaled_image );
+		data->scaled_image = (uint8_t*) malloc( needed );
+		data->scaled_size = needed;
+	}
+	cv::Mat scaled( size, CV_8UC3, data->scaled_image );
+	cv::resize( cropped, scaled, size, 0, 0, cv::INTER_AREA );
+	return scaled;
+}
+
+static cv::Ptr<cv::Tracker> create_tracker( private_data* data )
+{
+#if CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 3
+	if ( !data->algo || *data->algo == '\0' || !strcmp(data->algo, "KCF" ) )
+	{
+		return cv::TrackerKCF::create();
+	}
+	else if ( !strcmp(data->algo, "MIL" ) )
+	{
+		return cv::TrackerMIL::create();
+	}
+	else if ( !strcmp(data->algo, "TLD" ) )
+	{
+		return cv::TrackerTLD::create();
+	}
+	else
+	{
+		return cv::TrackerBoosting::create();
+	}
+#else
+	if ( data->algo == NULL || !strcmp(data->algo, "" ) )
+	{
+		return cv::Tracker::create( "KCF" );
+	}
+	else
+	{
+		return cv::Tracker::create( data->algo );
+	}
+#endif
+}
+
+/** Start tracking the current bounding box afresh.
+ *
+ * Used when the search window has to move or the analysis scale changed:
+ * the tracker's state is in the coordinates of the old analysis image.
+*/
+
+static bool restart_tracker( mlt_properties properties, cv::Mat cvFrame, private_data* data )
+{
+	data->scale = analysis_scale( properties );
+	data->window = search_window( properties, data->boundingBox, cvFrame );
+	data->tracker = create_tracker( data );
+	if ( data->tracker == NULL )
+		return false;
+	return data->tracker->init( analysis_image( cvFrame, data ), to_analysis( data->boundingBox, data ) );
+}
+
+static void store_result( private_data* data, int position, mlt_rect rect )
+{
+	if ( data->result_count == data->result_alloc )
+	{
+		data->result_alloc = MAX( 256, data->result_alloc * 2 );
+		data->results = (tracker_result*) realloc( data->results, data->result_alloc * sizeof( tracker_result ) );
+	}
+	data->results[ data->result_count ].frame = position;
+	data->results[ data->result_count ].rect = rect;
+	data->result_count++;
+}
+
+/** Serialize the collected results in one pass.
+ *
+ * Keys are inserted from last to first so each insertion is at the head
+ * of the animation list.
+*/
+
+static void publish_results( mlt_properties properties, private_data* data, int length )
+{
+	mlt_animation anim = mlt_animation_new();
+	struct mlt_animation_item_s item;
+	int i;
+
+	mlt_animation_set_length( anim, length );
+	item.is_key = 1;
+	item.keyframe_type = mlt_keyframe_smooth;
+	for ( i = data->result_count - 1; i >= 0; i-- )
+	{
+		item.frame = data->results[i].frame;
+		item.property = mlt_property_init();
+		mlt_property_set_rect( item.property, data->results[i].rect );
+		mlt_animation_insert( anim, &item );
+		mlt_property_close( item.property );
+	}
+	char *results = mlt_animation_serialize( anim );
+	mlt_properties_set( properties, "results", results );
+	free( results );
+	mlt_animation_close( anim );
+	data->result_count = 0;
+}
+
 static void analyze( mlt_filter filter, cv::Mat cvFrame, private_data* data, int width, int height, int position, int length )
 {
 	mlt_properties filter_properties = MLT_FILTER_PROPERTIES( filter );
@@ -110,69 +302,46 @@ static void analyze( mlt_filter filter, cv::Mat cvFrame, private_data* data, int
         {
 		// Build tracker
 		data->algo = mlt_properties_get( filter_properties, "algo" );
-#if CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 3
-		if ( !data->algo || *data->algo == '\0' || !strcmp(data->algo, "KCF" ) )
-		{
-			data->tracker = cv::TrackerKCF::create();
-		}
-		else if ( !strcmp(data->algo, "MIL" ) )
-		{
-			data->tracker = cv::TrackerMIL::create();
-		}
-		else if ( !strcmp(data->algo, "TLD" ) )
-		{
-			data->tracker = cv::TrackerTLD::create();
-		}
-		else
-		{
-			data->tracker = cv::TrackerBoosting::create();
+
+		// Discard previous results
+		data->result_count = 0;
+		data->startRect = mlt_properties_get_rect( filter_properties, "rect" );
+		data->boundingBox.x = MAX( data->startRect.x, 1.0 );
+		data->boundingBox.y= MAX( data->startRect.y, 1.0 );
+		data->boundingBox.width = data->startRect.w;
+		data->boundingBox.height = data->startRect.h;
+		if ( data->boundingBox.width <1 ) {
+			data->boundingBox.width = 50;
 		}
-#else
-		if ( data->algo == NULL || !strcmp(data->algo, "" ) )
-		{
-			data->tracker = cv::Tracker::create( "KCF" );
+		if ( data->boundingBox.height <1 ) {
+			data->boundingBox.height = 50;
 		}
-		else
-		{
-			data->tracker = cv::Tracker::create( data->algo );
+		if ( restart_tracker( filter_properties, cvFrame, data ) ) {
+			data->initialized = true;
+			data->analyze = true;
+			data->last_position = -1;
 		}
-#endif
-
-		// Discard previous results
-		mlt_properties_set( filter_properties, "_results", "" );
-		if( data->tracker == NULL )
+		else if ( data->tracker == NULL )
                 {
 			fprintf( stderr, "Tracker initialized FAILED\n" );
 		}
-		else
-                {
-			data->startRect = mlt_properties_get_rect( filter_properties, "rect" );
-			data->boundingBox.x = MAX( data->startRect.x, 1.0 );
-			data->boundingBox.y= MAX( data->startRect.y, 1.0 );
-			data->boundingBox.width = data->startRect.w;
-			data->boundingBox.height = data->startRect.h;
-			if ( data->boundingBox.width <1 ) {
-				data->boundingBox.width = 50;
-			}
-			if ( data->boundingBox.height <1 ) {
-				data->boundingBox.height = 50;
-			}
-			if ( data->tracker->init( cvFrame, data->boundingBox ) ) {
-				data->initialized = true;
-				data->analyze = true;
-				data->last_position = -1;
-			}
-			// init anim property
-			mlt_properties_anim_get_int( filter_properties, "_results", 0, length );
-			mlt_animation anim = mlt_properties_get_animation( filter_properties, "_results" );
-			if ( anim == NULL ) {
-				fprintf( stderr, "animation initialized FAILED\n" );
-			}
-		}
+	}
+	else if ( analysis_scale( filter_properties ) != data->scale
+		|| ( data->window & cv::Rect( 0, 0, cvFrame.cols, cvFrame.rows ) ) != data->window )
+	{
+		// The tracker state no longer matches the analysis image
+		restart_tracker( filter_properties, cvFrame, data );
 	}
 	else
         {
-		data->tracker->update( cvFrame, data->boundingBox );
+		cv::Rect2d box = to_analysis( data->boundingBox, data );
+		data->tracker->update( analysis_image( cvFrame, data ), box );
+		data->boundingBox = from_analysis( box, data );
+		if ( !window_holds( data, data->boundingBox, cvFrame ) )
+		{
+			// Move the search window along with the box
+			restart_tracker( filter_properties, cvFrame, data );
+		}
 	}
 
 	if( data->analyze && position != data->last_position + 1 )
@@ -192,22 +361,12 @@ static void analyze( mlt_filter filter, cv::Mat cvFrame, private_data* data, int
 	rect.h = data->boundingBox.height;
 	rect.o = 0;
 	int steps = mlt_properties_get_int(filter_properties, "steps");
-	if ( steps > 1 && position > 0 && position < length - 1 )
-	{
-		if ( position % steps == 0 )
-			mlt_properties_anim_set_rect( filter_properties, "_results", rect, position, length, mlt_keyframe_smooth );
-	}
-	else
-	{
-		mlt_properties_anim_set_rect( filter_properties, "_results", rect, position, length, mlt_keyframe_smooth );
-	}
+	if ( steps <= 1 || position <= 0 || position >= length - 1 || position % steps == 0 )
+		store_result( data, position, rect );
 	if ( position + 1 == length )
 	{
 		//Analysis finished, store results
-		mlt_animation anim = mlt_properties_get_animation( filter_properties, "_results");
-		mlt_properties_set( filter_properties, "results", strdup( mlt_animation_serialize( anim ) ) );
-		// Discard temporary data
-		mlt_properties_set( filter_properties, "_results", (char*) NULL );
+		publish_results( filter_properties, data, length );
 		data->playback = true;
 	}
 	data->last_position = position;
@@ -226,7 +385,8 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	int shape_width = mlt_properties_get_int( filter_properties, "shape_width" );
 	int blur = mlt_properties_get_int( filter_properties, "blur" );
 	cv::Mat cvFrame;
-	if ( shape_width == 0 && blur == 0 ) {
+	private_data* data = (private_data*) filter->child;
+	if ( shape_width == 0 && blur == 0 && data->playback ) {
 		error = mlt_frame_get_image( frame, image, format, width, height, 1 );
 	}
 	else
@@ -235,7 +395,6 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		error = mlt_frame_get_image( frame, image, format, width, height, 1 );
 		cvFrame = cv::Mat( *height, *width, CV_8UC3, *image );
 	}
-	private_data* data = (private_data*) filter->child;
 	if ( !data->initialized )
         {
 		if ( data->producer_length == 0 )
@@ -332,6 +491,8 @@ static void filter_close( mlt_filter filter )
 {
 	private_data* data = (private_data*) filter->child;
 	free ( data->tracker );
+	free ( data->scaled_image );
+	free ( data->results );
 	free ( data );
 	filter->child = NULL;
 	filter->close = NULL;
@@ -355,6 +516,8 @@ mlt_filter filter_tracker_init( mlt_profile profile, mlt_service_type type, cons
 		mlt_properties_set_int( properties, "shape_width", 1 );
 		mlt_properties_set_int( properties, "steps", 5 );
 		mlt_properties_set( properties, "algo", "KCF" );
+		mlt_properties_set_double( properties, "analysis_scale", 1.0 );
+		mlt_properties_set_double( properties, "search_window", 0.0 );
 		data->initialized = false;
 		data->playback = false;
 		data->boundingBox.x = 0;
@@ -365,6 +528,7 @@ mlt_filter filter_tracker_init( mlt_profile profile, mlt_service_type type, cons
 		data->last_position = -1;
 		data->producer_in = 0;
 		data->producer_length = 0;
+		data->scale = 1.0;
 		filter->child = data;
 
 		// Create a unique ID for storing data on the frame
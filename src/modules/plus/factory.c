@@ -38,6 +38,7 @@ extern mlt_filter filter_timer_init( mlt_profile profile, mlt_service_type type,
 extern mlt_producer producer_blipflash_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 extern mlt_producer producer_count_init( const char *arg );
 extern mlt_transition transition_affine_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
+extern mlt_transition transition_videoquality_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
 
 #ifdef USE_FFTW
 extern mlt_filter filter_dance_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg );
@@ -70,6 +71,7 @@ MLT_REPOSITORY
 	MLT_REGISTER( producer_type, "blipflash", producer_blipflash_init );
 	MLT_REGISTER( producer_type, "count", producer_count_init );
 	MLT_REGISTER( transition_type, "affine", transition_affine_init );
+	MLT_REGISTER( transition_type, "videoquality", transition_videoquality_init );
 #ifdef USE_FFTW
 	MLT_REGISTER( filter_type, "dance", filter_dance_init );
 	MLT_REGISTER( filter_type, "fft", filter_fft_init );
@@ -92,6 +94,7 @@ MLT_REPOSITORY
 	MLT_REGISTER_METADATA( producer_type, "blipflash", metadata, "producer_blipflash.yml" );
 	MLT_REGISTER_METADATA( producer_type, "count", metadata, "producer_count.yml" );
 	MLT_REGISTER_METADATA( transition_type, "affine", metadata, "transition_affine.yml" );
+	MLT_REGISTER_METADATA( transition_type, "videoquality", metadata, "transition_videoquality.yml" );
 #ifdef USE_FFTW
 	MLT_REGISTER_METADATA( filter_type, "dance", metadata, "filter_dance.yml" );
 	MLT_REGISTER_METADATA( filter_type, "fft", metadata, "filter_fft.yml" );
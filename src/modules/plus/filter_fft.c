@@ -187,24 +187,43 @@ static int filter_get_audio( mlt_frame frame, void** buffer, mlt_audio_format* f
 			private->sample_buff_count = private->window_size;
 		}
 
-		// Copy samples to fft input while applying window function
-		for (s = 0; s < private->window_size; s++)
+		// Reuse the spectrum if another fft filter on this frame already
+		// computed it from the same window of samples
+		char name[ 64 ];
+		int size = private->window_size * sizeof(*private->sample_buff);
+		snprintf( name, sizeof( name ), "fft.%u", private->window_size );
+		float* shared = mlt_frame_get_analysis( frame, name, private->sample_buff, size, NULL );
+
+		if( shared )
 		{
-			private->fft_in[s] = private->sample_buff[s] * private->hann[s];
+			memcpy( private->out_bins, shared, private->bin_count * sizeof(*private->out_bins) );
 		}
+		else
+		{
+			// Copy samples to fft input while applying window function
+			for (s = 0; s < private->window_size; s++)
+			{
+				private->fft_in[s] = private->sample_buff[s] * private->hann[s];
+			}
 
-		// Perform the FFT
-		fftw_execute( private->fft_plan );
+			// Perform the FFT
+			fftw_execute( private->fft_plan );
 
-		// Convert to magnitudes
-		int bin = 0;
-		for( bin = 0; bin < private->bin_count; bin++ )
-		{
-			// Convert FFT output to magnitudes
-			private->out_bins[bin] = sqrt( private->fft_out[bin][0] * private->fft_out[bin][0]
-												+ private->fft_out[bin][1] * private->fft_out[bin][1] );
-			// Scale to 0.0 - 1.0
-			private->out_bins[bin] = (4.0 * private->out_bins[bin]) / (float)private->window_size;
+			// Convert to magnitudes
+			int bin = 0;
+			for( bin = 0; bin < private->bin_count; bin++ )
+			{
+				// Convert FFT output to magnitudes
+				private->out_bins[bin] = sqrt( private->fft_out[bin][0] * private->fft_out[bin][0]
+													+ private->fft_out[bin][1] * private->fft_out[bin][1] );
+				// Scale to 0.0 - 1.0
+				private->out_bins[bin] = (4.0 * private->out_bins[bin]) / (float)private->window_size;
+			}
+
+			// Publish the spectrum for other filters
+			shared = mlt_pool_alloc( private->bin_count * sizeof(*shared) );
+			memcpy( shared, private->out_bins, private->bin_count * sizeof(*shared) );
+			mlt_frame_set_analysis( frame, name, private->sample_buff, size, shared, private->bin_count * sizeof(*shared), mlt_pool_release );
 		}
 
 		private->expected_pos++;
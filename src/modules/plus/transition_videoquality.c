@@ -0,0 +1,506 @@
+/*
+ * transition_videoquality.c -- video quality measurement
+ * Copyright (C) 2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_WINDOW 64
+#define MS_SSIM_SCALES 5
+#define MAX_JOBS 32
+
+static const double ms_ssim_weights[ MS_SSIM_SCALES ] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+/** An 8 bit image plane, possibly interleaved with other planes.
+*/
+
+typedef struct
+{
+	const uint8_t *data;
+	int step;
+	int stride;
+	int width;
+	int height;
+}
+plane_desc;
+
+typedef struct
+{
+	plane_desc a;
+	plane_desc b;
+	int window;
+	int window_step;
+	int rows;
+	double ssim[ MAX_JOBS ];
+	double cs[ MAX_JOBS ];
+	int64_t count[ MAX_JOBS ];
+}
+ssim_desc;
+
+typedef struct
+{
+	const uint8_t *a;
+	const uint8_t *b;
+	int width;
+	int height;
+	int64_t sse[ MAX_JOBS ][ 3 ];
+}
+psnr_desc;
+
+static void slice_range( int count, int jobs, int idx, int *start, int *end )
+{
+	int size = ( count + jobs - 1 ) / jobs;
+	*start = idx * size;
+	*end = *start + size > count ? count : *start + size;
+}
+
+/** Sum the squared differences of each plane of a yuv422 image pair.
+*/
+
+static int psnr_slice( int id, int idx, int jobs, void *cookie )
+{
+	psnr_desc *desc = cookie;
+	int64_t sse[ 3 ] = { 0, 0, 0 };
+	int start, end, y, x;
+
+	slice_range( desc->height, jobs, idx, &start, &end );
+	for ( y = start; y < end; y ++ )
+	{
+		const uint8_t *a = desc->a + y * desc->width * 2;
+		const uint8_t *b = desc->b + y * desc->width * 2;
+		uint32_t row[ 3 ] = { 0, 0, 0 };
+
+		for ( x = 0; x < desc->width / 2; x ++, a += 4, b += 4 )
+		{
+			int d0 = a[ 0 ] - b[ 0 ];
+			int d1 = a[ 1 ] - b[ 1 ];
+			int d2 = a[ 2 ] - b[ 2 ];
+			int d3 = a[ 3 ] - b[ 3 ];
+			row[ 0 ] += d0 * d0 + d2 * d2;
+			row[ 1 ] += d1 * d1;
+			row[ 2 ] += d3 * d3;
+		}
+		sse[ 0 ] += row[ 0 ];
+		sse[ 1 ] += row[ 1 ];
+		sse[ 2 ] += row[ 2 ];
+	}
+	memcpy( desc->sse[ idx ], sse, sizeof( sse ) );
+	return 0;
+}
+
+static double psnr( int64_t sse, int64_t count )
+{
+	return 10.0 * log10( 255.0 * 255.0 / ( sse == 0 ? 1e-10 : ( double )sse / count ) );
+}
+
+/** Add (sign 1) or remove (sign -1) an image row from the running column sums.
+*/
+
+static inline void column_sums( const plane_desc *a, const plane_desc *b, int y, int sign, int32_t *sums, int width )
+{
+	const uint8_t *pa = a->data + y * a->stride;
+	const uint8_t *pb = b->data + y * b->stride;
+	int32_t *s_a = sums;
+	int32_t *s_b = sums + width;
+	int32_t *s_aa = sums + 2 * width;
+	int32_t *s_bb = sums + 3 * width;
+	int32_t *s_ab = sums + 4 * width;
+	int x;
+
+	for ( x = 0; x < width; x ++ )
+	{
+		int32_t va = pa[ x * a->step ] * sign;
+		int32_t vb = pb[ x * b->step ];
+		s_a[ x ] += va;
+		s_b[ x ] += vb * sign;
+		s_aa[ x ] += va * pa[ x * a->step ];
+		s_bb[ x ] += vb * vb * sign;
+		s_ab[ x ] += va * vb;
+	}
+}
+
+/** Get the SSIM of one window from its sums, adding its contrast-structure term to cs.
+*/
+
+static inline double window_ssim( int32_t sa, int32_t sb, int32_t saa, int32_t sbb, int32_t sab, double n, double c1, double c2, double *cs )
+{
+	// The means and (co)variances scaled by n^2
+	double mean_ab = ( double )sa * sb;
+	double mean_aa = ( double )sa * sa;
+	double mean_bb = ( double )sb * sb;
+	double var = n * ( ( double )saa + sbb ) - mean_aa - mean_bb;
+	double cov = n * sab - mean_ab;
+	double l = ( 2.0 * mean_ab + c1 ) / ( mean_aa + mean_bb + c1 );
+	double c = ( 2.0 * cov + c2 ) / ( var + c2 );
+
+	*cs += c;
+	return l * c;
+}
+
+/** Compute SSIM over box windows.
+ *
+ * Each slice takes a band of window rows. Overlapping windows keep the five
+ * window sums of every column and slide them down, then slide a window across
+ * them, so each pixel is visited a constant number of times whatever the
+ * window size and step.
+ */
+
+static int ssim_slice( int id, int idx, int jobs, void *cookie )
+{
+	ssim_desc *desc = cookie;
+	int width = desc->a.width;
+	int window = desc->window;
+	int step = desc->window_step;
+	double n = window * window;
+	double c1 = 6.5025 * n * n;   // (0.01*255)^2
+	double c2 = 58.5225 * n * n;  // (0.03*255)^2
+	int32_t *sums = calloc( 5 * width, sizeof( int32_t ) );
+	double ssim = 0.0, cs = 0.0;
+	int64_t count = 0;
+	int start, end, row, y, x, i;
+
+	slice_range( desc->rows, jobs, idx, &start, &end );
+	for ( row = start; row < end && sums; row ++ )
+	{
+		int top = row * step;
+		int32_t sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+
+		// Windows that do not overlap are summed directly
+		if ( step >= window )
+		{
+			for ( x = 0; x + window <= width; x += step )
+			{
+				const uint8_t *pa = desc->a.data + top * desc->a.stride + x * desc->a.step;
+				const uint8_t *pb = desc->b.data + top * desc->b.stride + x * desc->b.step;
+				sa = sb = saa = sbb = sab = 0;
+				for ( y = 0; y < window; y ++, pa += desc->a.stride, pb += desc->b.stride )
+				{
+					for ( i = 0; i < window; i ++ )
+					{
+						int32_t va = pa[ i * desc->a.step ];
+						int32_t vb = pb[ i * desc->b.step ];
+						sa += va;
+						sb += vb;
+						saa += va * va;
+						sbb += vb * vb;
+						sab += va * vb;
+					}
+				}
+				ssim += window_ssim( sa, sb, saa, sbb, sab, n, c1, c2, &cs );
+				count ++;
+			}
+			continue;
+		}
+
+		// Slide the column sums down to this window row
+		if ( row == start )
+		{
+			memset( sums, 0, 5 * width * sizeof( int32_t ) );
+			for ( y = top; y < top + window; y ++ )
+				column_sums( &desc->a, &desc->b, y, 1, sums, width );
+		}
+		else
+		{
+			for ( y = top - step; y < top; y ++ )
+				column_sums( &desc->a, &desc->b, y, -1, sums, width );
+			for ( y = top - step + window; y < top + window; y ++ )
+				column_sums( &desc->a, &desc->b, y, 1, sums, width );
+		}
+
+		// Slide the window across
+		for ( x = 0; x + window <= width; x += step )
+		{
+			if ( x == 0 )
+			{
+				sa = sb = saa = sbb = sab = 0;
+				for ( i = x; i < x + window; i ++ )
+				{
+					sa += sums[ i ];
+					sb += sums[ width + i ];
+					saa += sums[ 2 * width + i ];
+					sbb += sums[ 3 * width + i ];
+					sab += sums[ 4 * width + i ];
+				}
+			}
+			else
+			{
+				for ( i = x - step; i < x; i ++ )
+				{
+					sa -= sums[ i ] - sums[ i + window ];
+					sb -= sums[ width + i ] - sums[ width + i + window ];
+					saa -= sums[ 2 * width + i ] - sums[ 2 * width + i + window ];
+					sbb -= sums[ 3 * width + i ] - sums[ 3 * width + i + window ];
+					sab -= sums[ 4 * width + i ] - sums[ 4 * width + i + window ];
+				}
+			}
+
+			ssim += window_ssim( sa, sb, saa, sbb, sab, n, c1, c2, &cs );
+			count ++;
+		}
+	}
+	free( sums );
+
+	desc->ssim[ idx ] = ssim;
+	desc->cs[ idx ] = cs;
+	desc->count[ idx ] = count;
+	return 0;
+}
+
+/** Get the mean SSIM and contrast-structure term of a plane pair.
+*/
+
+static double calc_ssim( plane_desc *a, plane_desc *b, int window, int window_step, double *cs )
+{
+	ssim_desc desc;
+	double ssim = 0.0;
+	int64_t count = 0;
+	int jobs, i;
+
+	if ( cs )
+		*cs = 0.0;
+	if ( a->width < window || a->height < window )
+		return 0.0;
+
+	desc.a = *a;
+	desc.b = *b;
+	desc.window = window;
+	desc.window_step = window_step;
+	desc.rows = ( a->height - window ) / window_step + 1;
+	jobs = mlt_slices_count_normal();
+	jobs = jobs < 1 ? 1 : jobs > MAX_JOBS ? MAX_JOBS : jobs;
+	if ( jobs > desc.rows )
+		jobs = desc.rows;
+	mlt_slices_run_normal( jobs, ssim_slice, &desc );
+
+	if ( cs )
+		for ( i = 0; i < jobs; i ++ )
+			*cs += desc.cs[ i ];
+	for ( i = 0; i < jobs; i ++ )
+	{
+		ssim += desc.ssim[ i ];
+		count += desc.count[ i ];
+	}
+	if ( count == 0 )
+		return 0.0;
+	if ( cs )
+		*cs /= count;
+	return ssim / count;
+}
+
+/** Halve a plane by averaging 2x2 blocks into a packed plane.
+*/
+
+static void downsample( const plane_desc *src, plane_desc *dst, uint8_t *buffer )
+{
+	int x, y;
+
+	dst->data = buffer;
+	dst->step = 1;
+	dst->width = src->width / 2;
+	dst->height = src->height / 2;
+	dst->stride = dst->width;
+
+	for ( y = 0; y < dst->height; y ++ )
+	{
+		const uint8_t *p = src->data + 2 * y * src->stride;
+		const uint8_t *q = p + src->stride;
+		for ( x = 0; x < dst->width; x ++, p += 2 * src->step, q += 2 * src->step )
+			*buffer ++ = ( p[ 0 ] + p[ src->step ] + q[ 0 ] + q[ src->step ] + 2 ) >> 2;
+	}
+}
+
+/** Compute multi-scale SSIM.
+ *
+ * Scales that would be smaller than the window are dropped and the weights
+ * of the remaining scales renormalised.
+ */
+
+static double calc_ms_ssim( plane_desc *a, plane_desc *b, int window, int window_step, double cs0 )
+{
+	plane_desc scaled_a[ 2 ], scaled_b[ 2 ];
+	plane_desc *pa = a, *pb = b;
+	uint8_t *buffer = mlt_pool_alloc( a->width * a->height );
+	uint8_t *buffers[ 4 ];
+	double result = 1.0, total = 0.0;
+	int scales = 1, i;
+
+	while ( scales < MS_SSIM_SCALES && ( a->width >> scales ) >= window && ( a->height >> scales ) >= window )
+		scales ++;
+	for ( i = 0; i < scales; i ++ )
+		total += ms_ssim_weights[ i ];
+
+	// Two pairs of half size buffers are used in turn
+	buffers[ 0 ] = buffer;
+	buffers[ 1 ] = buffer + a->width * a->height / 4;
+	buffers[ 2 ] = buffer + a->width * a->height / 2;
+	buffers[ 3 ] = buffers[ 2 ] + a->width * a->height / 16;
+
+	for ( i = 0; i < scales; i ++ )
+	{
+		// The full size contrast-structure term is known from the plain SSIM
+		double cs = cs0;
+		double ssim = i > 0 || scales == 1 ? calc_ssim( pa, pb, window, window_step, &cs ) : 0.0;
+		double value = i == scales - 1 ? ssim : cs;
+
+		result *= pow( value > 0.0 ? value : 0.0, ms_ssim_weights[ i ] / total );
+
+		if ( i < scales - 1 )
+		{
+			plane_desc *next_a = &scaled_a[ i % 2 ];
+			plane_desc *next_b = &scaled_b[ i % 2 ];
+			downsample( pa, next_a, buffers[ 2 * ( i % 2 ) ] );
+			downsample( pb, next_b, buffers[ 2 * ( i % 2 ) + 1 ] );
+			pa = next_a;
+			pb = next_b;
+		}
+	}
+	mlt_pool_release( buffer );
+
+	return result;
+}
+
+static void write_log( mlt_transition transition, mlt_position position, double *psnr, double *ssim, double ms_ssim )
+{
+	mlt_properties properties = MLT_TRANSITION_PROPERTIES( transition );
+	char *filename = mlt_properties_get( properties, "log" );
+
+	if ( !filename || !*filename )
+		return;
+
+	mlt_service_lock( MLT_TRANSITION_SERVICE( transition ) );
+	FILE *log = mlt_properties_get_data( properties, "_log", NULL );
+	char *current = mlt_properties_get( properties, "_log_file" );
+	if ( !log || !current || strcmp( current, filename ) )
+	{
+		log = mlt_fopen( filename, "w" );
+		mlt_properties_set_data( properties, "_log", log, 0, ( mlt_destructor )fclose, NULL );
+		mlt_properties_set( properties, "_log_file", filename );
+		if ( log )
+			fprintf( log, "frame psnr[Y] psnr[Cb] psnr[Cr] ssim[Y] ssim[Cb] ssim[Cr] ms-ssim[Y]\n" );
+		else
+			mlt_log_error( MLT_TRANSITION_SERVICE( transition ), "failed to open %s\n", filename );
+	}
+	if ( log )
+	{
+		fprintf( log, "%d %.4f %.4f %.4f %.6f %.6f %.6f %.6f\n", position,
+				psnr[0], psnr[1], psnr[2], ssim[0], ssim[1], ssim[2], ms_ssim );
+		fflush( log );
+	}
+	mlt_service_unlock( MLT_TRANSITION_SERVICE( transition ) );
+}
+
+static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
+{
+	mlt_frame b_frame = mlt_frame_pop_frame( a_frame );
+	mlt_properties properties = MLT_FRAME_PROPERTIES( a_frame );
+	mlt_transition transition = mlt_frame_pop_service( a_frame );
+	mlt_properties transition_properties = MLT_TRANSITION_PROPERTIES( transition );
+	int window = mlt_properties_get_int( transition_properties, "window_size" );
+	int window_step = mlt_properties_get_int( transition_properties, "window_step" );
+	uint8_t *b_image = NULL;
+	double psnr_values[ 3 ], ssim[ 3 ], ms_ssim = 0.0;
+	int error;
+
+	*format = mlt_image_yuv422;
+	error = mlt_frame_get_image( b_frame, &b_image, format, width, height, 0 );
+	if ( !error )
+		error = mlt_frame_get_image( a_frame, image, format, width, height, writable );
+	if ( error || *format != mlt_image_yuv422 )
+		return error;
+
+	window = window < 2 ? 2 : window > MAX_WINDOW ? MAX_WINDOW : window;
+	window_step = window_step < 1 ? window : window_step;
+
+	// PSNR of each plane
+	psnr_desc pdesc = { *image, b_image, *width, *height };
+	int jobs = mlt_slices_count_normal();
+	int i;
+	jobs = jobs < 1 ? 1 : jobs > MAX_JOBS ? MAX_JOBS : jobs;
+	mlt_slices_run_normal( jobs, psnr_slice, &pdesc );
+	for ( i = 1; i < jobs; i ++ )
+	{
+		pdesc.sse[ 0 ][ 0 ] += pdesc.sse[ i ][ 0 ];
+		pdesc.sse[ 0 ][ 1 ] += pdesc.sse[ i ][ 1 ];
+		pdesc.sse[ 0 ][ 2 ] += pdesc.sse[ i ][ 2 ];
+	}
+	psnr_values[ 0 ] = psnr( pdesc.sse[ 0 ][ 0 ], ( int64_t )*width * *height );
+	psnr_values[ 1 ] = psnr( pdesc.sse[ 0 ][ 1 ], ( int64_t )*width / 2 * *height );
+	psnr_values[ 2 ] = psnr( pdesc.sse[ 0 ][ 2 ], ( int64_t )*width / 2 * *height );
+
+	// SSIM of each plane
+	plane_desc a[ 3 ] = {
+		{ *image, 2, *width * 2, *width, *height },
+		{ *image + 1, 4, *width * 2, *width / 2, *height },
+		{ *image + 3, 4, *width * 2, *width / 2, *height }
+	};
+	plane_desc b[ 3 ] = {
+		{ b_image, 2, *width * 2, *width, *height },
+		{ b_image + 1, 4, *width * 2, *width / 2, *height },
+		{ b_image + 3, 4, *width * 2, *width / 2, *height }
+	};
+	double cs;
+	ssim[ 0 ] = calc_ssim( &a[ 0 ], &b[ 0 ], window, window_step, &cs );
+	ssim[ 1 ] = calc_ssim( &a[ 1 ], &b[ 1 ], window, window_step, NULL );
+	ssim[ 2 ] = calc_ssim( &a[ 2 ], &b[ 2 ], window, window_step, NULL );
+	if ( mlt_properties_get_int( transition_properties, "ms_ssim" ) )
+		ms_ssim = calc_ms_ssim( &a[ 0 ], &b[ 0 ], window, window_step, cs );
+
+	mlt_properties_set_double( properties, "meta.vqm.psnr.y", psnr_values[ 0 ] );
+	mlt_properties_set_double( properties, "meta.vqm.psnr.cb", psnr_values[ 1 ] );
+	mlt_properties_set_double( properties, "meta.vqm.psnr.cr", psnr_values[ 2 ] );
+	mlt_properties_set_double( properties, "meta.vqm.ssim.y", ssim[ 0 ] );
+	mlt_properties_set_double( properties, "meta.vqm.ssim.cb", ssim[ 1 ] );
+	mlt_properties_set_double( properties, "meta.vqm.ssim.cr", ssim[ 2 ] );
+	if ( mlt_properties_get_int( transition_properties, "ms_ssim" ) )
+		mlt_properties_set_double( properties, "meta.vqm.ms_ssim.y", ms_ssim );
+
+	write_log( transition, mlt_frame_get_position( a_frame ), psnr_values, ssim, ms_ssim );
+
+	return 0;
+}
+
+static mlt_frame transition_process( mlt_transition transition, mlt_frame a_frame, mlt_frame b_frame )
+{
+	mlt_frame_push_service( a_frame, transition );
+	mlt_frame_push_frame( a_frame, b_frame );
+	mlt_frame_push_get_image( a_frame, transition_get_image );
+
+	return a_frame;
+}
+
+mlt_transition transition_videoquality_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	mlt_transition transition = mlt_transition_new();
+
+	if ( transition )
+	{
+		mlt_properties properties = MLT_TRANSITION_PROPERTIES( transition );
+
+		transition->process = transition_process;
+		mlt_properties_set_int( properties, "_transition_type", 1 ); // video only
+		mlt_properties_set_int( properties, "window_size", 8 );
+		mlt_properties_set_int( properties, "window_step", 8 );
+		mlt_properties_set_int( properties, "ms_ssim", 1 );
+		mlt_properties_set( properties, "log", arg );
+	}
+
+	return transition;
+}
@@ -100,6 +100,7 @@ mlt_producer producer_qimage_init( mlt_profile profile, mlt_service_type type, c
 				mlt_frame_set_position( frame, mlt_producer_position( producer ) );
 				refresh_qimage( self, frame );
 				mlt_cache_item_close( self->qimage_cache );
+				self->qimage_cache = NULL;
 				mlt_frame_close( frame );
 			}
 		}
@@ -318,8 +319,11 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 
 	// Release references and locks
 	mlt_cache_item_close( self->qimage_cache );
+	self->qimage_cache = NULL;
 	mlt_cache_item_close( self->image_cache );
+	self->image_cache = NULL;
 	mlt_cache_item_close( self->alpha_cache );
+	self->alpha_cache = NULL;
 	mlt_service_unlock( MLT_PRODUCER_SERVICE( &self->parent ) );
 
 	return error;
@@ -350,11 +354,14 @@ static int producer_get_frame( mlt_producer producer, mlt_frame_ptr frame, int i
 		// Update timecode on the frame we're creating
 		mlt_frame_set_position( *frame, mlt_producer_position( producer ) );
 
-		// Refresh the image
+		// Refresh the image, which get_image may be doing on another thread
+		mlt_service_lock( MLT_PRODUCER_SERVICE( producer ) );
 		self->qimage_cache = mlt_service_cache_get( MLT_PRODUCER_SERVICE( producer ), "qimage.qimage" );
 		self->qimage = mlt_cache_item_data( self->qimage_cache, NULL );
 		refresh_qimage( self, *frame );
 		mlt_cache_item_close( self->qimage_cache );
+		self->qimage_cache = NULL;
+		mlt_service_unlock( MLT_PRODUCER_SERVICE( producer ) );
 
 		// Set producer-specific frame properties
 		mlt_properties_set_int( properties, "progressive", mlt_properties_get_int( producer_properties, "progressive" ) );
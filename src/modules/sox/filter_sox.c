@@ -80,6 +80,292 @@ static inline double mean( double *buf, int count )
 	return mean;
 }
 
+/** Parse a plain "vol" effect into a linear gain.
+
+    Only the forms "vol GAIN", "vol GAINdB" and "vol GAIN amplitude|dB"
+    are accepted; anything else (including a limiter gain) must go through
+    sox.
+*/
+static int parse_gain_effect( char *value, double *gain )
+{
+	mlt_tokeniser tokeniser = mlt_tokeniser_init();
+	int result = 0;
+
+	mlt_tokeniser_parse_new( tokeniser, value, " " );
+	if ( tokeniser->count >= 2 && tokeniser->count <= 3 && !strcmp( tokeniser->tokens[0], "vol" ) )
+	{
+		char *end = NULL;
+		double level = strtod( tokeniser->tokens[1], &end );
+
+		if ( end != tokeniser->tokens[1] )
+		{
+			int db = !strcmp( end, "dB" );
+
+			if ( *end == '\0' || db )
+			{
+				if ( tokeniser->count == 3 )
+				{
+					if ( !strcmp( tokeniser->tokens[2], "dB" ) )
+						db = 1;
+					else if ( strcmp( tokeniser->tokens[2], "amplitude" ) )
+						level = NAN;
+				}
+				if ( !isnan( level ) )
+				{
+					*gain = db ? DBFSTOAMP( level ) : level;
+					result = 1;
+				}
+			}
+		}
+	}
+	mlt_tokeniser_close( tokeniser );
+
+	return result;
+}
+
+/** Check whether the effect properties still match a cached specification.
+
+    The specification is the effect values each followed by a newline.
+*/
+static int gain_spec_matches( mlt_properties properties, const char *cached )
+{
+	int i;
+
+	for ( i = 0; i < mlt_properties_count( properties ); i++ )
+	{
+		char *name = mlt_properties_get_name( properties, i );
+		char *value = mlt_properties_get_value( properties, i );
+		if ( !strncmp( name, "effect", 6 ) && value )
+		{
+			size_t length = strlen( value );
+			if ( strncmp( cached, value, length ) || cached[ length ] != '\n' )
+				return 0;
+			cached += length + 1;
+		}
+	}
+	return *cached == '\0';
+}
+
+/** Determine whether the effect chain only changes the gain.
+
+    Such a chain is applied directly to float samples with no sox effect
+    state at all. Only a single vol stage qualifies: the sox path feeds every
+    effect the same input, so with several stages only the last one counts,
+    which is not worth reproducing here. The gain is cached until an effect
+    property changes.
+*/
+static int is_gain_chain( mlt_properties properties, double *gain, int *vol_count )
+{
+	char *cached = mlt_properties_get( properties, "_gain_spec" );
+
+	if ( !cached || !gain_spec_matches( properties, cached ) )
+	{
+		char *spec = NULL;
+		size_t length = 0;
+		int gain_only = 1;
+		int failed = 0;
+		int count = 0;
+		double level = 1.0;
+		int i;
+
+		for ( i = 0; i < mlt_properties_count( properties ); i++ )
+		{
+			char *name = mlt_properties_get_name( properties, i );
+			char *value = mlt_properties_get_value( properties, i );
+
+			if ( strncmp( name, "effect", 6 ) || !value )
+				continue;
+
+			// Collect the current effect specifications
+			char *grown = realloc( spec, length + strlen( value ) + 2 );
+			if ( !grown )
+			{
+				gain_only = 0;
+				failed = 1;
+				break;
+			}
+			spec = grown;
+			strcpy( spec + length, value );
+			length += strlen( value );
+			spec[ length++ ] = '\n';
+			spec[ length ] = '\0';
+
+			if ( !strcmp( value, "analysis" ) )
+				continue;
+			if ( count == 0 && parse_gain_effect( value, &level ) )
+				count ++;
+			else
+				gain_only = 0;
+		}
+		// A failed allocation leaves no cached specification, so it is retried
+		mlt_properties_set( properties, "_gain_spec", failed ? NULL : spec ? spec : "" );
+		mlt_properties_set_int( properties, "_gain_only", gain_only );
+		mlt_properties_set_double( properties, "_gain", level );
+		mlt_properties_set_int( properties, "_gain_count", count );
+		free( spec );
+	}
+
+	*gain = mlt_properties_get_double( properties, "_gain" );
+	*vol_count = mlt_properties_get_int( properties, "_gain_count" );
+
+	return mlt_properties_get_int( properties, "_gain_only" );
+}
+
+/** Accumulate the analysis of one channel of one frame.
+
+    The power and peak are in units of full scale 32-bit samples.
+*/
+static void analyse_channel( mlt_filter filter, mlt_frame frame, double power, double peak, int last_channel )
+{
+	mlt_properties filter_properties = MLT_FILTER_PROPERTIES( filter );
+	double max_power = mlt_properties_get_double( filter_properties, "_max_power" );
+	double max_peak = mlt_properties_get_double( filter_properties, "_max_peak" );
+	double use_peak = mlt_properties_get_int( filter_properties, "use_peak" );
+
+	// Track peak
+	if ( peak > max_peak )
+	{
+		max_peak = peak;
+		mlt_properties_set_double( filter_properties, "_max_peak", max_peak );
+	}
+	// Track maximum power
+	if ( power > max_power )
+	{
+		max_power = power;
+		mlt_properties_set_double( filter_properties, "_max_power", max_power );
+	}
+
+	// Complete analysis the last channel of the last frame.
+	if ( last_channel && mlt_filter_get_position( filter, frame ) + 1
+		 == mlt_filter_get_length2( filter, frame ) )
+	{
+		double rms = sqrt( max_power / ST_SSIZE_MIN / ST_SSIZE_MIN );
+		double normalised_gain;
+		char effect[32];
+
+		// Convert RMS or peak to gain
+		if ( use_peak )
+			normalised_gain = ST_SSIZE_MIN / -max_peak;
+		else
+		{
+			double gain = DBFSTOAMP(-12); // default -12 dBFS
+			char *p = mlt_properties_get( filter_properties, "analysis_level" );
+			if (p)
+			{
+				gain = mlt_properties_get_double( filter_properties, "analysis_level" );
+				if ( strstr( p, "dB" ) )
+					gain = DBFSTOAMP( gain );
+			}
+			normalised_gain = gain / rms;
+		}
+
+		// Set properties for serialization
+		snprintf( effect, sizeof(effect), "vol %f", normalised_gain );
+		effect[31] = 0;
+		mlt_properties_set( filter_properties, "effect", effect );
+		mlt_properties_set( filter_properties, "analyze", NULL );
+
+		// Show output comparable to normalize --no-adjust --fractions
+		mlt_properties_set_double( filter_properties, "level", rms );
+		mlt_properties_set_double( filter_properties, "gain", normalised_gain );
+		mlt_properties_set_double( filter_properties, "peak", -max_peak / ST_SSIZE_MIN );
+	}
+}
+
+/** Compute the gain for normalisation from the rms amplitude of a channel.
+*/
+static double normalise_gain( mlt_properties filter_properties, double rms )
+{
+	int window = mlt_properties_get_int( filter_properties, "window" );
+	double *smooth_buffer = mlt_properties_get_data( filter_properties, "smooth_buffer", NULL );
+	double max_gain = mlt_properties_get_double( filter_properties, "max_gain" );
+	double normalised_gain = 1.0;
+
+	// Default the maximum gain factor to 20dBFS
+	if ( max_gain == 0 )
+		max_gain = 10.0;
+
+	// The smoothing buffer prevents radical shifts in the gain level
+	if ( window > 0 && smooth_buffer != NULL )
+	{
+		int smooth_index = mlt_properties_get_int( filter_properties, "_smooth_index" );
+		smooth_buffer[ smooth_index ] = rms;
+
+		// Ignore very small values that adversely affect the mean
+		if ( rms > AMPLITUDE_MIN )
+			mlt_properties_set_int( filter_properties, "_smooth_index", ( smooth_index + 1 ) % window );
+
+		// Smoothing is really just a mean over the past N values
+		normalised_gain = AMPLITUDE_NORM / mean( smooth_buffer, window );
+	}
+	else if ( rms > 0 )
+	{
+		// Determine gain to apply as current amplitude
+		normalised_gain = AMPLITUDE_NORM / rms;
+	}
+
+	// Govern the maximum gain
+	if ( normalised_gain > max_gain )
+		normalised_gain = max_gain;
+
+	return normalised_gain;
+}
+
+static inline float clip_sample( float sample )
+{
+	return sample > 1.0f ? 1.0f : sample < -1.0f ? -1.0f : sample;
+}
+
+/** Apply a plain gain stage to planar float audio.
+
+    This avoids converting to and from sox samples when no real effect runs.
+    Like the sox path, the input is clipped to full scale and so is the output
+    of the vol stage. Normalisation only scales a vol stage, so without one
+    there is only the analysis to do.
+*/
+static void process_gain_chain( mlt_filter filter, mlt_frame frame, float *buffer, int channels, int samples, double gain, int vol_count, int analysis )
+{
+	mlt_properties filter_properties = MLT_FILTER_PROPERTIES( filter );
+	char *normalise = mlt_properties_get( filter_properties, "normalise" );
+	int i, n;
+
+	for ( i = 0; i < channels; i++ )
+	{
+		float *p = buffer + i * samples;
+		double normalised_gain = 1.0;
+
+		if ( analysis || normalise )
+		{
+			double power = 0;
+			float peak = 0;
+
+			for ( n = 0; n < samples; n++ )
+			{
+				float sample = clip_sample( p[ n ] );
+				power += sample * sample;
+				if ( fabsf( sample ) > peak )
+					peak = fabsf( sample );
+			}
+			power /= samples;
+
+			// Use the same units as the sox sample path
+			if ( analysis )
+				analyse_channel( filter, frame, power * ST_SSIZE_MIN * ST_SSIZE_MIN, -peak * ST_SSIZE_MIN, i + 1 == channels );
+
+			if ( normalise )
+				normalised_gain = normalise_gain( filter_properties, sqrt( power ) );
+		}
+
+		if ( vol_count > 0 )
+		{
+			float g = gain * normalised_gain;
+
+			for ( n = 0; n < samples; n++ )
+				p[ n ] = clip_sample( clip_sample( p[ n ] ) * g );
+		}
+	}
+}
+
 #if (ST_LIB_VERSION_CODE >= ST_LIB_VERSION(14,1,0))
 static void delete_effect( eff_t effp )
 {
@@ -206,6 +492,19 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	int i; // channel
 	int count = mlt_properties_get_int( filter_properties, "_effect_count" );
 	int analysis = mlt_properties_get( filter_properties, "effect" ) && !strcmp( mlt_properties_get( filter_properties, "effect" ), "analysis" );
+	double gain = 1.0;
+	int vol_count = 0;
+
+	// A single gain stage runs on float audio without sox
+	if ( is_gain_chain( filter_properties, &gain, &vol_count ) )
+	{
+		*format = mlt_audio_float;
+		mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+		if ( *samples > 0 && ( vol_count > 0 || analysis ) )
+			process_gain_chain( filter, frame, *buffer, *channels, *samples, gain, vol_count, analysis );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+		return 0;
+	}
 
 	// Get the producer's audio
 	*format = mlt_audio_s32;
@@ -267,123 +566,34 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 			st_sample_t *p = input_buffer;
 			st_size_t isamp = *samples;
 			st_size_t osamp = *samples;
-			int j = *samples + 1;
+			int j;
 			char *normalise = mlt_properties_get( filter_properties, "normalise" );
 			double normalised_gain = 1.0;
 			
-			if ( analysis )
+			if ( analysis || normalise )
 			{
-				// Run analysis to compute a gain level to normalize the audio across entire filter duration
-				double max_power = mlt_properties_get_double( filter_properties, "_max_power" );
-				double peak = mlt_properties_get_double( filter_properties, "_max_peak" );
-				double use_peak = mlt_properties_get_int( filter_properties, "use_peak" );
 				double power = 0;
+				double peak = 0;
 				int n = *samples + 1;
 
 				// Compute power level of samples in this channel of this frame
 				while ( --n )
 				{
 					double s = abs( *p++ );
-					// Track peak
 					if ( s > peak )
-					{
 						peak = s;
-						mlt_properties_set_double( filter_properties, "_max_peak", peak );
-					}
 					power += s * s;
 				}
 				power /= *samples;
-				// Track maximum power
-				if ( power > max_power )
-				{
-					max_power = power;
-					mlt_properties_set_double( filter_properties, "_max_power", max_power );
-				}
 
-				// Complete analysis the last channel of the last frame.
-				if ( i + 1 == *channels && mlt_filter_get_position( filter, frame ) + 1
-					 == mlt_filter_get_length2( filter, frame ) )
-				{
-					double rms = sqrt( max_power / ST_SSIZE_MIN / ST_SSIZE_MIN );
-					char effect[32];
-
-					// Convert RMS or peak to gain
-					if ( use_peak )
-						normalised_gain = ST_SSIZE_MIN / -peak;
-					else
-					{
-						double gain = DBFSTOAMP(-12); // default -12 dBFS
-						char *p = mlt_properties_get( filter_properties, "analysis_level" );
-						if (p)
-						{
-							gain = mlt_properties_get_double( filter_properties, "analysis_level" );
-							if ( strstr( p, "dB" ) )
-								gain = DBFSTOAMP( gain );
-						}
-						normalised_gain = gain / rms;
-					}
-
-					// Set properties for serialization
-					snprintf( effect, sizeof(effect), "vol %f", normalised_gain );
-					effect[31] = 0;
-					mlt_properties_set( filter_properties, "effect", effect );
-					mlt_properties_set( filter_properties, "analyze", NULL );
-
-					// Show output comparable to normalize --no-adjust --fractions
-					mlt_properties_set_double( filter_properties, "level", rms );
-					mlt_properties_set_double( filter_properties, "gain", normalised_gain );
-					mlt_properties_set_double( filter_properties, "peak", -peak / ST_SSIZE_MIN );
-				}
+				// Run analysis to compute a gain level to normalize the audio across entire filter duration
+				if ( analysis )
+					analyse_channel( filter, frame, power, peak, i + 1 == *channels );
 
-				// restore some variables
-				p = input_buffer;
+				if ( normalise )
+					normalised_gain = normalise_gain( filter_properties, sqrt( power / ST_SSIZE_MIN / ST_SSIZE_MIN ) );
 			}
 
-			if ( normalise )
-			{
-				int window = mlt_properties_get_int( filter_properties, "window" );
-				double *smooth_buffer = mlt_properties_get_data( filter_properties, "smooth_buffer", NULL );
-				double max_gain = mlt_properties_get_double( filter_properties, "max_gain" );
-				double rms = 0;
-
-				// Default the maximum gain factor to 20dBFS
-				if ( max_gain == 0 )
-					max_gain = 10.0;
-				
-				// Compute rms amplitude
-				while( --j )
-				{
-					rms += ( double )*p * ( double )*p;
-					p ++;
-				}
-				rms = sqrt( rms / *samples / ST_SSIZE_MIN / ST_SSIZE_MIN );
-
-				// The smoothing buffer prevents radical shifts in the gain level
-				if ( window > 0 && smooth_buffer != NULL )
-				{
-					int smooth_index = mlt_properties_get_int( filter_properties, "_smooth_index" );
-					smooth_buffer[ smooth_index ] = rms;
-					
-					// Ignore very small values that adversely affect the mean
-					if ( rms > AMPLITUDE_MIN )
-						mlt_properties_set_int( filter_properties, "_smooth_index", ( smooth_index + 1 ) % window );
-					
-					// Smoothing is really just a mean over the past N values
-					normalised_gain = AMPLITUDE_NORM / mean( smooth_buffer, window );
-				}
-				else if ( rms > 0 )
-				{
-					// Determine gain to apply as current amplitude
-					normalised_gain = AMPLITUDE_NORM / rms;
-				}
-					
-				//printf("filter_sox: rms %.3f gain %.3f\n", rms, normalised_gain );
-				
-				// Govern the maximum gain
-				if ( normalised_gain > max_gain )
-					normalised_gain = max_gain;
-			}
-			
 			// For each effect
 			for ( j = 0; j < count; j++ )
 			{
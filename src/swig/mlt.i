@@ -75,6 +75,32 @@ namespace Mlt {
 %feature("shadow") Frame::get_image(mlt_image_format&, int&, int&) %{
     def get_image(*args): return _mlt.frame_get_image(*args)
 %}
+%extend Frame {
+%pythoncode %{
+    def get_image_buffer(self, *args):
+        """Get the image as a read only memoryview without copying it.
+
+        The view keeps the frame and its image memory alive until the view
+        and every object made from it are released, even after getting the
+        image again in another format."""
+        return _mlt.frame_get_image_buffer(self, *args)
+
+    def get_audio_buffer(self, *args):
+        """Get the audio as a read only memoryview without copying it.
+
+        The view keeps the frame and its audio memory alive until the view
+        and every object made from it are released, even after getting the
+        audio again in another format."""
+        return _mlt.frame_get_audio_buffer(self, *args)
+
+    def get_waveform_buffer(self, *args):
+        """Get the waveform as a read only memoryview without copying it.
+
+        The view keeps the frame and the waveform memory alive until it is
+        released."""
+        return _mlt.frame_get_waveform_buffer(self, *args)
+%}
+}
 #endif
 
 }
@@ -240,6 +266,190 @@ binary_data frame_get_image( Mlt::Frame &frame, mlt_image_format format, int w,
 	return result;
 }
 
+/** Memory owned by a frame, exposed through the buffer protocol.
+ *
+ * The object holds a reference on the frame, so a memoryview or numpy array
+ * made from it remains valid after the Frame itself is released. The block
+ * is pinned to the frame (see frame_buffer_pin), so getting the image or
+ * audio again in another format does not free it either.
+ */
+
+typedef struct {
+	PyObject_HEAD
+	mlt_frame frame;
+	void *data;
+	const char *format;
+	Py_ssize_t itemsize;
+	int ndim;
+	Py_ssize_t shape[3];
+	Py_ssize_t strides[3];
+} frame_buffer;
+
+static void frame_buffer_dealloc( PyObject *self )
+{
+	mlt_frame_close( ( (frame_buffer*) self )->frame );
+	PyObject_Del( self );
+}
+
+static int frame_buffer_get( PyObject *obj, Py_buffer *view, int flags )
+{
+	frame_buffer *self = (frame_buffer*) obj;
+	Py_ssize_t len = self->itemsize;
+	int i;
+
+	if ( ( flags & PyBUF_WRITABLE ) == PyBUF_WRITABLE )
+	{
+		PyErr_SetString( PyExc_BufferError, "frame buffers are read only" );
+		view->obj = NULL;
+		return -1;
+	}
+	for ( i = 0; i < self->ndim; i++ )
+		len *= self->shape[i];
+
+	view->obj = obj;
+	view->buf = self->data;
+	view->len = len;
+	view->readonly = 1;
+	view->itemsize = self->itemsize;
+	view->format = ( flags & PyBUF_FORMAT ) == PyBUF_FORMAT ? (char*) self->format : NULL;
+	view->ndim = self->ndim;
+	view->shape = ( flags & PyBUF_ND ) == PyBUF_ND ? self->shape : NULL;
+	view->strides = ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ? self->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	Py_INCREF( obj );
+	return 0;
+}
+
+static PyTypeObject *frame_buffer_type( void )
+{
+	static PyTypeObject type = { PyVarObject_HEAD_INIT( NULL, 0 ) };
+	static PyBufferProcs procs;
+
+	if ( !type.tp_name )
+	{
+		procs.bf_getbuffer = frame_buffer_get;
+		type.tp_name = "mlt.FrameBuffer";
+		type.tp_basicsize = sizeof( frame_buffer );
+		type.tp_dealloc = frame_buffer_dealloc;
+		type.tp_as_buffer = &procs;
+#if PY_MAJOR_VERSION < 3
+		type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#else
+		type.tp_flags = Py_TPFLAGS_DEFAULT;
+#endif
+		if ( PyType_Ready( &type ) < 0 )
+			return NULL;
+	}
+	return &type;
+}
+
+/** Keep the block held in a frame property for as long as the frame.
+ *
+ * The property, with its destructor, moves to a private name and the public
+ * name points at the same memory without one. A conversion then replaces the
+ * public property but leaves the exported block alone.
+ */
+
+static void frame_buffer_pin( mlt_frame frame, const char *name, void *data )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	char pinned[ 64 ];
+	int size = 0;
+
+	snprintf( pinned, sizeof( pinned ), "_buffer.%p", data );
+	if ( !data || mlt_properties_get_data( properties, name, &size ) != data || mlt_properties_get_data( properties, pinned, NULL ) )
+		return;
+	if ( !mlt_properties_rename( properties, name, pinned ) )
+		mlt_properties_set_data( properties, name, data, size, NULL, NULL );
+}
+
+/** Wrap C contiguous frame memory in a read only memoryview.
+ */
+
+static PyObject *frame_buffer_new( mlt_frame frame, void *data, const char *format, Py_ssize_t itemsize, int ndim, Py_ssize_t shape0, Py_ssize_t shape1, Py_ssize_t shape2 )
+{
+	PyTypeObject *type = frame_buffer_type();
+	frame_buffer *self;
+	PyObject *view;
+	int i;
+
+	if ( !data || !type )
+		Py_RETURN_NONE;
+
+	self = PyObject_New( frame_buffer, type );
+	if ( !self )
+		return NULL;
+	mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( frame ) );
+	self->frame = frame;
+	self->data = data;
+	self->format = format;
+	self->itemsize = itemsize;
+	self->ndim = ndim;
+	self->shape[0] = shape0;
+	self->shape[1] = shape1;
+	self->shape[2] = shape2;
+	self->strides[ndim - 1] = itemsize;
+	for ( i = ndim - 2; i >= 0; i-- )
+		self->strides[i] = self->strides[i + 1] * self->shape[i + 1];
+
+	view = PyMemoryView_FromObject( (PyObject*) self );
+	Py_DECREF( self );
+	return view;
+}
+
+PyObject *frame_get_image_buffer( Mlt::Frame &frame, mlt_image_format format, int w, int h )
+{
+	uint8_t *image = frame.get_image( format, w, h );
+
+	frame_buffer_pin( frame.get_frame(), "image", image );
+	switch ( format )
+	{
+	case mlt_image_rgb24:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 3 );
+	case mlt_image_rgb24a:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 4 );
+	case mlt_image_yuv422:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 2 );
+	default:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 1, mlt_image_format_size( format, w, h, NULL ), 0, 0 );
+	}
+}
+
+PyObject *frame_get_audio_buffer( Mlt::Frame &frame, mlt_audio_format format, int frequency, int channels, int samples )
+{
+	void *audio = frame.get_audio( format, frequency, channels, samples );
+
+	frame_buffer_pin( frame.get_frame(), "audio", audio );
+
+	// Interleaved formats are shaped ( samples, channels ), the others ( channels, samples )
+	switch ( format )
+	{
+	case mlt_audio_s16:
+		return frame_buffer_new( frame.get_frame(), audio, "h", 2, 2, samples, channels, 0 );
+	case mlt_audio_s32:
+		return frame_buffer_new( frame.get_frame(), audio, "i", 4, 2, channels, samples, 0 );
+	case mlt_audio_float:
+		return frame_buffer_new( frame.get_frame(), audio, "f", 4, 2, channels, samples, 0 );
+	case mlt_audio_s32le:
+		return frame_buffer_new( frame.get_frame(), audio, "i", 4, 2, samples, channels, 0 );
+	case mlt_audio_f32le:
+		return frame_buffer_new( frame.get_frame(), audio, "f", 4, 2, samples, channels, 0 );
+	case mlt_audio_u8:
+		return frame_buffer_new( frame.get_frame(), audio, "B", 1, 2, samples, channels, 0 );
+	default:
+		Py_RETURN_NONE;
+	}
+}
+
+PyObject *frame_get_waveform_buffer( Mlt::Frame &frame, int w, int h )
+{
+	uint8_t *waveform = frame.get_waveform( w, h );
+
+	frame_buffer_pin( frame.get_frame(), "waveform", waveform );
+	return frame_buffer_new( frame.get_frame(), waveform, "B", 1, 2, h, w, 0 );
+}
+
 %}
 
 %typemap(out) binary_data {
@@ -249,4 +459,10 @@ binary_data frame_get_image( Mlt::Frame &frame, mlt_image_format format, int w,
 binary_data frame_get_waveform(Mlt::Frame&, int, int);
 binary_data frame_get_image(Mlt::Frame&, mlt_image_format, int, int);
 
+/** Zero-copy access, returning a read only memoryview that keeps the frame alive.
+ */
+PyObject *frame_get_image_buffer(Mlt::Frame&, mlt_image_format, int, int);
+PyObject *frame_get_audio_buffer(Mlt::Frame&, mlt_audio_format, int, int, int);
+PyObject *frame_get_waveform_buffer(Mlt::Frame&, int, int);
+
 #endif
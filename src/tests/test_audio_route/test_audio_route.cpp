@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+#include <mlt++/Mlt.h>
+#include <string.h>
+using namespace Mlt;
+
+// The channel filters (audiomap, channelcopy, mono and audiochannels) share
+// one routing pass. These tests check each against the per-filter loops it
+// replaced, on interleaved s16 audio. Mixes are kept within range, where
+// the old loops wrapped instead of clipping.
+
+static const int SAMPLES = 300;
+
+typedef QVector<int16_t> Audio;
+
+static Audio makeAudio(int channels)
+{
+    Audio audio(SAMPLES * channels);
+    for (int s = 0; s < SAMPLES; s++)
+        for (int c = 0; c < channels; c++)
+            audio[s * channels + c] = (c + 1) * 10 + s % 50 - (c % 2) * 500;
+    return audio;
+}
+
+static Frame* makeFrame(const Audio& audio, int channels)
+{
+    Frame* frame = new Frame(mlt_frame_init(NULL));
+    int size = audio.size() * sizeof(int16_t);
+    void* buffer = mlt_pool_alloc(size);
+    memcpy(buffer, audio.constData(), size);
+    mlt_frame_set_audio(frame->get_frame(), buffer, mlt_audio_s16, size, mlt_pool_release);
+    frame->set("audio_frequency", 48000);
+    frame->set("audio_channels", channels);
+    frame->set("audio_samples", SAMPLES);
+    frame->dec_ref();
+    return frame;
+}
+
+static Audio filterAudio(Profile& profile, const char* id, const Audio& audio, int channels,
+                         int& requested, const char* name = 0, int value = 0,
+                         const char* name2 = 0, int value2 = 0)
+{
+    Filter filter(profile, id);
+    if (name)
+        filter.set(name, value);
+    if (name2)
+        filter.set(name2, value2);
+    Frame* frame = makeFrame(audio, channels);
+    filter.process(*frame);
+    mlt_audio_format format = mlt_audio_s16;
+    int frequency = 48000;
+    int samples = SAMPLES;
+    int16_t* pcm = (int16_t*) frame->get_audio(format, frequency, requested, samples);
+    Audio result;
+    if (pcm && format == mlt_audio_s16 && samples == SAMPLES)
+        for (int i = 0; i < samples * requested; i++)
+            result.append(pcm[i]);
+    delete frame;
+    return result;
+}
+
+// The old filter_audiomap loop: only the first 32 channels could be mapped.
+static Audio oldAudiomap(Audio audio, int channels, const int* map, int count)
+{
+    int m[32];
+    for (int i = 0; i < 32; i++)
+        m[i] = i;
+    for (int i = 0; i < count; i += 2)
+        if (map[i + 1] >= 0 && map[i + 1] < 32)
+            m[map[i]] = map[i + 1];
+    for (int s = 0; s < SAMPLES; s++) {
+        int16_t tmp[32];
+        int16_t* pcm = audio.data() + s * channels;
+        for (int j = 0; j < 32 && j < channels; j++)
+            tmp[j] = pcm[m[j]];
+        for (int j = 0; j < 32 && j < channels; j++)
+            pcm[j] = tmp[j];
+    }
+    return audio;
+}
+
+// The old filter_channelcopy loop.
+static Audio oldChannelcopy(Audio audio, int channels, int from, int to, bool swap)
+{
+    for (int s = 0; s < SAMPLES; s++) {
+        int16_t* f = audio.data() + s * channels + from;
+        int16_t* t = audio.data() + s * channels + to;
+        int16_t x = *t;
+        *t = *f;
+        if (swap)
+            *f = x;
+    }
+    return audio;
+}
+
+// The old filter_mono loop.
+static Audio oldMono(const Audio& audio, int channels, int channels_out)
+{
+    Audio result(SAMPLES * channels_out);
+    for (int s = 0; s < SAMPLES; s++) {
+        int16_t mixdown = 0;
+        for (int j = 0; j < channels; j++)
+            mixdown += audio[s * channels + j];
+        for (int j = 0; j < channels_out; j++)
+            result[s * channels_out + j] = mixdown;
+    }
+    return result;
+}
+
+// The old filter_audiochannels loops.
+static Audio oldAudiochannels(const Audio& audio, int channels, int requested)
+{
+    Audio result(SAMPLES * requested);
+    if (channels < requested) {
+        // Duplicate the existing channels
+        int k = 0;
+        for (int s = 0; s < SAMPLES; s++)
+            for (int j = 0; j < requested; j++) {
+                result[s * requested + j] = audio[s * channels + k];
+                k = (k + 1) % channels;
+            }
+    } else if (channels == 6 && requested == 2) {
+        // Downmix 5.1 audio to stereo
+        for (int s = 0; s < SAMPLES; s++) {
+            const int16_t* in = audio.constData() + s * 6;
+            result[s * 2] = qBound<double>(INT16_MIN, in[0] + 0.707 * in[2] + 0.5 * in[4], INT16_MAX);
+            result[s * 2 + 1] = qBound<double>(INT16_MIN, in[1] + 0.707 * in[2] + 0.5 * in[5], INT16_MAX);
+        }
+    } else {
+        // Drop all but the first requested
+        for (int s = 0; s < SAMPLES; s++)
+            for (int j = 0; j < requested; j++)
+                result[s * requested + j] = audio[s * channels + j];
+    }
+    return result;
+}
+
+class TestAudioRoute: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestAudioRoute() {
+        Factory::init();
+    }
+
+private Q_SLOTS:
+    void AudiomapMatchesOldLoop()
+    {
+        Profile profile;
+        const int stereo[] = { 0, 1, 1, 0 };
+        const int wide[] = { 0, 3, 5, 31 };
+        int channels = 2;
+        Audio audio = makeAudio(2);
+
+        QCOMPARE(filterAudio(profile, "audiomap", audio, 2, channels, "0", 1, "1", 0),
+                 oldAudiomap(audio, 2, stereo, 4));
+        QCOMPARE(channels, 2);
+
+        // Beyond 32 channels
+        channels = 40;
+        audio = makeAudio(40);
+        QCOMPARE(filterAudio(profile, "audiomap", audio, 40, channels, "0", 3, "5", 31),
+                 oldAudiomap(audio, 40, wide, 4));
+        QCOMPARE(channels, 40);
+
+        // The old loop left channels from 32 on alone; they can be mapped now.
+        Audio expected = audio;
+        for (int s = 0; s < SAMPLES; s++)
+            expected[s * 40 + 33] = audio[s * 40 + 2];
+        QCOMPARE(filterAudio(profile, "audiomap", audio, 40, channels, "33", 2), expected);
+    }
+
+    void ChannelcopyMatchesOldLoop()
+    {
+        Profile profile;
+        int channels = 2;
+        Audio audio = makeAudio(2);
+
+        QCOMPARE(filterAudio(profile, "channelcopy", audio, 2, channels, "from", 0, "to", 1),
+                 oldChannelcopy(audio, 2, 0, 1, false));
+        QCOMPARE(filterAudio(profile, "channelswap", audio, 2, channels, "from", 0, "to", 1),
+                 oldChannelcopy(audio, 2, 0, 1, true));
+
+        // Beyond 32 channels
+        channels = 40;
+        audio = makeAudio(40);
+        QCOMPARE(filterAudio(profile, "channelcopy", audio, 40, channels, "from", 35, "to", 2),
+                 oldChannelcopy(audio, 40, 35, 2, false));
+        QCOMPARE(filterAudio(profile, "channelswap", audio, 40, channels, "from", 1, "to", 38),
+                 oldChannelcopy(audio, 40, 1, 38, true));
+        QCOMPARE(channels, 40);
+    }
+
+    void MonoMatchesOldLoop()
+    {
+        Profile profile;
+        int channels = 2;
+        Audio audio = makeAudio(2);
+
+        QCOMPARE(filterAudio(profile, "mono", audio, 2, channels, "channels", -1),
+                 oldMono(audio, 2, 2));
+        channels = 1;
+        QCOMPARE(filterAudio(profile, "mono", audio, 2, channels, "channels", 1),
+                 oldMono(audio, 2, 1));
+        QCOMPARE(channels, 1);
+
+        // Beyond 32 channels
+        channels = 2;
+        audio = makeAudio(40);
+        QCOMPARE(filterAudio(profile, "mono", audio, 40, channels, "channels", 2),
+                 oldMono(audio, 40, 2));
+        QCOMPARE(channels, 2);
+        channels = 40;
+        audio = makeAudio(2);
+        QCOMPARE(filterAudio(profile, "mono", audio, 2, channels, "channels", 40),
+                 oldMono(audio, 2, 40));
+        QCOMPARE(channels, 40);
+    }
+
+    void AudiochannelsMatchesOldLoop()
+    {
+        Profile profile;
+        int cases[][2] = { { 1, 2 }, { 2, 4 }, { 4, 2 }, { 2, 1 }, { 2, 40 }, { 40, 2 } };
+
+        for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+            int channels = cases[i][1];
+            Audio audio = makeAudio(cases[i][0]);
+            QCOMPARE(filterAudio(profile, "audiochannels", audio, cases[i][0], channels),
+                     oldAudiochannels(audio, cases[i][0], cases[i][1]));
+            QCOMPARE(channels, cases[i][1]);
+        }
+    }
+
+    void AudiochannelsDownmixMatchesOldLoop()
+    {
+        Profile profile;
+        int channels = 2;
+        Audio audio = makeAudio(6);
+        Audio expected = oldAudiochannels(audio, 6, 2);
+        Audio result = filterAudio(profile, "audiochannels", audio, 6, channels);
+
+        // The mix now runs in single precision, which may round differently.
+        QCOMPARE(result.size(), expected.size());
+        for (int i = 0; i < result.size(); i++)
+            QVERIFY(qAbs(result[i] - expected[i]) <= 1);
+    }
+
+    void StackedFiltersMatchOldLoops()
+    {
+        Profile profile;
+        Filter copy(profile, "channelcopy");
+        Filter mono(profile, "mono");
+        Filter channels(profile, "audiochannels");
+        Audio audio = makeAudio(40);
+        copy.set("from", 39);
+        copy.set("to", 0);
+        mono.set("channels", 3);
+
+        Frame* frame = makeFrame(audio, 40);
+        copy.process(*frame);
+        mono.process(*frame);
+        channels.process(*frame);
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = 48000;
+        int count = 2;
+        int samples = SAMPLES;
+        int16_t* pcm = (int16_t*) frame->get_audio(format, frequency, count, samples);
+
+        Audio expected = oldAudiochannels(oldMono(oldChannelcopy(audio, 40, 39, 0, false), 40, 3), 3, 2);
+        QCOMPARE(count, 2);
+        QVERIFY(pcm);
+        for (int i = 0; i < SAMPLES * 2; i++)
+            QCOMPARE(pcm[i], expected[i]);
+        delete frame;
+    }
+};
+
+QTEST_APPLESS_MAIN(TestAudioRoute)
+
+#include "test_audio_route.moc"
@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_audio_route
+SOURCES += test_audio_route.cpp
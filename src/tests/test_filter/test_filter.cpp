@@ -70,6 +70,97 @@ private Q_SLOTS:
         delete frame;
     }
 
+    void AttachedFilterFollowsPropertyChanges()
+    {
+        Profile profile("dv_ntsc");
+        Producer producer(profile, "noise", NULL);
+        Filter filter(profile, "brightness");
+        producer.attach(filter);
+        mlt_service_prepare(producer.get_service());
+
+        // A filter sets the out point of the frame to its own when it applies.
+        Frame* frame = producer.get_frame();
+        QCOMPARE(frame->get_int("out"), producer.get_out());
+        delete frame;
+
+        filter.set_in_and_out(0, 50);
+        producer.seek(0);
+        frame = producer.get_frame();
+        QCOMPARE(frame->get_int("out"), 50);
+        delete frame;
+
+        filter.set("disable", 1);
+        producer.seek(0);
+        frame = producer.get_frame();
+        QCOMPARE(frame->get_int("out"), producer.get_out());
+        delete frame;
+
+        filter.set("disable", 0);
+        filter.set_in_and_out(10, 50);
+        producer.seek(0);
+        frame = producer.get_frame();
+        QCOMPARE(frame->get_int("out"), producer.get_out());
+        delete frame;
+
+        // Passing properties refreshes the plan too.
+        Properties times;
+        times.set("in", 0);
+        times.set("out", 60);
+        filter.pass_list(times, "in out");
+        producer.seek(0);
+        frame = producer.get_frame();
+        QCOMPARE(frame->get_int("out"), 60);
+        delete frame;
+    }
+
+    void AvdeinterlaceMatchesReference()
+    {
+        Profile profile("dv_pal");
+        Filter filter(profile, "avdeinterlace");
+        if (!filter.is_valid())
+            QSKIP("avdeinterlace is not available");
+
+        int width = 720;
+        int height = 576;
+        int size = width * height * 2;
+        uint8_t* source = (uint8_t*) mlt_pool_alloc(size);
+        for (int i = 0; i < size; i++)
+            source[i] = qrand() & 0xff;
+        QByteArray expected((const char*) source, size);
+
+        // The bottom field is rebuilt with the [-1 4 2 4 -1]/8 filter,
+        // clamping taps that fall outside the image.
+        int stride = width * 2;
+        for (int y = 1; y < height; y += 2) {
+            const uint8_t* m2 = source + qMax(y - 2, 0) * stride;
+            const uint8_t* m1 = source + (y - 1) * stride;
+            const uint8_t* c = source + y * stride;
+            const uint8_t* p1 = source + (y + 1 < height ? y + 1 : y) * stride;
+            const uint8_t* p2 = source + (y + 2 < height ? y + 2 : y) * stride;
+            for (int x = 0; x < stride; x++) {
+                int sum = -m2[x] + 4 * m1[x] + 2 * c[x] + 4 * p1[x] - p2[x];
+                expected[y * stride + x] = (char) qBound(0, (sum + 4) >> 3, 255);
+            }
+        }
+
+        mlt_frame raw = mlt_frame_init(NULL);
+        mlt_frame_set_image(raw, source, size, mlt_pool_release);
+        Frame frame(raw);
+        mlt_frame_close(raw);
+        frame.set("format", mlt_image_yuv422);
+        frame.set("width", width);
+        frame.set("height", height);
+        frame.set("progressive", 0);
+        frame.set("consumer_deinterlace", 1);
+        filter.process(frame);
+
+        mlt_image_format format = mlt_image_yuv422;
+        uint8_t* image = frame.get_image(format, width, height, 1);
+        QVERIFY(image != NULL);
+        QCOMPARE(frame.get_int("progressive"), 1);
+        QCOMPARE(QByteArray((const char*) image, size), expected);
+    }
+
 };
 
 QTEST_APPLESS_MAIN(TestFilter)
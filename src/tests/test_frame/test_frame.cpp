@@ -93,6 +93,33 @@ private Q_SLOTS:
         QCOMPARE(f1.ref_count(), 2);
         mlt_frame_close(frame);
     }
+
+    void InitAfterCloseGivesEmptyFrame()
+    {
+        Factory::init();
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        int count = mlt_properties_count(properties);
+        mlt_properties_set(properties, "foo", "bar");
+        mlt_properties_set_int(properties, "width", 1);
+        mlt_frame_push_service(frame, frame);
+        mlt_frame_push_audio(frame, frame);
+        mlt_frame_close(frame);
+
+        for (int i = 0; i < 20; i++) {
+            frame = mlt_frame_init(NULL);
+            properties = MLT_FRAME_PROPERTIES(frame);
+            QCOMPARE(mlt_properties_ref_count(properties), 1);
+            QCOMPARE(mlt_properties_count(properties), count);
+            QVERIFY(mlt_properties_get(properties, "foo") == NULL);
+            QCOMPARE(mlt_properties_get_int(properties, "width"), 720);
+            QCOMPARE(mlt_deque_count(MLT_FRAME_SERVICE_STACK(frame)), 0);
+            QCOMPARE(mlt_deque_count(MLT_FRAME_AUDIO_STACK(frame)), 0);
+            QCOMPARE(mlt_deque_count(MLT_FRAME_IMAGE_STACK(frame)), 0);
+            mlt_properties_set(properties, "foo", "bar");
+            mlt_frame_close(frame);
+        }
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFrame)
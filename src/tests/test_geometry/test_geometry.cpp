@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+#include <mlt++/Mlt.h>
+#include <string.h>
+
+static char spec[] = "0=10/20:30x40:50;25=50%/10%:100x200!;50=;-1=1/2:3x4:5";
+
+class TestGeometry : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+
+	void PackedGeometryFetchesTheSame()
+	{
+		mlt_geometry a = mlt_geometry_init();
+		mlt_geometry b = mlt_geometry_init();
+		mlt_geometry_parse(a, spec, 100, 1920, 1080);
+		int size = 0;
+		void *block = mlt_geometry_pack(a, &size);
+		QVERIFY(block);
+		QCOMPARE(mlt_geometry_unpack(b, block, size), 0);
+		for (int i = -5; i < 110; i++) {
+			struct mlt_geometry_item_s x, y;
+			mlt_geometry_fetch(a, &x, i);
+			mlt_geometry_fetch(b, &y, i);
+			QVERIFY(!memcmp(&x, &y, sizeof(x)));
+		}
+		char *s1 = mlt_geometry_serialise(a);
+		char *s2 = mlt_geometry_serialise(b);
+		QCOMPARE(s1, s2);
+		free(s1);
+		free(s2);
+		free(block);
+		mlt_geometry_close(a);
+		mlt_geometry_close(b);
+	}
+
+	void UnpackedGeometryIsNotParsedAgain()
+	{
+		mlt_geometry a = mlt_geometry_init();
+		mlt_geometry b = mlt_geometry_init();
+		mlt_geometry_parse(a, spec, 100, 1920, 1080);
+		int size = 0;
+		void *block = mlt_geometry_pack(a, &size);
+		QCOMPARE(mlt_geometry_unpack(b, block, size), 0);
+		QCOMPARE(mlt_geometry_refresh(b, spec, 100, 1920, 1080), -1);
+		QCOMPARE(mlt_geometry_get_length(b), 100);
+		free(block);
+		mlt_geometry_close(a);
+		mlt_geometry_close(b);
+	}
+
+	void EmptyGeometryRoundTrips()
+	{
+		mlt_geometry a = mlt_geometry_init();
+		mlt_geometry b = mlt_geometry_init();
+		mlt_geometry_parse(b, spec, 100, 1920, 1080);
+		int size = 0;
+		void *block = mlt_geometry_pack(a, &size);
+		QCOMPARE(mlt_geometry_unpack(b, block, size), 0);
+		struct mlt_geometry_item_s item;
+		QCOMPARE(mlt_geometry_next_key(b, &item, 0), 1);
+		free(block);
+		mlt_geometry_close(a);
+		mlt_geometry_close(b);
+	}
+
+	void InvalidBlockIsRejected()
+	{
+		mlt_geometry a = mlt_geometry_init();
+		mlt_geometry b = mlt_geometry_init();
+		mlt_geometry_parse(a, spec, 100, 1920, 1080);
+		mlt_geometry_parse(b, (char*) "0=1/2:3x4", 10, -1, -1);
+		int size = 0;
+		char *block = (char*) mlt_geometry_pack(a, &size);
+		QCOMPARE(mlt_geometry_unpack(b, NULL, size), 1);
+		QCOMPARE(mlt_geometry_unpack(b, block, size - 1), 1);
+		QCOMPARE(mlt_geometry_unpack(b, block, size + 1), 1);
+		QCOMPARE(mlt_geometry_unpack(b, block, -1), 1);
+		block[0] = 'X';
+		QCOMPARE(mlt_geometry_unpack(b, block, size), 1);
+		// The geometry is unchanged
+		QCOMPARE(mlt_geometry_get_length(b), 10);
+		free(block);
+		mlt_geometry_close(a);
+		mlt_geometry_close(b);
+	}
+};
+
+QTEST_APPLESS_MAIN(TestGeometry)
+
+#include "test_geometry.moc"
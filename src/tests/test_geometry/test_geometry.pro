@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_geometry
+SOURCES += test_geometry.cpp
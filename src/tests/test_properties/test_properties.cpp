@@ -308,6 +308,56 @@ private Q_SLOTS:
         }
     }
 
+    void TimeClockMatchesReference()
+    {
+        // Compare with the C library conversions the clock value used to rely on.
+        const double fps[] = { 25.0, 30000.0/1001.0, 24000.0/1001.0, 60.0, 1000.0 };
+        qsrand(1);
+        for (int i = 0; i < 100000; ++i) {
+            double f = fps[i % 5];
+            int frames = qrand() % 10000000;
+            int hours = frames / (f * 3600);
+            int rest = frames - floor(hours * 3600 * f);
+            int mins = rest / (f * 60);
+            rest -= floor(mins * 60 * f);
+            QString expected = QString::asprintf("%02d:%02d:%06.3f", hours, mins, rest / f);
+            mlt_property prop = mlt_property_init();
+            mlt_property_set_int(prop, frames);
+            QCOMPARE(QString(mlt_property_get_time(prop, mlt_time_clock, f, locale)), expected);
+
+            QString clock = QString::asprintf("%d:%d:%d.%0*d", qrand() % 100, qrand() % 60,
+                qrand() % 60, qrand() % 6 + 1, qrand() % 1000);
+            QStringList parts = clock.split(':');
+            int expectedFrames = floor(f * parts[0].toInt() * 3600) + floor(f * parts[1].toInt() * 60)
+                + lrint(f * parts[2].toDouble());
+            mlt_property_set_string(prop, clock.toLatin1().constData());
+            QCOMPARE(mlt_property_get_int(prop, f, locale), expectedFrames);
+            mlt_property_close(prop);
+        }
+    }
+
+    void TimeClockAcceptsDecimalComma()
+    {
+        mlt_property prop = mlt_property_init();
+        mlt_property_set_string(prop, "00:00:01,52");
+        QCOMPARE(mlt_property_get_int(prop, 25, locale), 38);
+        mlt_property_set_string(prop, "00:00:01.52");
+        QCOMPARE(mlt_property_get_int(prop, 25, locale), 38);
+        mlt_property_close(prop);
+    }
+
+    void TimeClockBenchmark()
+    {
+        mlt_property prop = mlt_property_init();
+        int frames = 0;
+        QBENCHMARK {
+            mlt_property_set_int(prop, ++frames);
+            mlt_property_set_string(prop, mlt_property_get_time(prop, mlt_time_clock, 25, locale));
+            mlt_property_get_int(prop, 25, locale);
+        }
+        mlt_property_close(prop);
+    }
+
     void SetSimpleMathExpression()
     {
         Properties p;
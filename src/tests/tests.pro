@@ -4,4 +4,6 @@ SUBDIRS = test_filter \
     test_properties \
     test_repository \
     test_animation \
+    test_geometry \
+    test_audio_route \
     test_tractor